@@ -0,0 +1,21 @@
+#!/bin/bash
+
+# This test vector measures the write throughput of the file system for each durability mode of the storage device.
+# It defines a storage device with 20000 blocks and, for each mode, formats it, mounts it, writes a 4 MB file with dd
+# (which forces the data to stable storage before reporting) and unmounts it.
+# Modes: sync (every write back of the buffercache is synchronous), datasync (fdatasync on fsync, flush and unmount) and
+# unsafe (benchmarking only).
+# It needs FUSE and the mount tool, which is linked with the prebuilt 32-bit objects. For a measurement of the
+# buffercache alone on a plain support file, see benchcache_sofs11 -w.
+
+for mode in sync datasync unsafe
+do
+  echo -e "\n**** Durability mode: $mode ****\n"
+  ./createEmptyFile myDisk 20000
+  ./mkfs_sofs11_bin -i 56 -z myDisk >/dev/null
+  ./mount_sofs11_bin -o durability=$mode myDisk mnt
+  sleep 1
+  dd if=/dev/zero of=mnt/perf.dat bs=64k count=64 conv=fsync 2>&1 | tail -n 1
+  sleep 1
+  fusermount -u mnt
+done
@@ -0,0 +1,504 @@
+/**
+ *  \file benchcache_sofs11.c (implementation file)
+ *
+ *  \brief The SOFS11 buffercache benchmarking tool.
+ *
+ *  It measures the cost of the internal operations of the buffercache storage area, which does not depend on the
+ *  storage device, for storage areas of different sizes (1K, 64K and 1M nodes, by default).
+ *  For each size, the storage area is filled with blocks spread over the device and the mean time of the following
+ *  operations is printed:
+ *      \li insertion of a node
+ *      \li look up of a block which is stored in the storage area (hit) and of one which is not (miss)
+ *      \li look up of a block, hit and miss, by traversing the double-linked list based on the physical block
+ *          number, as it was done before the storage area was indexed
+ *      \li replacement of the least recently accessed node by a new block (retrieval followed by insertion).
+ *
+ *  The traversal of the list is carried out a smaller number of times for the larger sizes, so that each size takes
+ *  roughly the same time.
+ *
+ *  If a support file is given, the hit ratio of each replacement policy of the buffercache is measured, instead, for a
+ *  workload which mixes accesses to a metadata working set, some blocks of the table of inodes and some clusters of
+ *  directories and of indirect references, with streaming accesses, a sequential sweep of the table of inodes and a
+ *  large sequential file read. The support file is used as a raw device: its contents is read, but not changed.
+ *
+ *  If a support file is given for writing, the write throughput of the buffercache is measured, instead, for each
+ *  durability mode of the storage device: clusters are written sequentially, with a single synchronization at the end
+ *  and with a synchronization every few clusters, as if a small file were closed each time. The contents of the
+ *  support file is overwritten.
+ *
+ *  SINOPSIS:
+ *  <P><PRE>                benchcache_sofs11 [OPTIONS]
+
+                  OPTIONS:
+                   -n nodes      --- size of the storage area, it may be repeated (default: 1024, 65536 and 1048576)
+                   -l lookups    --- number of look ups of each kind (default: 1000000)
+                   -p supp-file  --- measure the hit ratio of the replacement policies on the support file
+                   -w supp-file  --- measure the write throughput of the durability modes on the support file
+                   -h            --- print this help.</PRE>
+ *
+ *  \author António Rui Borges - September 2011
+ */
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <libgen.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+
+#include "sofs_const.h"
+#include "sofs_rawdisk.h"
+#include "sofs_buffercache.h"
+#include "sofs_buffercachenode.h"
+#include "sofs_buffercacheinternals.h"
+
+/** \brief maximum number of sizes of the storage area */
+#define MAX_SIZES  (16)
+
+/** \brief maximum number of list traversal steps per measurement */
+#define LIST_STEPS (UINT64_C (50000000))
+
+/** \brief number of blocks of the table of inodes swept by the streaming accesses */
+#define TABLE_BLOCKS  (512)
+/** \brief number of blocks of the table of inodes in the metadata working set */
+#define HOT_BLOCKS    (24)
+/** \brief number of clusters in the metadata working set */
+#define HOT_CLUSTERS  (24)
+/** \brief number of accesses to the metadata working set */
+#define META_ACCESSES (100000)
+/** \brief number of accesses to the metadata working set per streaming access to a block and to a cluster */
+#define STREAM_EVERY  (2)
+/** \brief minimum number of clusters of the large file */
+#define STREAM_MIN    (1024)
+
+/** \brief maximum number of clusters written per measurement of the write throughput */
+#define WRITE_MAX     (2048)
+/** \brief number of clusters written between synchronizations, when they are frequent */
+#define SYNC_EVERY    (8)
+
+/* Allusion to internal functions */
+
+static int benchSize (uint32_t nNodes, uint32_t nLookUps);
+static int benchPolicy (const char *devname, uint32_t policy);
+static int benchWrite (const char *devname, uint32_t mode);
+static int writeClusters (uint32_t nClusters, uint32_t syncEvery, uint64_t *p_ns);
+static uint64_t rawReads (void);
+static SOBufferCacheNode *searchList (uint32_t nBlock, SOBufferCacheNode *head);
+static uint32_t blockOf (uint32_t i);
+static uint32_t nextRand (void);
+static uint64_t clockNs (void);
+static void printUsage (char *cmd_name);
+static void printError (int errcode, char *cmd_name);
+
+/** \brief sink of the look up results, so that they are not optimized away */
+static volatile uintptr_t sink;
+
+/** \brief state of the pseudo-random number generator */
+static uint32_t seed = 2463534242U;
+
+/* The main function */
+
+int main (int argc, char *argv[])
+{
+  uint32_t size[MAX_SIZES];                      /* sizes of the storage area */
+  uint32_t nSizes = 0;                           /* number of sizes */
+  uint32_t nLookUps = 1000000;                   /* number of look ups of each kind */
+  char *devname = NULL;                          /* support file of the policy workload */
+  char *wrname = NULL;                           /* support file of the write workload */
+  unsigned long val;                             /* value of a numeric argument */
+  char *end;                                     /* end of a numeric argument */
+
+  /* process command line options */
+
+  int opt;                                       /* selected option */
+
+  do
+  { switch ((opt = getopt (argc, argv, "n:l:p:w:h")))
+    { case 'n': /* size of the storage area */
+                val = strtoul (optarg, &end, 0);
+                if ((*optarg < '0') || (*optarg > '9') || (*end != '\0') || (val == 0) || (val > (1UL << 30)) ||
+                    (nSizes == MAX_SIZES))
+                   { fprintf (stderr, "%s: Bad argument to n option.\n", basename (argv[0]));
+                     printUsage (basename (argv[0]));
+                     return EXIT_FAILURE;
+                   }
+                size[nSizes++] = (uint32_t) val;
+                break;
+      case 'l': /* number of look ups */
+                val = strtoul (optarg, &end, 0);
+                if ((*optarg < '0') || (*optarg > '9') || (*end != '\0') || (val == 0) || (val > UINT32_MAX))
+                   { fprintf (stderr, "%s: Bad argument to l option.\n", basename (argv[0]));
+                     printUsage (basename (argv[0]));
+                     return EXIT_FAILURE;
+                   }
+                nLookUps = (uint32_t) val;
+                break;
+      case 'p': /* support file of the policy workload */
+                devname = optarg;
+                break;
+      case 'w': /* support file of the write workload */
+                wrname = optarg;
+                break;
+      case 'h': /* help mode */
+                printUsage (basename (argv[0]));
+                return EXIT_SUCCESS;
+      case -1:  break;
+      default:  fprintf (stderr, "%s: Wrong option.\n", basename (argv[0]));
+                printUsage (basename (argv[0]));
+                return EXIT_FAILURE;
+    }
+  } while (opt != -1);
+  if ((argc - optind) != 0)                      /* no mandatory arguments */
+     { fprintf (stderr, "%s: Wrong number of mandatory arguments.\n", basename (argv[0]));
+       printUsage (basename (argv[0]));
+       return EXIT_FAILURE;
+     }
+  if (nSizes == 0)
+     { size[0] = 1024;
+       size[1] = 65536;
+       size[2] = 1048576;
+       nSizes = 3;
+     }
+
+  /* run the benchmark */
+
+  uint32_t i;                                    /* counting variable */
+  int status;                                    /* status of operation */
+
+  if (devname != NULL)
+     { printf ("Hit ratio (%%), %d metadata accesses, a streaming block and cluster every %d of them\n", META_ACCESSES,
+               STREAM_EVERY);
+       printf ("%8s %10s %10s %10s\n", "policy", "metadata", "stream", "overall");
+       if (((status = benchPolicy (devname, CACHE_LRU)) != 0) || ((status = benchPolicy (devname, CACHE_2Q)) != 0))
+          { printError (status, basename (argv[0]));
+            return EXIT_FAILURE;
+          }
+       return EXIT_SUCCESS;
+     }
+
+  if (wrname != NULL)
+     { printf ("Write throughput (MB/s), a synchronization at the end or every %d clusters\n", SYNC_EVERY);
+       printf ("%10s %10s %10s\n", "mode", "once", "frequent");
+       if (((status = benchWrite (wrname, DEV_SYNC)) != 0) || ((status = benchWrite (wrname, DEV_DATASYNC)) != 0) ||
+           ((status = benchWrite (wrname, DEV_UNSAFE)) != 0))
+          { printError (status, basename (argv[0]));
+            return EXIT_FAILURE;
+          }
+       return EXIT_SUCCESS;
+     }
+
+  printf ("Mean time per operation (ns), %"PRIu32" look ups of each kind\n", nLookUps);
+  printf ("%10s %10s %10s %10s %12s %12s %10s\n", "nodes", "insert", "hit", "miss", "list hit", "list miss",
+          "replace");
+  for (i = 0; i < nSizes; i++)
+    if ((status = benchSize (size[i], nLookUps)) != 0)
+       { printError (status, basename (argv[0]));
+         return EXIT_FAILURE;
+       }
+
+  /* that's all */
+
+  return EXIT_SUCCESS;
+
+} /* end of main */
+
+/*
+ *  Run the benchmark for a storage area of a given size and print a line of results.
+ */
+
+static int benchSize (uint32_t nNodes, uint32_t nLookUps)
+{
+  SONodeIndex idx = { NULL, 0, 0, 0, NULL };    /* index of the storage area */
+  SOBufferCacheNode *node;                       /* storage area */
+  SOBufferCacheNode *nLHead = NULL;              /* head of the double-linked list based on the block number */
+  SOBufferCacheNode *lATLHead = NULL;            /* head of the double-linked list based on the last access time */
+  SOBufferCacheNode *lATLTail = NULL;            /* tail of the double-linked list based on the last access time */
+  SOBufferCacheNode *p;                          /* node retrieved from the storage area */
+  uint32_t nList;                                /* number of list traversals of each kind */
+  uint32_t i;                                    /* counting variable */
+  uint64_t t0, tIns, tHit, tMiss, tRep, tLHit, tLMiss;     /* clock readings and elapsed times */
+  uintptr_t acc = 0;                             /* accumulated look up results */
+  int stat;                                      /* status of operation */
+
+  if ((node = calloc (nNodes, sizeof (SOBufferCacheNode))) == NULL)
+     return -ENOMEM;
+  if ((stat = setUpNodeIndex (&idx, nNodes)) != 0)
+     { free (node);
+       return stat;
+     }
+
+  /* fill the storage area */
+
+  t0 = clockNs ();
+  for (i = 0; i < nNodes; i++)
+  { node[i].n = blockOf (i);
+    node[i].size = 1;
+    insertNode (&idx, &node[i], &nLHead, &lATLHead, &lATLTail);
+  }
+  tIns = clockNs () - t0;
+
+  /* look up blocks which are stored and blocks which are not */
+
+  t0 = clockNs ();
+  for (i = 0; i < nLookUps; i++)
+  { p = searchNodeOnN (&idx, blockOf (nextRand () % nNodes), nLHead);
+    acc += (uintptr_t) p;
+    moveNodeAtHeadLAT (p, &lATLHead, &lATLTail);
+  }
+  tHit = clockNs () - t0;
+  t0 = clockNs ();
+  for (i = 0; i < nLookUps; i++)
+    acc += (uintptr_t) searchNodeOnN (&idx, blockOf (nextRand () % nNodes) + 1, nLHead);
+  tMiss = clockNs () - t0;
+
+  /* traverse the double-linked list based on the block number */
+
+  nList = (uint32_t) (LIST_STEPS / nNodes);
+  if (nList > nLookUps) nList = nLookUps;
+  if (nList == 0) nList = 1;
+  t0 = clockNs ();
+  for (i = 0; i < nList; i++)
+    acc += (uintptr_t) searchList (blockOf (nextRand () % nNodes), nLHead);
+  tLHit = clockNs () - t0;
+  t0 = clockNs ();
+  for (i = 0; i < nList; i++)
+    acc += (uintptr_t) searchList (blockOf (nextRand () % nNodes) + 1, nLHead);
+  tLMiss = clockNs () - t0;
+
+  /* replace the least recently accessed nodes by new blocks */
+
+  t0 = clockNs ();
+  for (i = 0; i < nLookUps; i++)
+  { if ((p = retrieveNode (&idx, &nLHead, &lATLHead, &lATLTail)) == NULL)
+       { freeNodeIndex (&idx);
+         free (node);
+         return -ELIBBAD;
+       }
+    p->n = blockOf (nNodes + i);
+    insertNode (&idx, p, &nLHead, &lATLHead, &lATLTail);
+  }
+  tRep = clockNs () - t0;
+  sink = acc;
+
+  printf ("%10"PRIu32" %10.1f %10.1f %10.1f %12.1f %12.1f %10.1f\n", nNodes, (double) tIns / nNodes,
+          (double) tHit / nLookUps, (double) tMiss / nLookUps, (double) tLHit / nList, (double) tLMiss / nList,
+          (double) tRep / nLookUps);
+
+  freeNodeIndex (&idx);
+  free (node);
+
+  return 0;
+}
+
+/*
+ *  Run the policy workload on the buffercache for a given replacement policy and print a line of results.
+ *
+ *  Every access which is not a hit takes a transfer from the storage device, so the misses are counted by the number
+ *  of reads of the device.
+ */
+
+static int benchPolicy (const char *devname, uint32_t policy)
+{
+  unsigned char buf[CLUSTER_SIZE];               /* buffer of the accesses */
+  uint32_t nBlocks;                              /* number of blocks of the storage device */
+  uint32_t dataStart;                            /* first block of the clusters */
+  uint32_t nStream;                              /* number of clusters of the large file */
+  uint32_t sBlock = 0, sCluster = 0;             /* position of the streaming accesses */
+  uint32_t i, k;                                 /* counting variables */
+  uint64_t metaMiss = 0, streamMiss = 0, reads;  /* number of misses / reads of the device before an access */
+  int stat = 0;                                  /* status of operation */
+
+  if ((stat = soGetDeviceSize (devname, &nBlocks)) != 0) return stat;
+  dataStart = TABLE_BLOCKS + 1;
+  if (nBlocks < dataStart + (HOT_CLUSTERS + STREAM_MIN) * BLOCKS_PER_CLUSTER)
+     return -EFBIG;                              /* the support file is too small */
+  nStream = (nBlocks - dataStart) / BLOCKS_PER_CLUSTER - HOT_CLUSTERS;
+
+  if (((stat = soSetBufferCacheMode (DEV_UNSAFE | DEV_PREAD)) != 0) ||
+      ((stat = soSetBufferCachePolicy (policy)) != 0) ||
+      ((stat = soOpenBufferCache (devname, BUF)) != 0))
+     return stat;
+
+  for (i = 0; i < META_ACCESSES; i++)
+  { /* an access to the metadata working set */
+
+    reads = rawReads ();
+    k = nextRand ();
+    if (k & 1)
+       stat = soReadCacheBlock (1 + (k >> 1) % HOT_BLOCKS, buf);
+       else stat = soReadCacheCluster (dataStart + ((k >> 1) % HOT_CLUSTERS) * BLOCKS_PER_CLUSTER, buf);
+    if (stat != 0) break;
+    metaMiss += rawReads () - reads;
+
+    /* streaming accesses */
+
+    if ((i % STREAM_EVERY) != 0) continue;
+    reads = rawReads ();
+    if (((stat = soReadCacheBlock (1 + sBlock, buf)) != 0) ||
+        ((stat = soReadCacheCluster (dataStart + (HOT_CLUSTERS + sCluster) * BLOCKS_PER_CLUSTER, buf)) != 0))
+       break;
+    sBlock = (sBlock + 1) % TABLE_BLOCKS;
+    sCluster = (sCluster + 1) % nStream;
+    streamMiss += rawReads () - reads;
+  }
+
+  if (stat != 0)
+     { soCloseBufferCache ();
+       soSetBufferCachePolicy (CACHE_LRU);
+       return stat;
+     }
+  if ((stat = soCloseBufferCache ()) != 0) return stat;
+  soSetBufferCachePolicy (CACHE_LRU);
+
+  k = 2 * ((META_ACCESSES + STREAM_EVERY - 1) / STREAM_EVERY);      /* number of streaming accesses */
+  printf ("%8s %10.2f %10.2f %10.2f\n", (policy == CACHE_2Q) ? "2Q" : "LRU",
+          100.0 - 100.0 * metaMiss / META_ACCESSES, 100.0 - 100.0 * streamMiss / k,
+          100.0 - 100.0 * (metaMiss + streamMiss) / (META_ACCESSES + k));
+
+  return 0;
+}
+
+/*
+ *  Run the write workload on the buffercache for a given durability mode and print a line of results.
+ */
+
+static int benchWrite (const char *devname, uint32_t mode)
+{
+  uint32_t nBlocks;                              /* number of blocks of the storage device */
+  uint32_t nClusters;                            /* number of clusters written per measurement */
+  uint64_t tOnce, tFreq;                         /* elapsed times */
+  int stat;                                      /* status of operation */
+
+  if ((stat = soGetDeviceSize (devname, &nBlocks)) != 0) return stat;
+  if (nBlocks < 1 + SYNC_EVERY * BLOCKS_PER_CLUSTER)
+     return -EFBIG;                              /* the support file is too small */
+  nClusters = (nBlocks - 1) / BLOCKS_PER_CLUSTER;
+  if (nClusters > WRITE_MAX) nClusters = WRITE_MAX;
+
+  if (((stat = soSetBufferCacheMode (mode | DEV_PREAD)) != 0) || ((stat = soOpenBufferCache (devname, BUF)) != 0))
+     return stat;
+  if (((stat = writeClusters (nClusters, nClusters, &tOnce)) != 0) ||
+      ((stat = writeClusters (nClusters, SYNC_EVERY, &tFreq)) != 0))
+     { soCloseBufferCache ();
+       soSetBufferCacheMode (DEV_SYNC);
+       return stat;
+     }
+  if ((stat = soCloseBufferCache ()) != 0) return stat;
+  soSetBufferCacheMode (DEV_SYNC);
+
+  printf ("%10s %10.1f %10.1f\n", (mode == DEV_SYNC) ? "sync" : ((mode == DEV_DATASYNC) ? "datasync" : "unsafe"),
+          1e3 * nClusters * CLUSTER_SIZE / tOnce, 1e3 * nClusters * CLUSTER_SIZE / tFreq);
+
+  return 0;
+}
+
+/*
+ *  Write a number of clusters sequentially from the beginning of the device, synchronizing the buffercache every given
+ *  number of them and at the end.
+ */
+
+static int writeClusters (uint32_t nClusters, uint32_t syncEvery, uint64_t *p_ns)
+{
+  unsigned char buf[CLUSTER_SIZE];               /* buffer of the accesses */
+  uint32_t i;                                    /* counting variable */
+  uint64_t t0;                                   /* clock reading */
+  int stat;                                      /* status of operation */
+
+  memset (buf, 0xA5, CLUSTER_SIZE);
+  t0 = clockNs ();
+  for (i = 0; i < nClusters; i++)
+  { if ((stat = soWriteCacheCluster (1 + i * BLOCKS_PER_CLUSTER, buf)) != 0) return stat;
+    if ((((i + 1) % syncEvery) == 0) && ((stat = soSyncBufferCache ()) != 0)) return stat;
+  }
+  if ((stat = soSyncBufferCache ()) != 0) return stat;
+  *p_ns = clockNs () - t0;
+
+  return 0;
+}
+
+/*
+ *  Number of reads of the storage device, blocks and clusters, carried out so far.
+ */
+
+static uint64_t rawReads (void)
+{
+  SORawStats st;                                 /* transfer statistics of the storage device */
+
+  soGetRawStats (&st);
+
+  return st.kind[RAW_BLOCK_READ].ops + st.kind[RAW_CLUSTER_READ].ops;
+}
+
+/*
+ *  Look up a block by traversing the double-linked list based on the physical block number.
+ */
+
+static SOBufferCacheNode *searchList (uint32_t nBlock, SOBufferCacheNode *head)
+{
+  for (; head != NULL; head = head->n_next)
+    if (head->n == nBlock) break;
+
+  return head;
+}
+
+/*
+ *  Block stored in the i-th node of the storage area (blocks are spread, the following one is never stored).
+ */
+
+static uint32_t blockOf (uint32_t i)
+{
+  return 3 * i;
+}
+
+/*
+ *  Generate a pseudo-random number (xorshift, so that runs are reproducible).
+ */
+
+static uint32_t nextRand (void)
+{
+  seed ^= seed << 13;
+  seed ^= seed >> 17;
+  seed ^= seed << 5;
+
+  return seed;
+}
+
+/*
+ *  Read the monotonic clock in nanoseconds.
+ */
+
+static uint64_t clockNs (void)
+{
+  struct timespec ts;                            /* clock reading */
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+
+  return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/*
+ * print help message
+ */
+
+static void printUsage (char *cmd_name)
+{
+  printf ("Sinopsis: %s [OPTIONS]\n"
+          "  OPTIONS:\n"
+          "  -n nodes      --- size of the storage area, it may be repeated (default: 1024, 65536 and 1048576)\n"
+          "  -l lookups    --- number of look ups of each kind (default: 1000000)\n"
+          "  -p supp-file  --- measure the hit ratio of the replacement policies on the support file\n"
+          "  -w supp-file  --- measure the write throughput of the durability modes on the support file\n"
+          "  -h            --- print this help\n", cmd_name);
+}
+
+/*
+ * print error message
+ */
+
+static void printError (int errcode, char *cmd_name)
+{
+  fprintf(stderr, "%s: error #%d - %s.\n", cmd_name, -errcode, strerror (-errcode));
+}
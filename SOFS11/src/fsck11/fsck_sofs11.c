@@ -5,6 +5,7 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <stdio.h>
+#include <string.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <errno.h>
@@ -29,7 +30,6 @@ main (int argc, char **argv)
   char *logfile_path = NULL;
   char *diskfile_path = NULL;
   FILE *logfile;
-  struct stat st;
   SOSuperBlock *p_sb;
   int status, error = 0;
   uint32_t ntotal;       /* total number of blocks */
@@ -63,22 +63,23 @@ main (int argc, char **argv)
       return EXIT_FAILURE;
     }
 
-  /* Getting file size */
-  if (stat(diskfile_path, &st) == -1)
+  /* Getting the device size (a single file or a stripe set), which must be a multiple of BLOCK_SIZE */
+  if ((status = soGetDeviceSize (diskfile_path, &ntotal)) == -ELIBBAD)
     {
-        perror("stat");
-        return EXIT_FAILURE;
+      fprintf (stderr, "%s: Bad size of support file.\n", basename(argv[0]) );
+      return EXIT_FAILURE;
     }
-
-  /* Check whether the file size is a multiple of BLOCK_SIZE */
-  if (st.st_size % BLOCK_SIZE != 0)
+  if (status != 0)
     {
-      fprintf (stderr, "%s: Bad size of support file.\n", basename(argv[0]) );
+      fprintf (stderr, "%s: %s\n", basename(argv[0]), strerror (-status));
       return EXIT_FAILURE;
     }
 
-  /* Opening a buffered communication channel with the storage device */
-  if ((status = soOpenBufferCache (diskfile_path, BUF)) != 0)
+  /* Opening a buffered communication channel with the storage device, which is mapped in main memory
+   * (the check only reads metadata, so misses in the buffercache are served by memory copies)
+   */
+  if (((status = soSetBufferCacheMode (DEV_SYNC | DEV_MMAP)) != 0) ||
+      ((status = soOpenBufferCache (diskfile_path, BUF)) != 0))
     {
       printf("Failed opening buffered communication channel.\n");
       return EXIT_FAILURE;
@@ -145,8 +146,6 @@ main (int argc, char **argv)
   fprintf(logfile, "Checking super block data zone metadata integrity...\t");
   fflush(stdout);
 
-  ntotal = st.st_size / BLOCK_SIZE;
-
   if ( (error = fsckCheckDZoneMetaData (p_sb, ntotal)) != FSCKOK )
     {
       processError(logfile, error);
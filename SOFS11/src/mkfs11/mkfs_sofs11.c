@@ -19,6 +19,7 @@
  *                OPTIONS:
  *                 -n name --- set volume name (default: "SOFS10")
  *                 -i num  --- set number of inodes (default: N/8, where N = number of blocks)
+ *                 -S spec --- simulate a slower device, spec is lat:bw:seek (default: no simulation)
  *                 -z      --- set zero mode (default: not zero)
  *                 -q      --- set quiet mode (default: not quiet)
  *                 -h      --- print this help.</PRE>
@@ -68,13 +69,14 @@ int main (int argc, char *argv[])
   uint32_t itotal = 0;                           /* total number of inodes, if kept set value automatically */
   int quiet = 0;                                 /* quiet mode, if kept set not quiet mode */
   int zero = 0;                                  /* zero mode, if kept set not zero mode */
+  SORawSimulation sim;                           /* parameters of the simulated device */
 
   /* process command line options */
 
   int opt;                                       /* selected option */
 
   do
-    { switch ((opt = getopt (argc, argv, "n:i:qzh")))
+    { switch ((opt = getopt (argc, argv, "n:i:S:qzh")))
         { case 'n': /* volume name */
             name = optarg;
             break;
@@ -86,6 +88,13 @@ int main (int argc, char *argv[])
             }
           itotal = (uint32_t) atoi (optarg);
           break;
+        case 'S': /* simulated device */
+          if ((soParseRawSimulation (optarg, &sim) != 0) || (soSetRawSimulation (&sim) != 0))
+            { fprintf (stderr, "%s: Bad argument to S option.\n", basename (argv[0]));
+              printUsage (basename (argv[0]));
+              return EXIT_FAILURE;
+            }
+          break;
         case 'q': /* quiet mode */
           quiet = 1;                       /* set quiet mode for processing: no messages are issued */
           break;
@@ -111,17 +120,18 @@ int main (int argc, char *argv[])
   /* check for storage device conformity */
 
   char *devname;                                 /* path to the storage device in the Linux file system */
-  struct stat st;                                /* file attributes */
+  uint32_t ntotal;                               /* total number of blocks */
+  int status;                                    /* status of operation */
 
   devname = argv[optind];
-  if (stat (devname, &st) == -1)                 /* get file attributes */
-    { printError (-errno, basename (argv[0]));
-      return EXIT_FAILURE;
-    }
-
-  if (st.st_size % BLOCK_SIZE != 0)              /* check file size: the storage device must have a size in bytes
-                                                    multiple of block size */
-    { fprintf (stderr, "%s: Bad size of support file.\n", basename (argv[0]));
+  if ((status = soGetDeviceSize (devname, &ntotal)) != 0)
+    { if (status == -ELIBBAD)                    /* the storage device must have a size in bytes multiple of block
+                                                    size (or be a well formed stripe set) */
+         fprintf (stderr, "%s: Bad size of support file.\n", basename (argv[0]));
+         else if (status == -EFBIG)              /* block numbers are 32-bit wide */
+                 fprintf (stderr, "%s: Support file too large (at most %"PRIu32" blocks).\n", basename (argv[0]),
+                          UINT32_MAX);
+                 else printError (status, basename (argv[0]));
       return EXIT_FAILURE;
     }
 
@@ -139,11 +149,9 @@ int main (int argc, char *argv[])
    * this is not always true, so a final adjustment may be made to the parameter NBlkTIN to warrant this
    */
 
-  uint32_t ntotal;                               /* total number of blocks */
   uint32_t iblktotal;                            /* number of blocks of the inode table */
   uint32_t nclusttotal;                          /* total number of clusters */
 
-  ntotal = st.st_size / BLOCK_SIZE;
   if (itotal == 0) itotal = ntotal >> 3;
   if ((itotal % IPB) == 0)
     iblktotal = itotal / IPB;
@@ -156,14 +164,16 @@ int main (int argc, char *argv[])
   /* formatting of the storage device is going to start */
 
   SOSuperBlock *p_sb;                            /* pointer to the superblock */
-  int status;                                    /* status of operation */
 
   if (!quiet)
     printf("\e[34mInstalling a %"PRIu32"-inodes SOFS11 file system in %s.\e[0m\n", itotal, argv[optind]);
 
-  /* open a buffered communication channel with the storage device */
+  /* open a buffered communication channel with the storage device;
+   * formatting is a batch operation, so the device needs only to be synchronized when the channel is closed
+   */
 
-  if ((status = soOpenBufferCache (argv[optind], BUF)) != 0)
+  if (((status = soSetBufferCacheMode (DEV_DATASYNC)) != 0) ||
+      ((status = soOpenBufferCache (argv[optind], BUF)) != 0))
     { printError (status, basename (argv[0]));
       return EXIT_FAILURE;
     }
@@ -296,6 +306,8 @@ static void printUsage (char *cmd_name)
           "  OPTIONS:\n"
           "  -n name --- set volume name (default: \"SOFS11\")\n"
           "  -i num  --- set number of inodes (default: N/8, where N = number of blocks)\n"
+          "  -S spec --- simulate a slower device, spec is lat:bw:seek (default: no simulation)\n"
+          "              lat in microseconds, bw in MB/s, seek in nanoseconds per block\n"
           "  -z      --- set zero mode (default: not zero)\n"
           "  -q      --- set quiet mode (default: not quiet)\n"
           "  -h      --- print this help\n", cmd_name);
@@ -326,6 +338,9 @@ static int fillInSuperBlock (SOSuperBlock *p_sb, uint32_t ntotal, uint32_t itota
   if((ntotal < 0) || (itotal < 0) || (nclusttotal < 0))
     return -1;
 
+  /** Clearing the whole block, so no stale device contents end up in unused fields **/
+  memset(p_sb, 0, BLOCK_SIZE);
+
   /**Filling Header Data **/
   p_sb->magic = 0xFFFF;						/*file system identification number - presently set to 0xFFFF*/
   p_sb->version = VERSION_NUMBER;				/*version number*/
@@ -12,7 +12,28 @@
                    -d       --- set debugging mode (default: no debugging)
                    -l depth --- set log depth (default: 0,0)
                    -L file  --- log file (default: stdout)
-                   -h       --- print this help.</PRE>
+                   -o opts  --- comma separated list of mount options
+                   -h       --- print this help.
+
+                  MOUNT OPTIONS:
+                   durability=sync     --- every write back of the buffercache reaches stable storage (default)
+                   durability=datasync --- data reaches stable storage on fsync, flush and unmount
+                   durability=unsafe   --- data never forced to stable storage (benchmarking only)
+                   backend=pread       --- requests are carried out one at a time (default)
+                   backend=mmap        --- the device is mapped in main memory
+                   direct              --- bypass the host page cache (not with backend=mmap)
+                   sim=lat:bw:seek     --- simulate a slower device: latency (us), bandwidth (MB/s), seek (ns per block)
+                   cache=lru           --- the least recently accessed block (cluster) is replaced first (default)
+                   cache=2q            --- blocks (clusters) accessed only once are replaced first (scan-resistant)
+                   flush=ratio:age     --- write back changed blocks (clusters) in the background, when more than
+                                           ratio % of them are changed or a change is older than age ms (default: 0:0,
+                                           never)
+                   cache_mb=size       --- size of the buffercache in MiB, shrunk while main memory is scarce
+                                           (default: 0, a small fixed buffercache)
+                   check=paranoid      --- check the metadata whenever it is used (default)
+                   check=mount         --- check the metadata at mount time and whenever it is loaded into internal
+                                           storage
+                   check=off           --- never check the metadata (benchmarking only)</PRE>
  *
  *  \author Artur Carneiro Pereira - October 2005
  *  \author Miguel Oliveira e Silva - September 2009
@@ -12,7 +12,33 @@
                    -d       --- set debugging mode (default: no debugging)
                    -l depth --- set log depth (default: 0,0)
                    -L file  --- log file (default: stdout)
-                   -h       --- print this help.</PRE>
+                   -o opts  --- comma separated list of mount options
+                   -h       --- print this help.
+
+                  MOUNT OPTIONS:
+                   durability=sync     --- every write back of the buffercache reaches stable storage (default)
+                   durability=datasync --- data reaches stable storage on fsync, flush and unmount
+                   durability=unsafe   --- data never forced to stable storage (benchmarking only)
+                   backend=pread       --- requests are carried out one at a time (default)
+                   backend=mmap        --- the device is mapped in main memory
+                   direct              --- bypass the host page cache (not with backend=mmap)
+                   sim=lat:bw:seek     --- simulate a slower device: latency (us), bandwidth (MB/s), seek (ns per block)
+                   cache=lru           --- the least recently accessed block (cluster) is replaced first (default)
+                   cache=2q            --- blocks (clusters) accessed only once are replaced first (scan-resistant)
+                   flush=ratio:age     --- write back changed blocks (clusters) in the background, when more than
+                                           ratio % of them are changed or a change is older than age ms (default: 0:0,
+                                           never)
+                   cache_mb=size       --- size of the buffercache in MiB, shrunk while main memory is scarce
+                                           (default: 0, a small fixed buffercache)
+                   check=paranoid      --- check the metadata whenever it is used (default)
+                   check=mount         --- check the metadata at mount time and whenever it is loaded into internal
+                                           storage
+                   check=off           --- never check the metadata (benchmarking only)</PRE>
+ *
+ *  The statistics of accesses to the buffercache and of the writing back of its changed nodes (how often a request
+ *  had to write back a changed node itself and how much the flusher wrote) are printed on stderr when SIGUSR1 is
+ *  received and on unmount.
+ *  If the size of the buffercache is set, it is halved while main memory is scarce and grown back afterwards.
  *
  *  \author Artur Carneiro Pereira - October 2005
  *  \author Miguel Oliveira e Silva - September 2009
@@ -26,14 +52,20 @@
 #include <unistd.h>
 #include <libgen.h>
 #include <pthread.h>
+#include <semaphore.h>
+#include <signal.h>
 #include <errno.h>
 #include <string.h>
+#include <time.h>
 #include <fuse.h>
 #include <fuse/fuse.h>
 
 #include "sofs_probe.h"
 #include "sofs_const.h"
+#include "sofs_rawdisk.h"
+#include "sofs_buffercache.h"
 #include "sofs_direntry.h"
+#include "sofs_basicoper.h"
 #include "sofs_syscalls.h"
 
 /*
@@ -79,6 +111,12 @@ static int sofs_getxattr (const char *ePath, const char *name, char *value, size
 static int sofs_listxattr (const char *ePath, char *list, size_t size);
 static int sofs_removexattr (const char *ePath, const char *name);
 static void printUsage (char *cmd_name);
+static void statsRequest (int sig);
+static void *cacheKeeper (void *arg);
+static void printCacheStats (void);
+static int memoryAvailable (void);
+static int parseMountOptions (char *opts, uint32_t *p_mode, uint32_t *p_policy, uint32_t *p_ratio, uint32_t *p_age,
+                              uint32_t *p_size, SORawSimulation *p_sim, uint32_t *p_check);
 
 /*
  *  Set of FUSE operations (required by the FUSE filesystem)
@@ -122,6 +160,48 @@ static struct fuse_operations fuse_operations = {.getattr     = sofs_getattr,
 
 static char *sofs_supp_file = NULL;
 
+/* Operating mode of the storage device */
+
+static uint32_t sofs_mode = DEV_SYNC;
+
+/* Replacement policy of the buffercache */
+
+static uint32_t sofs_policy = CACHE_LRU;
+
+/* Thresholds of the flusher thread of the buffercache: percentage of changed nodes and age of a change in ms (all
+   zero: no flusher) */
+
+static uint32_t sofs_ratio = 0;
+static uint32_t sofs_age = 0;
+
+/* Size of the buffercache in MiB (zero: not set) */
+
+static uint32_t sofs_cache = 0;
+
+/* Percentages of main memory available below which the buffercache is shrunk and above which it is grown back */
+
+#define MEM_LOW   (10)
+#define MEM_HIGH  (25)
+
+/* Parameters of the simulated storage device (all zero: no simulation) */
+
+static SORawSimulation sofs_sim = { 0, 0, 0 };
+
+/* Consistency-check level of the metadata */
+
+static uint32_t sofs_check = CHECK_PARANOID;
+
+/* Requests to print the statistics of accesses to the buffercache (posted on SIGUSR1) or to stop the thread keeping
+   the buffercache (posted on unmount) */
+
+static sem_t sofs_stats;
+
+/* Thread keeping the buffercache, whether it was started and whether it was asked to stop */
+
+static pthread_t sofs_keeper;
+static int sofs_keeper_on = 0;
+static int sofs_keeper_stop = 0;
+
 /* The main function */
 
 int main(int argc, char *argv[])
@@ -136,7 +216,7 @@ int main(int argc, char *argv[])
   int opt;                                       /* selected option */
 
   do
-  { switch ((opt = getopt (argc, argv, "l:L:dh")))
+  { switch ((opt = getopt (argc, argv, "l:L:o:dh")))
     { case 'l': /* log depth */
                 if (sscanf (optarg, "%d,%d", &lower, &higher) != 2)
                    { fprintf (stderr, "%s: Bad argument to l option.\n", basename (argv[0]));
@@ -153,6 +233,14 @@ int main(int argc, char *argv[])
                    }
                 soOpenProbe (fl);
                 break;
+      case 'o': /* mount options */
+                if (parseMountOptions (optarg, &sofs_mode, &sofs_policy, &sofs_ratio, &sofs_age, &sofs_cache,
+                                       &sofs_sim, &sofs_check) != 0)
+                   { fprintf (stderr, "%s: Bad argument to o option.\n", basename (argv[0]));
+                     printUsage (basename (argv[0]));
+                     return EXIT_FAILURE;
+                   }
+                break;
       case 'd': /* debugging mode */
                 debug_mode = 1;                  /* set debugging mode for processing: no FUSE messages are issued */
                 break;
@@ -182,6 +270,15 @@ int main(int argc, char *argv[])
      fl = stdout;                                /* if the switch -L was not used, set output to stdout */
      else stderr = fl;                           /* if the switch -L was used, set stderr to log file */
 
+  soSetRawSimulation (&sofs_sim);
+  soSetCheckLevel (sofs_check);
+  soSetBufferCachePolicy (sofs_policy);
+  soSetBufferCacheFlusher (sofs_ratio, sofs_age);
+  if (soSetBufferCacheSize (sofs_cache) != 0)
+     { fprintf (stderr, "%s: Bad size of the buffercache.\n", basename (argv[0]));
+       return EXIT_FAILURE;
+     }
+
   /* build argv and argc for fuse_main */
 
   char *fuse_argv[] = {argv[0], argv[optind+1], "-o", "nonempty", "-d"};
@@ -201,7 +298,189 @@ static void printUsage (char *cmd_name)
           "  -d       --- set debugging mode (default: no debugging)\n"
           "  -l depth --- set log depth (default: 0,0)\n"
           "  -L file  --- log file (default: stdout)\n"
-          "  -h       --- print this help\n", cmd_name);
+          "  -o opts  --- comma separated list of mount options\n"
+          "  -h       --- print this help\n"
+          "  MOUNT OPTIONS:\n"
+          "  durability=sync     --- every write back of the buffercache reaches stable storage (default)\n"
+          "  durability=datasync --- data reaches stable storage on fsync, flush and unmount\n"
+          "  durability=unsafe   --- data never forced to stable storage (benchmarking only)\n"
+          "  backend=pread       --- requests are carried out one at a time (default)\n"
+          "  backend=mmap        --- the device is mapped in main memory\n"
+          "  direct              --- bypass the host page cache (not with backend=mmap)\n"
+          "  sim=lat:bw:seek     --- simulate a slower device: latency (us), bandwidth (MB/s), seek (ns per block)\n"
+          "  cache=lru           --- the least recently accessed block (cluster) is replaced first (default)\n"
+          "  cache=2q            --- blocks (clusters) accessed only once are replaced first (scan-resistant)\n"
+          "  flush=ratio:age     --- write back changed blocks (clusters) in the background, when more than ratio %%\n"
+          "                          of them are changed or a change is older than age ms (default: 0:0, never)\n"
+          "  cache_mb=size       --- size of the buffercache in MiB, shrunk while main memory is scarce (default: 0,\n"
+          "                          a small fixed buffercache)\n"
+          "  check=paranoid      --- check the metadata whenever it is used (default)\n"
+          "  check=mount         --- check the metadata at mount time and whenever it is loaded into internal storage\n"
+          "  check=off           --- never check the metadata (benchmarking only)\n"
+          "  SIGNALS:\n"
+          "  SIGUSR1             --- print the statistics of accesses to the buffercache on stderr\n",
+          cmd_name);
+}
+
+/*
+ * request the printing of the statistics of accesses to the buffercache (only async-signal-safe calls are allowed)
+ */
+
+static void statsRequest (int sig)
+{
+  sem_post (&sofs_stats);
+}
+
+/*
+ * print the statistics of accesses to the buffercache, on request, write the in-core inodes and the superblock back,
+ * if they were changed, and resize the buffercache following the main memory available, until asked to stop
+ */
+
+static void *cacheKeeper (void *arg)
+{
+  sigset_t all;
+  struct timespec ts;
+  uint32_t size = sofs_cache;                    /* current size of the buffercache */
+  int avail;
+
+  sigfillset (&all);
+  pthread_sigmask (SIG_BLOCK, &all, NULL);       /* the signals are handled by the other threads */
+  while (1)
+  { clock_gettime (CLOCK_REALTIME, &ts);
+    ts.tv_sec += 1;
+    if (sem_timedwait (&sofs_stats, &ts) == 0)
+       { if (sofs_keeper_stop) break;            /* the file system is being unmounted */
+         printCacheStats ();
+         fflush (stderr);
+         continue;
+       }
+    if (errno != ETIMEDOUT) continue;
+
+    /* write the in-core inodes and the superblock back, once a second at most, as their writing is deferred while the
+       file system is mounted */
+
+    pthread_mutex_lock (&accessCR);                                  /* enter critical region */
+    soSyncInodes ();
+    soSyncSuperBlock ();
+    pthread_mutex_unlock (&accessCR);                                /* exit critical region */
+
+    if ((sofs_cache == 0) || ((avail = memoryAvailable ()) < 0)) continue;
+
+    /* resize the buffercache following the main memory available */
+
+    if ((avail < MEM_LOW) && (size > 1))
+       { size /= 2;
+         soResizeBufferCache (size);
+       }
+       else if ((avail > MEM_HIGH) && (size < sofs_cache))
+               { size = (2 * size < sofs_cache) ? 2 * size : sofs_cache;
+                 soResizeBufferCache ((size == sofs_cache) ? 0 : size);
+               }
+  }
+
+  return NULL;
+}
+
+/*
+ * print the statistics of accesses to the buffercache and of the writing back of changed nodes on stderr
+ */
+
+static void printCacheStats (void)
+{
+  SOBufferCacheFlushStats fs;
+
+  soPrintBufferCacheStats (stderr);
+  if (soGetBufferCacheFlushStats (&fs) == 0)
+     fprintf (stderr, "Buffercache write back\n"
+              "   foreground    %"PRIu64" requests had to write back a changed node before replacing it\n"
+              "   flusher       %"PRIu64" rounds, %"PRIu64" runs, %"PRIu64" nodes, %"PRIu64" failed runs\n"
+              "   changed now   %"PRIu64" nodes\n", fs.evictions, fs.rounds, fs.runs, fs.nodes, fs.errors, fs.changed);
+}
+
+/*
+ * get the percentage of main memory available (without swapping)
+ */
+
+static int memoryAvailable (void)
+{
+  FILE *fp;
+  char line[128];
+  unsigned long long total = 0, avail = 0, val;
+
+  if ((fp = fopen ("/proc/meminfo", "r")) == NULL) return -1;
+  while (fgets (line, sizeof (line), fp) != NULL)
+    if (sscanf (line, "MemTotal: %llu", &val) == 1) total = val;
+       else if (sscanf (line, "MemAvailable: %llu", &val) == 1) avail = val;
+  fclose (fp);
+
+  return (total == 0) ? -1 : (int) (100 * avail / total);
+}
+
+/*
+ * parse the mount options
+ */
+
+static int parseMountOptions (char *opts, uint32_t *p_mode, uint32_t *p_policy, uint32_t *p_ratio, uint32_t *p_age,
+                              uint32_t *p_size, SORawSimulation *p_sim, uint32_t *p_check)
+{
+  enum { DURABILITY = 0, BACKEND, DIRECT, SIM, CACHE, FLUSH, CACHE_MB, CHECK };
+  char *const tokens[] = { [DURABILITY] = "durability", [BACKEND] = "backend", [DIRECT] = "direct", [SIM] = "sim",
+                           [CACHE] = "cache", [FLUSH] = "flush", [CACHE_MB] = "cache_mb", [CHECK] = "check", NULL };
+  char *value;
+  int len;
+
+  while (*opts != '\0')
+    switch (getsubopt (&opts, tokens, &value))
+    { case DURABILITY:
+        if (value == NULL) return -EINVAL;
+        *p_mode &= ~DEV_DURABILITY;
+        if (strcmp (value, "sync") == 0) *p_mode |= DEV_SYNC;
+           else if (strcmp (value, "datasync") == 0) *p_mode |= DEV_DATASYNC;
+           else if (strcmp (value, "unsafe") == 0) *p_mode |= DEV_UNSAFE;
+           else return -EINVAL;
+        break;
+      case BACKEND:
+        if (value == NULL) return -EINVAL;
+        *p_mode &= ~DEV_BACKEND;
+        if (strcmp (value, "pread") == 0) *p_mode |= DEV_PREAD;
+           else if (strcmp (value, "mmap") == 0) *p_mode |= DEV_MMAP;
+           else return -EINVAL;
+        break;
+      case DIRECT:
+        if (value != NULL) return -EINVAL;
+        *p_mode |= DEV_DIRECT;
+        break;
+      case SIM:
+        if ((value == NULL) || (soParseRawSimulation (value, p_sim) != 0)) return -EINVAL;
+        break;
+      case CACHE:
+        if (value == NULL) return -EINVAL;
+        if (strcmp (value, "lru") == 0) *p_policy = CACHE_LRU;
+           else if (strcmp (value, "2q") == 0) *p_policy = CACHE_2Q;
+           else return -EINVAL;
+        break;
+      case FLUSH:
+        if ((value == NULL) || (sscanf (value, "%"SCNu32":%"SCNu32"%n", p_ratio, p_age, &len) != 2) ||
+            (value[len] != '\0') || (*p_ratio > 100))
+           return -EINVAL;
+        break;
+      case CACHE_MB:
+        if ((value == NULL) || (sscanf (value, "%"SCNu32"%n", p_size, &len) != 1) || (value[len] != '\0') ||
+            (*p_size > CACHE_MAX_SIZE))
+           return -EINVAL;
+        break;
+      case CHECK:
+        if (value == NULL) return -EINVAL;
+        if (strcmp (value, "paranoid") == 0) *p_check = CHECK_PARANOID;
+           else if (strcmp (value, "mount") == 0) *p_check = CHECK_MOUNT;
+           else if (strcmp (value, "off") == 0) *p_check = CHECK_OFF;
+           else return -EINVAL;
+        break;
+      default:
+        return -EINVAL;
+    }
+
+  return 0;
 }
 
 /* Functions to be implemented */
@@ -224,8 +503,21 @@ static void *sofs_mount (struct fuse_conn_info* fci)
   soColorProbe (11, "07;31", "sofs_mount_bin ()\n");
 
   int stat;
+  struct sigaction sa;
+
+  if ((stat = soMountSOFS (sofs_supp_file, sofs_mode)) != 0) return NULL;
+
+  /* print the statistics of the buffercache on SIGUSR1 and resize it following the main memory available */
+
+  if ((sem_init (&sofs_stats, 0, 0) == 0) && (pthread_create (&sofs_keeper, NULL, cacheKeeper, NULL) == 0))
+     { sofs_keeper_on = 1;
+       memset (&sa, 0, sizeof (sa));
+       sa.sa_handler = statsRequest;
+       sigemptyset (&sa.sa_mask);
+       sa.sa_flags = SA_RESTART;
+       sigaction (SIGUSR1, &sa, NULL);
+     }
 
-  if ((stat = soMountSOFS (sofs_supp_file)) != 0) return NULL;
   return sofs_supp_file;
 }
 
@@ -243,9 +535,24 @@ static void sofs_unmount (void *path)
 {
   soColorProbe (12, "07;31", "sofs_unmount_bin (\"%s\")\n", (char *) path);
 
+  uint64_t stores, writes;                       /* store operations on and writes of the superblock */
+  uint64_t checks, ns;                           /* consistency checks and CPU time taken by them */
+
+  if (sofs_keeper_on)                            /* the buffercache must not be kept once it is closed */
+     { sofs_keeper_stop = 1;
+       sem_post (&sofs_stats);
+       pthread_join (sofs_keeper, NULL);
+       sofs_keeper_on = 0;
+     }
+
   pthread_mutex_lock (&accessCR);                                    /* enter critical region */
 
   soUnmountSOFS ();
+  printCacheStats ();
+  if (soGetSuperBlockStats (&stores, &writes) == 0)
+     fprintf (stderr, "superblock: %"PRIu64" stores, %"PRIu64" writes\n", stores, writes);
+  if (soGetCheckStats (&checks, &ns) == 0)
+     fprintf (stderr, "consistency checks: %"PRIu64", %.3f ms of CPU time\n", checks, ns / 1e6);
 
   pthread_mutex_unlock (&accessCR);                                  /* exit critical region */
 }
@@ -752,6 +1059,10 @@ static int sofs_write (const char *ePath, const char *buff, size_t count, off_t
  *
  *  Filesystems shouldn't assume that flush will always be called after some writes, or that if will be called at all.
  *
+ *  The file is only synchronized in the DEV_DATASYNC durability mode, where closing a file is a synchronization point.
+ *  In the DEV_SYNC mode, written data reaches stable storage as the buffercache writes it back (or on fsync), and in
+ *  the DEV_UNSAFE mode it is never forced there.
+ *
  *  \remarks Changed in version 2.2.
  *
  *  \param ePath path to the file
@@ -764,7 +1075,20 @@ static int sofs_flush (const char *ePath, struct fuse_file_info *fi)
 {
   soColorProbe(29, "07;31", "sofs_flush_bin (\"%s\", %p)\n", ePath, fi);
 
-  return 0;
+  int stat;
+
+  if ((sofs_mode & DEV_DURABILITY) != DEV_DATASYNC)                  /* only then does closing force the data out */
+     return 0;
+
+  if (pthread_mutex_lock (&accessCR) != 0)                           /* enter critical region */
+     return -ENOLCK;
+
+  stat = soFsync (ePath);
+
+  if (pthread_mutex_unlock (&accessCR) != 0)                         /* exit critical region */
+     return -ENOLCK;
+
+  return stat;
 }
 
 /**
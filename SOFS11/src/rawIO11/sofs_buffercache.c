@@ -0,0 +1,2840 @@
+/**
+ *  \file sofs_buffercache.c (implementation file)
+ *
+ *  \brief Access to buffered/unbuffered raw disk blocks and clusters.
+ *
+ *  The buffercache may be regarded as a storage area resident in main memory having the ability to store K data blocks
+ *  and L data clusters of the device's storage space.
+ *  Clusters are stored as a whole, in nodes of their own, so that accessing a stored cluster takes a single look up and
+ *  a miss a single transfer from the storage device. Blocks which are accessed on their own (the superblock and the
+ *  table of inodes) are stored in nodes of a block size. A block is never stored twice: a block of a stored cluster is
+ *  accessed in place and the blocks of a cluster which is going to be stored are absorbed by it.
+ *  Under the 2Q policy, each pool keeps, besides the list based on the last access time (Am), a first-in first-out
+ *  queue of the nodes accessed only once (A1in) and a ring of the blocks (clusters) last replaced from it (A1out),
+ *  which are remembered by ghost entries of the index.
+ *  A flusher thread may write back the changed nodes in the background, when there are too many of them or they were
+ *  changed long ago, so that a request seldom has to write back a node to get a free one. It writes them in ascending
+ *  order of the physical block number, contiguous nodes in a single transfer, and holds a shard for at most FLUSH_RUN
+ *  nodes at a time. Likewise, on synchronization and unassignment, all the changed nodes are sorted and written back in
+ *  runs of contiguous blocks (clusters), each run by a single vectored write.
+ *  The storage area is split in NSHARDS shards, each one with its own lock, index and pools (and so its own lists based
+ *  on the last access time), so that concurrent callers seldom wait for each other. A node belongs to the shard which
+ *  the hash of the group of BLOCKS_PER_CLUSTER blocks of its (first) block selects. An operation locks, in ascending
+ *  order, the shards of all the nodes which may hold the blocks it accesses: one or two, as a cluster of the data zone
+ *  may span two groups, and a few more, to read ahead. The storage device, which can not be accessed concurrently, is
+ *  locked on its own, only while a transfer is carried out, so that hits are never kept waiting by transfers of other
+ *  shards.
+ *  Sequential reading of clusters is detected: for each of the last RA_STREAMS streams of successive clusters, a
+ *  readahead window is kept, which doubles with every sequential access up to RA_MAX clusters. When a cluster of a
+ *  stream is missing, it is read together with the following clusters of the window in a single transfer.
+ *  A pinned node is accessed in place by the caller, so it is skipped when a node is selected for replacement, and a
+ *  cluster is not loaded if it would absorb a pinned block node or replace a pinned overlapping cluster. In unbuffered
+ *  mode, pinned blocks (clusters) are kept in a small table of private buffers, UNBUF_PINS at most.
+ *  The size of the storage area is set at run time and all its nodes are allocated when it is assigned to the storage
+ *  device. When main memory becomes scarce, the last nodes of each pool may be taken out of service and their contents
+ *  returned to the system, page by page, until they are brought back.
+ *
+ *  The following operations are defined:
+ *    \li set the operating mode of the storage device
+ *    \li set the replacement policy of the storage area
+ *    \li set the thresholds of the flusher thread
+ *    \li set the size of the storage area
+ *    \li resize the storage area in use
+ *    \li get the statistics of the writing back of changed nodes
+ *    \li set the regions of the storage device which the statistics of accesses are split by
+ *    \li get the statistics of accesses to the storage area, by region
+ *    \li print the statistics of accesses to the storage area, by region
+ *    \li initialize the storage area and assign it to the storage device
+ *    \li unassign the storage area from the storage device and perform the required housekeeping duties
+ *    \li read a block of data from the buffercache
+ *    \li write a block of data to the buffercache
+ *    \li flush a block of data to the storage device
+ *    \li synchronize a block of data with the same block in the storage device
+ *    \li read a cluster of data from the buffercache
+ *    \li write a cluster of data to the buffercache
+ *    \li flush a cluster of data to the storage device
+ *    \li synchronize a cluster of data with the same cluster in the storage device
+ *    \li synchronize the whole storage area with the storage device
+ *    \li pin a block (cluster) of data in the buffercache
+ *    \li mark a pinned block (cluster) of data as changed
+ *    \li unpin a block (cluster) of data.
+ *
+ *  \author Artur Carneiro Pereira - September 2007
+ *  \author Miguel Oliveira e Silva - September 2009
+ *  \author António Rui Borges - July 2010 / August 2011
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "sofs_probe.h"
+#include "sofs_const.h"
+#include "sofs_rawdisk.h"
+#include "sofs_buffercache.h"
+#include "sofs_buffercachenode.h"
+#include "sofs_buffercacheinternals.h"
+
+/** \brief number of block nodes of the storage area, if its size is not set */
+#define NBUFFERS  (40)
+/** \brief number of cluster nodes of the storage area, if its size is not set */
+#define NCLUSTERS (40)
+
+/** \brief number of bits of the number of a shard */
+#define SHARD_BITS (2)
+/** \brief number of shards of the storage area */
+#define NSHARDS    (1 << SHARD_BITS)
+/** \brief number of block nodes of a shard, if the size of the storage area is not set */
+#define SHARD_BUFFERS  (NBUFFERS / NSHARDS)
+/** \brief number of cluster nodes of a shard, if the size of the storage area is not set */
+#define SHARD_CLUSTERS (NCLUSTERS / NSHARDS)
+/** \brief minimum number of nodes of a pool in service */
+#define SHARD_MIN  (4)
+/** \brief memory taken by a block node and a cluster node (in bytes) */
+#define NODE_PAIR  (BLOCK_SIZE + CLUSTER_SIZE + 2 * sizeof (SOBufferCacheNode))
+/** \brief set of all the shards */
+#define ALL_SHARDS ((UINT32_C (1) << NSHARDS) - 1)
+/** \brief multiplier of the hash function of shards (odd: 2^32 divided by the golden ratio) */
+#define SHARD_MULT (2654435769U)
+
+#if (SHARD_BITS > 5) || (SHARD_BUFFERS < SHARD_MIN) || (SHARD_CLUSTERS < SHARD_MIN)
+#error "too many shards for the size of the storage area"
+#endif
+
+/** \brief the node is in the list based on the last access time (Am) */
+#define AM        (0)
+/** \brief the node is in the first-in first-out queue of the nodes accessed only once (A1in) */
+#define A1IN      (1)
+
+/** \brief maximum number of nodes written back by the flusher while holding the storage area */
+#define FLUSH_RUN (32)
+/** \brief maximum number of blocks of a run of contiguous nodes written back by a single vectored write */
+#define WB_BLOCKS (1024)
+/** \brief interval between rounds of the flusher, if it has no age threshold (in nanoseconds) */
+#define FLUSH_IDLE (UINT64_C (1000000000))
+
+/** \brief maximum number of clusters read at once by readahead */
+#define RA_MAX     (8)
+/** \brief number of streams of successive clusters which are tracked */
+#define RA_STREAMS (4)
+
+/** \brief maximum number of blocks (clusters) pinned at once in unbuffered mode */
+#define UNBUF_PINS (8)
+
+/*
+ *  Internal data structure
+ */
+
+/** \brief Definition of a pool of nodes of a shard, all of them with the same number of blocks */
+struct pool
+{
+   /** \brief shard the pool belongs to */
+    struct shard *shard;
+   /** \brief number of blocks of its nodes */
+    uint32_t size;
+   /** \brief nodes, allocated when the storage area is assigned to the storage device */
+    SOBufferCacheNode *node;
+   /** \brief contents of the nodes (mapped in main memory, so that it can be returned to the system page by page) */
+    unsigned char *data;
+   /** \brief number of nodes */
+    uint32_t nNodes;
+   /** \brief number of nodes in service: the first ones, the others are kept out of use and their contents released */
+    uint32_t limit;
+   /** \brief number of nodes which are assigned to a block (cluster) */
+    uint32_t nUsed;
+   /** \brief list of the free nodes (linked through n_next) */
+    SOBufferCacheNode *free;
+   /** \brief head of the double-linked list based on the physical block number of the storage device */
+    SOBufferCacheNode *nLHead;
+   /** \brief head of the double-linked list based on the last access time */
+    SOBufferCacheNode *lATLHead;
+   /** \brief tail of the double-linked list based on the last access time */
+    SOBufferCacheNode *lATLTail;
+   /** \brief head of the first-in first-out queue of the nodes accessed only once (2Q policy) */
+    SOBufferCacheNode *inHead;
+   /** \brief tail of the first-in first-out queue of the nodes accessed only once (2Q policy) */
+    SOBufferCacheNode *inTail;
+   /** \brief number of nodes of the first-in first-out queue */
+    uint32_t nIn;
+   /** \brief maximum number of nodes of the first-in first-out queue before they are replaced first */
+    uint32_t kIn;
+   /** \brief ring of the blocks (clusters) last replaced from the first-in first-out queue */
+    uint32_t *ghost;
+   /** \brief number of entries of the ring */
+    uint32_t kOut;
+   /** \brief number of entries of the ring in use */
+    uint32_t nOut;
+   /** \brief entry of the ring where the next block (cluster) is stored */
+    uint32_t next;
+};
+
+/** \brief Definition of a shard of the storage area */
+struct shard
+{
+   /** \brief access lock to the shard */
+    pthread_mutex_t lock;
+   /** \brief index of its nodes */
+    SONodeIndex index;
+   /** \brief pool of block nodes */
+    struct pool blocks;
+   /** \brief pool of cluster nodes */
+    struct pool clusters;
+   /** \brief highest physical number of a block stored in a block node since the shard was last reset */
+    uint32_t blockCeiling;
+   /** \brief lowest physical number of a cluster stored since the shard was last reset */
+    uint32_t clusterFloor;
+   /** \brief number of nodes whose status is marked changed */
+    uint32_t nChanged;
+   /** \brief statistics of the writing back of its changed nodes */
+    SOBufferCacheFlushStats stats;
+   /** \brief statistics of accesses to its nodes, by region of the storage device */
+    SOBufferCacheStats access;
+};
+
+/** \brief Shards of the storage area */
+static struct shard shard[NSHARDS];
+/** \brief Control of the one-time initialization of the shards */
+static pthread_once_t shardsOnce = PTHREAD_ONCE_INIT;
+/** \brief Number of blocks of the storage device */
+static uint32_t bnmax = 0;
+/** \brief Type of the communication channel to the storage device (BUF / UNBUF) */
+static uint32_t commType = BUF;
+/** \brief Operating mode of the storage device applied at opening time */
+static uint32_t devMode = DEV_SYNC;
+/** \brief Replacement policy applied at opening time */
+static uint32_t cachePolicy = CACHE_LRU;
+/** \brief Replacement policy of the storage area in use */
+static uint32_t replPolicy = CACHE_LRU;
+/** \brief Size of the storage area applied at opening time, in MiB (zero, if it is not set) */
+static uint32_t cacheSize = 0;
+/** \brief Access lock to the storage device */
+static pthread_mutex_t devLock = PTHREAD_MUTEX_INITIALIZER;
+/** \brief Physical number of the first block of the table of inodes (statistics of accesses) */
+static uint32_t itableStart = 1;
+/** \brief Physical number of the first block of the data zone (zero, if it is unknown) */
+static uint32_t dzoneStart = 0;
+/** \brief Function which releases the blocks (clusters) kept pinned by the upper layer, if they are not in use */
+static int (*reclaimPins) (void) = NULL;
+
+/** \brief Definition of a changed node to be written back by the flusher */
+struct key
+{
+   /** \brief physical block number (of the first block, for a cluster) */
+    uint32_t n;
+   /** \brief number of blocks */
+    uint32_t size;
+};
+
+/** \brief Definition of a stream of successive clusters being read */
+struct stream
+{
+   /** \brief physical number of the first block of the cluster expected next */
+    uint32_t next;
+   /** \brief number of clusters to be read at once, if the cluster expected next is missing */
+    uint32_t window;
+};
+
+/** \brief Streams of successive clusters being read, the most recently accessed first */
+static struct stream stream[RA_STREAMS];
+/** \brief Access lock to the streams */
+static pthread_mutex_t streamLock = PTHREAD_MUTEX_INITIALIZER;
+/** \brief Access lock to the wake up of the flusher */
+static pthread_mutex_t flushLock = PTHREAD_MUTEX_INITIALIZER;
+/** \brief Condition which wakes up the flusher */
+static pthread_cond_t flushGo;
+/** \brief Flusher thread */
+static pthread_t flushThread;
+/** \brief The flusher thread is running */
+static bool flusherOn = false;
+/** \brief The flusher thread was asked to terminate */
+static bool flusherStop = false;
+/** \brief The flusher was asked to write back the changed nodes before its next round is due */
+static bool flushWanted = false;
+/** \brief Percentage of changed nodes above which the flusher writes them back (zero, if there is no such threshold) */
+static uint32_t flushRatio = 0;
+/** \brief Age of a change above which the flusher writes the node back, in ms (zero, if there is no such threshold) */
+static uint32_t flushAge = 0;
+/** \brief Changed nodes of a shard to be written back by the flusher in a round */
+static struct key *flushKey = NULL;
+/** \brief Changed nodes of the whole storage area to be written back at once */
+static SOBufferCacheNode **dirty = NULL;
+
+/** \brief Definition of a block (cluster) pinned in unbuffered mode */
+struct pinned
+{
+   /** \brief physical block number (of the first block, for a cluster) */
+    uint32_t n;
+   /** \brief number of blocks */
+    uint32_t size;
+   /** \brief number of times it is pinned (zero, if the entry is free) */
+    uint32_t pins;
+   /** \brief private copy of the contents */
+    unsigned char data[CLUSTER_SIZE];
+};
+
+/** \brief Blocks (clusters) pinned in unbuffered mode */
+static struct pinned pinned[UNBUF_PINS];
+/** \brief Access lock to the blocks (clusters) pinned in unbuffered mode */
+static pthread_mutex_t pinLock = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ *  Allusion to internal functions
+ */
+
+static int cacheOpen (const char *devname, uint32_t type);
+static int cacheClose (void);
+static int cacheReadBlock (uint32_t n, void *buf);
+static int cacheWriteBlock (uint32_t n, void *buf);
+static int cacheFlushBlock (uint32_t n, void *buf);
+static int cacheSyncBlock (uint32_t n);
+static int cacheReadCluster (uint32_t n, uint32_t window, void *buf);
+static int cacheWriteCluster (uint32_t n, void *buf);
+static int cacheFlushCluster (uint32_t n, void *buf);
+static int cacheSyncCluster (uint32_t n);
+static int cacheSync (void);
+static int cachePin (uint32_t n, uint32_t size, void **p_data);
+static int cacheMarkPinned (uint32_t n, uint32_t size);
+static int cacheUnpin (uint32_t n, uint32_t size);
+static void initShards (void);
+static struct shard *shardOf (uint32_t n);
+static uint32_t shardSet (uint32_t n, uint32_t count);
+static void lockShards (uint32_t set);
+static void unlockShards (uint32_t set);
+static bool inUse (void);
+static bool clusterStored (uint32_t n);
+static uint32_t poolNodes (uint32_t size);
+static int allocPools (uint32_t nNodes);
+static void freePools (void);
+static void resetPools (void);
+static int resizePool (struct pool *p, uint32_t limit);
+static SOBufferCacheNode *holder (uint32_t n);
+static SOBufferCacheNode *lookUpBlock (uint32_t n, unsigned char **p_data);
+static struct pool *poolOf (SOBufferCacheNode *node);
+static uint32_t regionOf (uint32_t n, uint32_t size);
+static void countAccess (uint32_t n, uint32_t size, bool hit);
+static void countWriteBack (SOBufferCacheNode *node);
+static void moveAtHead (SOBufferCacheNode *node);
+static SOBufferCacheNode *victim (struct pool *p);
+static int getFreeNode (struct pool *p, SOBufferCacheNode **p_node);
+static void rememberNode (struct pool *p, SOBufferCacheNode *node);
+static void storeNode (struct pool *p, SOBufferCacheNode *node);
+static int releaseNode (struct pool *p, SOBufferCacheNode *node);
+static int dropOverlaps (uint32_t n);
+static bool pinsOverlap (uint32_t n);
+static SOBufferCacheNode *pinnedNode (uint32_t n, uint32_t size);
+static int pinCopy (uint32_t n, uint32_t size, void **p_data);
+static struct pinned *pinnedCopy (uint32_t n, uint32_t size);
+static int writeUnbuffered (uint32_t n, uint32_t size, void *buf);
+static int loadCluster (uint32_t n, bool fill, SOBufferCacheNode **p_node);
+static uint32_t readAheadWindow (uint32_t n);
+static int readAhead (uint32_t n, uint32_t window, SOBufferCacheNode **p_node);
+static int readDevice (uint32_t n, uint32_t size, void *buf);
+static int writeDevice (uint32_t n, uint32_t size, void *buf);
+static void markChanged (SOBufferCacheNode *node);
+static void markSame (SOBufferCacheNode *node);
+static int submitNode (SOBufferCacheNode *node);
+static int writeBackNodes (void);
+static int writeNodes (SOBufferCacheNode *node[], uint32_t nNodes);
+static int compareNodes (const void *a, const void *b);
+static int startFlusher (void);
+static void stopFlusher (void);
+static void *flusher (void *arg);
+static void flushNodes (struct shard *s, bool over);
+static int writeRun (struct shard *s, struct key *k, uint32_t nKeys);
+static int compareKeys (const void *a, const void *b);
+static uint64_t clockNs (void);
+static bool reclaim (void);
+
+/**
+ *  \brief Set the operating mode of the storage device.
+ *
+ *  The mode is applied every time the storage area is subsequently assigned to the storage device, until it is set
+ *  again.
+ *
+ *  \param mode operating mode of the storage device (durability mode | backend, see sofs_rawdisk.h)
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the operating mode is invalid
+ *  \return -\c EBUSY, if the storage area is already in use
+ */
+
+int soSetBufferCacheMode (uint32_t mode)
+{
+  soColorProbe (622, "07;31", "soSetBufferCacheMode(%"PRIu32")\n", mode);
+
+  int stat = 0;                                  /* status of operation */
+
+  if (((mode & DEV_DURABILITY) > DEV_UNSAFE) || ((mode & DEV_BACKEND) > DEV_MMAP) ||
+      ((mode & DEV_DIRECT) && ((mode & DEV_BACKEND) == DEV_MMAP)))
+     return -EINVAL;                                          /* checking for operating mode */
+  lockShards (ALL_SHARDS);                       /* enter critical region */
+  if (inUse ())                                  /* checking for storage area in use */
+     stat = -EBUSY;
+     else devMode = mode;
+  unlockShards (ALL_SHARDS);                     /* exit critical region */
+
+  return stat;
+}
+
+/**
+ *  \brief Set the replacement policy of the storage area.
+ *
+ *  The policy is applied every time the storage area is subsequently assigned to the storage device, until it is set
+ *  again.
+ *
+ *  \param policy replacement policy (\c CACHE_LRU, by default, or \c CACHE_2Q)
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the replacement policy is invalid
+ *  \return -\c EBUSY, if the storage area is already in use
+ */
+
+int soSetBufferCachePolicy (uint32_t policy)
+{
+  soColorProbe (623, "07;31", "soSetBufferCachePolicy(%"PRIu32")\n", policy);
+
+  int stat = 0;                                  /* status of operation */
+
+  if ((policy != CACHE_LRU) && (policy != CACHE_2Q))       /* checking for replacement policy */
+     return -EINVAL;
+  lockShards (ALL_SHARDS);                       /* enter critical region */
+  if (inUse ())                                  /* checking for storage area in use */
+     stat = -EBUSY;
+     else cachePolicy = policy;
+  unlockShards (ALL_SHARDS);                     /* exit critical region */
+
+  return stat;
+}
+
+/**
+ *  \brief Set the thresholds of the flusher thread.
+ *
+ *  The flusher writes back changed nodes in the background: all of them, when the percentage of changed nodes of the
+ *  storage area rises above the ratio threshold; those changed for longer than the age threshold, otherwise. The
+ *  thresholds are applied every time the storage area is subsequently assigned to the storage device, until they are
+ *  set again. If both are zero (the default), there is no flusher.
+ *
+ *  \param ratio percentage of changed nodes (zero, if there is no such threshold)
+ *  \param age age of a change, in milliseconds (zero, if there is no such threshold)
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the percentage is greater than 100
+ *  \return -\c EBUSY, if the storage area is already in use
+ */
+
+int soSetBufferCacheFlusher (uint32_t ratio, uint32_t age)
+{
+  soColorProbe (624, "07;31", "soSetBufferCacheFlusher(%"PRIu32", %"PRIu32")\n", ratio, age);
+
+  int stat = 0;                                  /* status of operation */
+
+  if (ratio > 100) return -EINVAL;               /* checking for percentage */
+  lockShards (ALL_SHARDS);                       /* enter critical region */
+  if (inUse ())                                  /* checking for storage area in use */
+     stat = -EBUSY;
+     else { flushRatio = ratio;
+            flushAge = age;
+          }
+  unlockShards (ALL_SHARDS);                     /* exit critical region */
+
+  return stat;
+}
+
+/**
+ *  \brief Set the size of the storage area.
+ *
+ *  The size is applied every time the storage area is subsequently assigned to the storage device, until it is set
+ *  again: all the nodes and their contents are allocated then, evenly split by the shards and, in each shard, with as
+ *  many block nodes as cluster nodes. If it is zero (the default), the storage area has NBUFFERS block nodes and
+ *  NCLUSTERS cluster nodes.
+ *
+ *  \param size size of the storage area, in MiB (zero, if it is not set)
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the size is greater than \c CACHE_MAX_SIZE
+ *  \return -\c EBUSY, if the storage area is already in use
+ */
+
+int soSetBufferCacheSize (uint32_t size)
+{
+  soColorProbe (635, "07;31", "soSetBufferCacheSize(%"PRIu32")\n", size);
+
+  int stat = 0;                                  /* status of operation */
+
+  if (size > CACHE_MAX_SIZE) return -EINVAL;     /* checking for size */
+  lockShards (ALL_SHARDS);                       /* enter critical region */
+  if (inUse ())                                  /* checking for storage area in use */
+     stat = -EBUSY;
+     else cacheSize = size;
+  unlockShards (ALL_SHARDS);                     /* exit critical region */
+
+  return stat;
+}
+
+/**
+ *  \brief Resize the storage area in use.
+ *
+ *  It is meant to let go of main memory, when it becomes scarce, and to take it back afterwards. The nodes of the
+ *  storage area beyond the new size are taken out of service: their contents is written back to the storage device,
+ *  if it was changed, and returned to the system. The storage area can not grow beyond the size it was assigned to the
+ *  storage device with, nor shrink below a few nodes per shard; a size of zero brings all its nodes back into service.
+ *  In unbuffered mode, nothing is done.
+ *
+ *  \param size new size of the storage area, in MiB
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the size is greater than \c CACHE_MAX_SIZE
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EBUSY, if pinned nodes are kept in service, so that the storage area is larger than requested
+ *  \return -\c EIO, if it fails on writing
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+int soResizeBufferCache (uint32_t size)
+{
+  soColorProbe (636, "07;31", "soResizeBufferCache(%"PRIu32")\n", size);
+
+  uint32_t k, nNodes;                            /* counting variable / number of nodes of a pool in service */
+  int stat = 0, st;                              /* status of operation */
+
+  if (size > CACHE_MAX_SIZE) return -EINVAL;     /* checking for size */
+  nNodes = (size == 0) ? UINT32_MAX : poolNodes (size);
+  lockShards (ALL_SHARDS);                       /* enter critical region */
+  if (bnmax == 0)                                /* checking for device opened */
+     stat = -EBADF;
+     else if (commType == BUF)
+             for (k = 0; k < NSHARDS; k++)
+             { if (((st = resizePool (&shard[k].blocks, nNodes)) != 0) && (stat == 0)) stat = st;
+               if (((st = resizePool (&shard[k].clusters, nNodes)) != 0) && (stat == 0)) stat = st;
+             }
+  unlockShards (ALL_SHARDS);                     /* exit critical region */
+
+  return stat;
+}
+
+/**
+ *  \brief Get the statistics of the writing back of changed nodes.
+ *
+ *  They are kept since the storage area was last assigned to the storage device.
+ *
+ *  \param p_stats pointer to a location where the statistics are to be stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the <em>pointer</em> is \c NULL
+ */
+
+int soGetBufferCacheFlushStats (SOBufferCacheFlushStats *p_stats)
+{
+  soColorProbe (625, "07;31", "soGetBufferCacheFlushStats(%p)\n", p_stats);
+
+  uint32_t k;                                    /* counting variable */
+
+  if (p_stats == NULL) return -EINVAL;           /* checking for null pointer */
+
+  memset (p_stats, 0, sizeof (SOBufferCacheFlushStats));
+  lockShards (ALL_SHARDS);                       /* enter critical region */
+  for (k = 0; k < NSHARDS; k++)
+  { p_stats->evictions += shard[k].stats.evictions;
+    p_stats->rounds += shard[k].stats.rounds;
+    p_stats->runs += shard[k].stats.runs;
+    p_stats->nodes += shard[k].stats.nodes;
+    p_stats->errors += shard[k].stats.errors;
+    p_stats->changed += shard[k].nChanged;
+  }
+  unlockShards (ALL_SHARDS);                     /* exit critical region */
+
+  return 0;
+}
+
+/**
+ *  \brief Set the regions of the storage device which the statistics of accesses are split by.
+ *
+ *  The superblock is stored below the first block of the table of inodes, which is stored below the first block of the
+ *  data zone. Until they are set, the superblock is block 0 and the region of the other blocks is told by the way they
+ *  are accessed: blocks accessed on their own belong to the table of inodes and clusters to the data zone. The regions
+ *  are kept until they are set again.
+ *
+ *  \param itStart physical number of the first block of the table of inodes
+ *  \param dzStart physical number of the first block of the data zone
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the table of inodes starts at block 0 or after the data zone
+ */
+
+int soSetBufferCacheRegions (uint32_t itStart, uint32_t dzStart)
+{
+  soColorProbe (632, "07;31", "soSetBufferCacheRegions(%"PRIu32", %"PRIu32")\n", itStart, dzStart);
+
+  if ((itStart == 0) || (dzStart < itStart)) return -EINVAL;       /* checking for region bounds */
+
+  lockShards (ALL_SHARDS);                       /* enter critical region */
+  itableStart = itStart;
+  dzoneStart = dzStart;
+  unlockShards (ALL_SHARDS);                     /* exit critical region */
+
+  return 0;
+}
+
+/**
+ *  \brief Set the function which releases the blocks (clusters) the upper layer keeps pinned while they are not in use.
+ *
+ *  When a block (cluster) can not be read, written or pinned because all the nodes which may hold it are pinned (all
+ *  the entries of the table of pinned blocks (clusters), in unbuffered mode), the function is called, outside any
+ *  critical region, and the operation is tried once more if it reports that any block (cluster) was unpinned. It is
+ *  kept until it is set again.
+ *
+ *  \param release pointer to the function, which returns the number of blocks (clusters) unpinned (\c NULL, if none)
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ */
+
+int soSetBufferCacheReclaim (int (*release) (void))
+{
+  soColorProbe (637, "07;31", "soSetBufferCacheReclaim(%p)\n", (void *) release);
+
+  lockShards (ALL_SHARDS);                       /* enter critical region */
+  reclaimPins = release;
+  unlockShards (ALL_SHARDS);                     /* exit critical region */
+
+  return 0;
+}
+
+/**
+ *  \brief Get the statistics of accesses to the storage area, by region of the storage device.
+ *
+ *  They are kept since the storage area was last assigned to the storage device, and survive its unassignment. In
+ *  unbuffered mode, there is no storage area and nothing is counted.
+ *
+ *  \param p_stats pointer to a location where the statistics are to be stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the <em>pointer</em> is \c NULL
+ */
+
+int soGetBufferCacheStats (SOBufferCacheStats *p_stats)
+{
+  soColorProbe (633, "07;31", "soGetBufferCacheStats(%p)\n", p_stats);
+
+  SOBufferCacheRegionStats *r, *sr;              /* statistics of a region: the whole storage area / a shard */
+  uint32_t i, k;                                 /* counting variables */
+
+  if (p_stats == NULL) return -EINVAL;           /* checking for null pointer */
+
+  memset (p_stats, 0, sizeof (SOBufferCacheStats));
+  lockShards (ALL_SHARDS);                       /* enter critical region */
+  for (k = 0; k < NSHARDS; k++)
+    for (i = 0; i < CACHE_REGIONS; i++)
+    { r = &p_stats->region[i];
+      sr = &shard[k].access.region[i];
+      r->hits += sr->hits;
+      r->misses += sr->misses;
+      r->evictions += sr->evictions;
+      r->writebacks += sr->writebacks;
+    }
+  unlockShards (ALL_SHARDS);                     /* exit critical region */
+
+  return 0;
+}
+
+/**
+ *  \brief Print the statistics of accesses to the storage area, by region of the storage device.
+ *
+ *  For each region with some activity, the counters and the percentage of hits are printed.
+ *
+ *  \param fp stream where the statistics are to be printed
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the <em>stream</em> is \c NULL
+ */
+
+int soPrintBufferCacheStats (FILE *fp)
+{
+  soColorProbe (634, "07;31", "soPrintBufferCacheStats(%p)\n", fp);
+
+  static const char *regionName[CACHE_REGIONS] = { "superblock", "inode table", "data zone" };
+  SOBufferCacheStats st;                         /* snapshot of the statistics */
+  SOBufferCacheRegionStats *r;                   /* statistics of the current region */
+  uint32_t i;                                    /* counting variable */
+
+  if (fp == NULL) return -EINVAL;                /* checking for null pointer */
+
+  soGetBufferCacheStats (&st);
+  fprintf (fp, "Buffercache accesses\n");
+  for (i = 0; i < CACHE_REGIONS; i++)
+  { r = &st.region[i];
+    if ((r->hits + r->misses + r->writebacks) == 0) continue;
+    fprintf (fp, "   %-13s %"PRIu64" hits, %"PRIu64" misses", regionName[i], r->hits, r->misses);
+    if ((r->hits + r->misses) != 0)
+       fprintf (fp, " (%.2f%% hits)", 100.0 * r->hits / (r->hits + r->misses));
+    fprintf (fp, ", %"PRIu64" evictions, %"PRIu64" writebacks\n", r->evictions, r->writebacks);
+  }
+
+  return 0;
+}
+
+/**
+ *  \brief Initialize the storage area and assign it to the storage device.
+ *
+ *  A communication channel is established with the storage device so that data transfers between main memory and the
+ *  storage device may be minimized.
+ *  This communication may be unbuffered or buffered: it will be unbuffered, if the second argument is \c UNBUF , and
+ *  buffered, in any other case.
+ *  The storage device is opened in the operating mode previously set by \e soSetBufferCacheMode (\c DEV_SYNC, by
+ *  default) and the storage area is managed by the replacement policy previously set by \e soSetBufferCachePolicy
+ *  (\c CACHE_LRU, by default). If thresholds were previously set by \e soSetBufferCacheFlusher, the flusher thread is
+ *  started.
+ *
+ *  \param devname absolute path to the Linux file that simulates the storage device
+ *  \param type type of the communication channel that is opened
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the argument is \c NULL
+ *  \return -\c EBUSY, if the storage area is already in use or the device is already opened
+ *  \return -\c ELIBBAD, if the supporting file size is invalid
+ *  \return -\c ENOMEM, if the index of the storage area can not be allocated
+ *  \return -\c EAGAIN, if the flusher thread can not be created
+ *  \return -<em>other specific error</em> issued by \e open system call
+ */
+
+int soOpenBufferCache (const char *devname, uint32_t type)
+{
+  soColorProbe (611, "07;31", "soOpenBufferCache(\"%s\", %"PRIu32")\n", devname, type);
+
+  int stat;                                      /* status of operation */
+
+  lockShards (ALL_SHARDS);                       /* enter critical region */
+  stat = cacheOpen (devname, type);
+  if ((stat == 0) && (commType == BUF) && ((flushRatio != 0) || (flushAge != 0)) && ((stat = startFlusher ()) != 0))
+     cacheClose ();
+  unlockShards (ALL_SHARDS);                     /* exit critical region */
+
+  return stat;
+}
+
+/**
+ *  \brief Unassign the storage area from the storage device and perform the required housekeeping duties.
+ *
+ *  The buffered/unbuffered communication channel previously established with the storage device is closed.
+ *  This means, namely, that the flusher thread, if running, is terminated and the contents of the storage area is
+ *  flushed into the storage device to keep data consistent. The blocks (clusters) which are still pinned are unpinned.
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on writing
+ *  \return -\c ELIBBAD, if the internal data is inconsistent
+ */
+
+int soCloseBufferCache (void)
+{
+  soColorProbe (612, "07;31", "soCloseBufferCache()\n");
+
+  int stat;                                      /* status of operation */
+
+  stopFlusher ();
+  lockShards (ALL_SHARDS);                       /* enter critical region */
+  stat = cacheClose ();
+  unlockShards (ALL_SHARDS);                     /* exit critical region */
+
+  return stat;
+}
+
+/**
+ *  \brief Read a block of data from the buffercache.
+ *
+ *  Both the physical number of the data block to be read and a pointer to a previously allocated buffer are supplied
+ *  as arguments.
+ *
+ *  \param n physical number of the data block to be read from
+ *  \param buf pointer to the buffer where the data must be read into
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the <em>buffer pointer</em> is \c NULL or the <em>block number</em> is out of range
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on reading or writing
+ *  \return -\c ENOBUFS, if all the nodes which may hold the block are pinned
+ *  \return -\c ELIBBAD, if the buffercache is inconsistent
+ */
+
+int soReadCacheBlock (uint32_t n, void *buf)
+{
+  soColorProbe (613, "07;31", "soReadCacheBlock(%"PRIu32", %p)\n", n, buf);
+
+  uint32_t set = shardSet (n, 1);                /* shards which may hold the block */
+  int stat;                                      /* status of operation */
+
+  lockShards (set);                              /* enter critical region */
+  stat = cacheReadBlock (n, buf);
+  unlockShards (set);                            /* exit critical region */
+  if ((stat == -ENOBUFS) && reclaim ())          /* try again, once the pins kept by the upper layer are released */
+     { lockShards (set);
+       stat = cacheReadBlock (n, buf);
+       unlockShards (set);
+     }
+
+  return stat;
+}
+
+/**
+ *  \brief Write a block of data to the buffercache.
+ *
+ *  Both the physical number of the data block to be written and a pointer to a previously allocated buffer are supplied
+ *  as arguments.
+ *
+ *  \param n physical number of the block to be written into
+ *  \param buf pointer to the buffer containing the data to be written from
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if <em>buffer pointer</em> is \c NULL or <em>block number</em> is out of range
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on writing
+ *  \return -\c ENOBUFS, if all the nodes which may hold the block are pinned
+ *  \return -\c ELIBBAD, if the buffercache is inconsistent
+ */
+
+int soWriteCacheBlock (uint32_t n, void *buf)
+{
+  soColorProbe (614, "07;31", "soWriteCacheBlock(%"PRIu32", %p)\n", n, buf);
+
+  uint32_t set = shardSet (n, 1);                /* shards which may hold the block */
+  int stat;                                      /* status of operation */
+
+  lockShards (set);                              /* enter critical region */
+  stat = cacheWriteBlock (n, buf);
+  unlockShards (set);                            /* exit critical region */
+  if ((stat == -ENOBUFS) && reclaim ())          /* try again, once the pins kept by the upper layer are released */
+     { lockShards (set);
+       stat = cacheWriteBlock (n, buf);
+       unlockShards (set);
+     }
+
+  return stat;
+}
+
+/**
+ *  \brief Flush a block of data to the storage device.
+ *
+ *  Both the physical number of the data block to be written and a pointer to a previously allocated buffer are supplied
+ *  as arguments.
+ *
+ *  \param n physical number of the block to be flushed
+ *  \param buf pointer to the buffer containing the data to be written from
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if <em>buffer pointer</em> is \c NULL or <em>block number</em> is out of range
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on writing
+ *  \return -\c ELIBBAD, if the buffercache is inconsistent
+ */
+
+int soFlushCacheBlock (uint32_t n, void *buf)
+{
+  soColorProbe (615, "07;31", "soFlushCacheBlock(%"PRIu32", %p)\n", n, buf);
+
+  uint32_t set = shardSet (n, 1);                /* shards which may hold the block */
+  int stat;                                      /* status of operation */
+
+  lockShards (set);                              /* enter critical region */
+  stat = cacheFlushBlock (n, buf);
+  unlockShards (set);                            /* exit critical region */
+
+  return stat;
+}
+
+/**
+ *  \brief Synchronize a block of data with the same block in the storage device.
+ *
+ *  The physical number of the data block to be synchronized is supplied as argument.
+ *
+ *  \param n physical number of the block to be synchronized
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if <em>block number</em> is out of range
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on writing
+ *  \return -\c ELIBBAD, if the buffercache is inconsistent
+ */
+
+int soSyncCacheBlock (uint32_t n)
+{
+  soColorProbe (616, "07;31", "soSyncCacheBlock(%"PRIu32")\n", n);
+
+  uint32_t set = shardSet (n, 1);                /* shards which may hold the block */
+  int stat;                                      /* status of operation */
+
+  lockShards (set);                              /* enter critical region */
+  stat = cacheSyncBlock (n);
+  unlockShards (set);                            /* exit critical region */
+
+  return stat;
+}
+
+/**
+ *  \brief Read a cluster of data from the buffercache.
+ *
+ *  The device is organized as a linear array of data blocks. A cluster is a group of successive blocks.
+ *  Both the physical number of the first block of the data cluster to be read and a pointer to a previously allocated
+ *  buffer are supplied as arguments.
+ *
+ *  \param n physical number of the first block of the data cluster to be read from
+ *  \param buf pointer to the buffer where the data must be read into
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the <em>buffer pointer</em> is \c NULL or the <em>block number</em> is out of range
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on reading or writing
+ *  \return -\c EBUSY, if any of its blocks, or an overlapping cluster, is pinned on its own
+ *  \return -\c ENOBUFS, if all the nodes which may hold the cluster are pinned
+ *  \return -\c ELIBBAD, if the buffercache is inconsistent
+ */
+
+int soReadCacheCluster (uint32_t n, void *buf)
+{
+  soColorProbe (617, "07;31", "soReadCacheCluster(%"PRIu32", %p)\n", n, buf);
+
+  uint32_t window = readAheadWindow (n);         /* number of clusters to be read at once, if it is missing */
+  uint32_t set = shardSet (n, BLOCKS_PER_CLUSTER);         /* shards which may hold the cluster */
+  int stat;                                      /* status of operation */
+
+  lockShards (set);                              /* enter critical region */
+  if ((window > 1) && !clusterStored (n))
+     { /* the shards of the whole readahead window are required */
+       unlockShards (set);
+       set = shardSet (n, window * BLOCKS_PER_CLUSTER);
+       lockShards (set);
+     }
+  stat = cacheReadCluster (n, window, buf);
+  unlockShards (set);                            /* exit critical region */
+  if ((stat == -ENOBUFS) && reclaim ())          /* try again, once the pins kept by the upper layer are released */
+     { lockShards (set);
+       stat = cacheReadCluster (n, window, buf);
+       unlockShards (set);
+     }
+
+  return stat;
+}
+
+/**
+ *  \brief Write a cluster of data to the buffercache.
+ *
+ *  The device is organized as a linear array of data blocks. A cluster is a group of successive blocks.
+ *  Both the physical number of the first block of the data cluster to be written and a pointer to a previously
+ *  allocated buffer are supplied as arguments.
+ *
+ *  \param n physical number of the first block of the data cluster to be written into
+ *  \param buf pointer to the buffer containing the data to be written from
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if <em>buffer pointer</em> is \c NULL or <em>block number</em> is out of range
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on writing
+ *  \return -\c EBUSY, if any of its blocks, or an overlapping cluster, is pinned on its own
+ *  \return -\c ENOBUFS, if all the nodes which may hold the cluster are pinned
+ *  \return -\c ELIBBAD, if the buffercache is inconsistent
+ */
+
+int soWriteCacheCluster (uint32_t n, void *buf)
+{
+  soColorProbe (618, "07;31", "soWriteCacheCluster(%"PRIu32", %p)\n", n, buf);
+
+  uint32_t set = shardSet (n, BLOCKS_PER_CLUSTER);       /* shards which may hold the cluster */
+  int stat;                                      /* status of operation */
+
+  lockShards (set);                              /* enter critical region */
+  stat = cacheWriteCluster (n, buf);
+  unlockShards (set);                            /* exit critical region */
+  if ((stat == -ENOBUFS) && reclaim ())          /* try again, once the pins kept by the upper layer are released */
+     { lockShards (set);
+       stat = cacheWriteCluster (n, buf);
+       unlockShards (set);
+     }
+
+  return stat;
+}
+
+/**
+ *  \brief Flush a cluster of data to the storage device.
+ *
+ *  The device is organized as a linear array of data blocks. A cluster is a group of successive blocks.
+ *  Both the physical number of the first block of the data cluster to be flushed and a pointer to a previously
+ *  allocated buffer are supplied as arguments.
+ *
+ *  \param n physical number of the first block of the data cluster to be flushed
+ *  \param buf pointer to the buffer containing the data to be written from
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if <em>buffer pointer</em> is \c NULL or <em>block number</em> is out of range
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on writing
+ *  \return -\c ELIBBAD, if the buffercache is inconsistent
+ */
+
+int soFlushCacheCluster (uint32_t n, void *buf)
+{
+  soColorProbe (619, "07;31", "soFlushCacheCluster(%"PRIu32", %p)\n", n, buf);
+
+  uint32_t set = shardSet (n, BLOCKS_PER_CLUSTER);       /* shards which may hold the cluster */
+  int stat;                                      /* status of operation */
+
+  lockShards (set);                              /* enter critical region */
+  stat = cacheFlushCluster (n, buf);
+  unlockShards (set);                            /* exit critical region */
+
+  return stat;
+}
+
+/**
+ *  \brief Synchronize a cluster of data with the same cluster in the storage device.
+ *
+ *  The device is organized as a linear array of data blocks. A cluster is a group of successive blocks.
+ *  The physical number of the data cluster to be synchronized is supplied as argument.
+ *
+ *  \param n physical number of the first block of the data cluster to be synchronized
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if <em>block number</em> is out of range
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on writing
+ *  \return -\c ELIBBAD, if the buffercache is inconsistent
+ */
+
+int soSyncCacheCluster (uint32_t n)
+{
+  soColorProbe (620, "07;31", "soSyncCacheCluster(%"PRIu32")\n", n);
+
+  uint32_t set = shardSet (n, BLOCKS_PER_CLUSTER);       /* shards which may hold the cluster */
+  int stat;                                      /* status of operation */
+
+  lockShards (set);                              /* enter critical region */
+  stat = cacheSyncCluster (n);
+  unlockShards (set);                            /* exit critical region */
+
+  return stat;
+}
+
+/**
+ *  \brief Synchronize the whole storage area with the storage device.
+ *
+ *  The contents of all the nodes of the storage area whose status is marked \e changed is transferred to the storage
+ *  device and their status is marked \e same. Afterwards, the storage device is itself synchronized, so that, in
+ *  \c DEV_DATASYNC mode, the data reaches stable storage.
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on writing or synchronizing
+ *  \return -\c ELIBBAD, if the buffercache is inconsistent
+ */
+
+int soSyncBufferCache (void)
+{
+  soColorProbe (621, "07;31", "soSyncBufferCache()\n");
+
+  int stat;                                      /* status of operation */
+
+  lockShards (ALL_SHARDS);                       /* enter critical region */
+  stat = cacheSync ();
+  unlockShards (ALL_SHARDS);                     /* exit critical region */
+
+  return stat;
+}
+
+/**
+ *  \brief Pin a block of data in the buffercache.
+ *
+ *  The block is looked up in the storage area and, if missing, read from the storage device. A pointer to its contents
+ *  in the storage area is stored instead of a copy. The node holding the block is not replaced until the block is
+ *  unpinned as many times as it was pinned.
+ *
+ *  \param n physical number of the data block to be pinned
+ *  \param p_data pointer to the location where the pointer to the block contents is to be stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the <em>pointer</em> is \c NULL or the <em>block number</em> is out of range
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on reading or writing
+ *  \return -\c ENOBUFS, if all the nodes which may hold the block are pinned
+ *  \return -\c ELIBBAD, if the buffercache is inconsistent
+ */
+
+int soPinCacheBlock (uint32_t n, void **p_data)
+{
+  soColorProbe (626, "07;31", "soPinCacheBlock(%"PRIu32", %p)\n", n, p_data);
+
+  uint32_t set = shardSet (n, 1);                /* shards which may hold the block */
+  int stat;                                      /* status of operation */
+
+  lockShards (set);                              /* enter critical region */
+  stat = cachePin (n, 1, p_data);
+  unlockShards (set);                            /* exit critical region */
+  if ((stat == -ENOBUFS) && reclaim ())          /* try again, once the pins kept by the upper layer are released */
+     { lockShards (set);
+       stat = cachePin (n, 1, p_data);
+       unlockShards (set);
+     }
+
+  return stat;
+}
+
+/**
+ *  \brief Mark a pinned block of data as changed.
+ *
+ *  It must be called after the block contents is changed through the pointer got when it was pinned, and before it is
+ *  unpinned.
+ *
+ *  \param n physical number of the pinned data block
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the <em>block number</em> is out of range or the block is not pinned
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on writing (unbuffered mode)
+ */
+
+int soMarkCacheBlockChanged (uint32_t n)
+{
+  soColorProbe (627, "07;31", "soMarkCacheBlockChanged(%"PRIu32")\n", n);
+
+  uint32_t set = shardSet (n, 1);                /* shards which may hold the block */
+  int stat;                                      /* status of operation */
+
+  lockShards (set);                              /* enter critical region */
+  stat = cacheMarkPinned (n, 1);
+  unlockShards (set);                            /* exit critical region */
+
+  return stat;
+}
+
+/**
+ *  \brief Unpin a block of data.
+ *
+ *  The pointer got when it was pinned must no longer be used.
+ *
+ *  \param n physical number of the pinned data block
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the <em>block number</em> is out of range or the block is not pinned
+ */
+
+int soUnpinCacheBlock (uint32_t n)
+{
+  soColorProbe (628, "07;31", "soUnpinCacheBlock(%"PRIu32")\n", n);
+
+  uint32_t set = shardSet (n, 1);                /* shards which may hold the block */
+  int stat;                                      /* status of operation */
+
+  lockShards (set);                              /* enter critical region */
+  stat = cacheUnpin (n, 1);
+  unlockShards (set);                            /* exit critical region */
+
+  return stat;
+}
+
+/**
+ *  \brief Pin a cluster of data in the buffercache.
+ *
+ *  The cluster is looked up in the storage area and, if missing, read from the storage device (no readahead takes
+ *  place). A pointer to its contents in the storage area is stored instead of a copy. The node holding the cluster is
+ *  not replaced until the cluster is unpinned as many times as it was pinned.
+ *
+ *  \param n physical number of the first block of the data cluster to be pinned
+ *  \param p_data pointer to the location where the pointer to the cluster contents is to be stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the <em>pointer</em> is \c NULL or the <em>block number</em> is out of range
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on reading or writing
+ *  \return -\c EBUSY, if any of its blocks, or an overlapping cluster, is pinned on its own
+ *  \return -\c ENOBUFS, if all the nodes which may hold the cluster are pinned
+ *  \return -\c ELIBBAD, if the buffercache is inconsistent
+ */
+
+int soPinCacheCluster (uint32_t n, void **p_data)
+{
+  soColorProbe (629, "07;31", "soPinCacheCluster(%"PRIu32", %p)\n", n, p_data);
+
+  uint32_t set = shardSet (n, BLOCKS_PER_CLUSTER);       /* shards which may hold the cluster */
+  int stat;                                      /* status of operation */
+
+  lockShards (set);                              /* enter critical region */
+  stat = cachePin (n, BLOCKS_PER_CLUSTER, p_data);
+  unlockShards (set);                            /* exit critical region */
+  if ((stat == -ENOBUFS) && reclaim ())          /* try again, once the pins kept by the upper layer are released */
+     { lockShards (set);
+       stat = cachePin (n, BLOCKS_PER_CLUSTER, p_data);
+       unlockShards (set);
+     }
+
+  return stat;
+}
+
+/**
+ *  \brief Mark a pinned cluster of data as changed.
+ *
+ *  It must be called after the cluster contents is changed through the pointer got when it was pinned, and before it
+ *  is unpinned.
+ *
+ *  \param n physical number of the first block of the pinned data cluster
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the <em>block number</em> is out of range or the cluster is not pinned
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on writing (unbuffered mode)
+ */
+
+int soMarkCacheClusterChanged (uint32_t n)
+{
+  soColorProbe (630, "07;31", "soMarkCacheClusterChanged(%"PRIu32")\n", n);
+
+  uint32_t set = shardSet (n, BLOCKS_PER_CLUSTER);       /* shards which may hold the cluster */
+  int stat;                                      /* status of operation */
+
+  lockShards (set);                              /* enter critical region */
+  stat = cacheMarkPinned (n, BLOCKS_PER_CLUSTER);
+  unlockShards (set);                            /* exit critical region */
+
+  return stat;
+}
+
+/**
+ *  \brief Unpin a cluster of data.
+ *
+ *  The pointer got when it was pinned must no longer be used.
+ *
+ *  \param n physical number of the first block of the pinned data cluster
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the <em>block number</em> is out of range or the cluster is not pinned
+ */
+
+int soUnpinCacheCluster (uint32_t n)
+{
+  soColorProbe (631, "07;31", "soUnpinCacheCluster(%"PRIu32")\n", n);
+
+  uint32_t set = shardSet (n, BLOCKS_PER_CLUSTER);       /* shards which may hold the cluster */
+  int stat;                                      /* status of operation */
+
+  lockShards (set);                              /* enter critical region */
+  stat = cacheUnpin (n, BLOCKS_PER_CLUSTER);
+  unlockShards (set);                            /* exit critical region */
+
+  return stat;
+}
+
+/*
+ *  Initialize the storage area and assign it to the storage device, inside the critical region.
+ */
+
+static int cacheOpen (const char *devname, uint32_t type)
+{
+  uint32_t k, nNodes;                            /* counting variable / number of nodes of a pool */
+  int stat;                                      /* status of operation */
+
+  if (devname == NULL) return -EINVAL;           /* checking for null pointer */
+  if (inUse ()) return -EBUSY;                   /* checking for storage area in use */
+
+  if ((stat = soOpenDevice (devname, devMode, &bnmax)) != 0)
+     return stat;
+  commType = (type == UNBUF) ? UNBUF : BUF;
+  nNodes = poolNodes (cacheSize);
+  stat = (commType == BUF) ? allocPools (nNodes) : 0;
+  for (k = 0; (k < NSHARDS) && (commType == BUF) && (stat == 0); k++)
+    if ((stat = setUpNodeIndex (&shard[k].index, 3 * nNodes)) != 0)          /* nodes and ghosts of both pools */
+       while (k > 0)
+         freeNodeIndex (&shard[--k].index);
+  if (stat != 0)
+     { freePools ();
+       soCloseDevice ();
+       bnmax = 0;
+       commType = BUF;
+       return stat;
+     }
+  resetPools ();
+  for (k = 0; k < NSHARDS; k++)
+  { memset (&shard[k].access, 0, sizeof (SOBufferCacheStats));
+    memset (&shard[k].stats, 0, sizeof (SOBufferCacheFlushStats));
+  }
+  replPolicy = cachePolicy;
+
+  return 0;
+}
+
+/*
+ *  Unassign the storage area from the storage device and perform the required housekeeping duties, inside the critical region.
+ */
+
+static int cacheClose (void)
+{
+  uint32_t k;                                    /* counting variable */
+  int stat;                                      /* status of operation */
+
+  if (commType == BUF)
+     { /* flush the nodes whose contents was changed */
+       if ((stat = writeBackNodes ()) != 0) return stat;
+
+       /* reset the storage area */
+
+       resetPools ();
+       for (k = 0; k < NSHARDS; k++)
+         freeNodeIndex (&shard[k].index);
+       freePools ();
+     }
+  bnmax = 0;
+  commType = BUF;
+
+  return soCloseDevice ();
+}
+
+/*
+ *  Read a block of data from the buffercache, inside the critical region.
+ */
+
+static int cacheReadBlock (uint32_t n, void *buf)
+{
+  SOBufferCacheNode *node;                       /* pointer to a node of the storage area */
+  unsigned char *data;                           /* pointer to the block contents in the node */
+  int stat;                                      /* status of operation */
+
+  if (buf == NULL) return -EINVAL;               /* checking for null pointer */
+  if (n >= bnmax) return -EINVAL;                /* checking for block number */
+  if (commType == UNBUF) return readDevice (n, 1, buf);
+
+  if (lookUpBlock (n, &data) != NULL)
+     { /* the block is already in the storage area */
+       countAccess (n, 1, true);
+       memcpy (buf, data, BLOCK_SIZE);
+       return 0;
+     }
+
+  /* the block has to be read from the storage device */
+
+  countAccess (n, 1, false);
+  if ((stat = readDevice (n, 1, buf)) != 0) return stat;
+  if ((stat = getFreeNode (&shardOf (n)->blocks, &node)) != 0) return stat;
+  node->n = n;
+  memcpy (node->buffer, buf, BLOCK_SIZE);
+  storeNode (&shardOf (n)->blocks, node);
+
+  return 0;
+}
+
+/*
+ *  Write a block of data to the buffercache, inside the critical region.
+ */
+
+static int cacheWriteBlock (uint32_t n, void *buf)
+{
+  SOBufferCacheNode *node;                       /* pointer to a node of the storage area */
+  unsigned char *data;                           /* pointer to the block contents in the node */
+  int stat;                                      /* status of operation */
+
+  if (buf == NULL) return -EINVAL;               /* checking for null pointer */
+  if (n >= bnmax) return -EINVAL;                /* checking for block number */
+  if (commType == UNBUF) return writeUnbuffered (n, 1, buf);
+
+  if ((node = lookUpBlock (n, &data)) != NULL)
+     { /* the block is already in the storage area */
+       countAccess (n, 1, true);
+       memcpy (data, buf, BLOCK_SIZE);
+       markChanged (node);
+       return 0;
+     }
+
+  /* a node has to be assigned to the block */
+
+  countAccess (n, 1, false);
+  if ((stat = getFreeNode (&shardOf (n)->blocks, &node)) != 0) return stat;
+  node->n = n;
+  memcpy (node->buffer, buf, BLOCK_SIZE);
+  markChanged (node);
+  storeNode (&shardOf (n)->blocks, node);
+
+  return 0;
+}
+
+/*
+ *  Flush a block of data to the storage device, inside the critical region.
+ */
+
+static int cacheFlushBlock (uint32_t n, void *buf)
+{
+  SOBufferCacheNode *node;                       /* pointer to a node of the storage area */
+  unsigned char *data;                           /* pointer to the block contents in the node */
+  int stat;                                      /* status of operation */
+
+  if (buf == NULL) return -EINVAL;               /* checking for null pointer */
+  if (n >= bnmax) return -EINVAL;                /* checking for block number */
+  if (commType == UNBUF) return writeUnbuffered (n, 1, buf);
+
+  if ((node = lookUpBlock (n, &data)) == NULL)
+     return writeDevice (n, 1, buf);             /* the block is not in the storage area */
+
+  memcpy (data, buf, BLOCK_SIZE);
+  if ((stat = writeDevice (n, 1, data)) != 0) return stat;
+  countWriteBack (node);
+  if (node->size == 1) markSame (node);         /* the other blocks of a cluster may still be changed */
+
+  return 0;
+}
+
+/*
+ *  Synchronize a block of data with the same block in the storage device, inside the critical region.
+ */
+
+static int cacheSyncBlock (uint32_t n)
+{
+  SOBufferCacheNode *node;                       /* pointer to a node of the storage area */
+  unsigned char *data;                           /* pointer to the block contents in the node */
+  int stat;                                      /* status of operation */
+
+  if (n >= bnmax) return -EINVAL;                /* checking for block number */
+  if (commType == UNBUF) return 0;
+
+  if (((node = lookUpBlock (n, &data)) != NULL) && (node->stat == CHANGED))
+     { if ((stat = writeDevice (n, 1, data)) != 0) return stat;
+       countWriteBack (node);
+       if (node->size == 1) markSame (node);    /* the other blocks of a cluster may still be changed */
+     }
+
+  return 0;
+}
+
+/*
+ *  Read a cluster of data from the buffercache, inside the critical region.
+ *
+ *  The shards of the whole readahead window are supposed to be locked, if the cluster is missing.
+ */
+
+static int cacheReadCluster (uint32_t n, uint32_t window, void *buf)
+{
+  struct shard *s = shardOf (n);                 /* shard of the cluster */
+  SOBufferCacheNode *node;                       /* pointer to a node of the storage area */
+  int stat;                                      /* status of operation */
+
+  if (buf == NULL) return -EINVAL;               /* checking for null pointer */
+  if ((n + BLOCKS_PER_CLUSTER) > bnmax)          /* checking for cluster number */
+     return -EINVAL;
+  if (commType == UNBUF) return readDevice (n, BLOCKS_PER_CLUSTER, buf);
+
+  countAccess (n, BLOCKS_PER_CLUSTER, (node = searchClusterNodeOnN (&s->index, n, s->clusters.nLHead)) != NULL);
+  if (node != NULL)
+     moveAtHead (node);
+     else if ((stat = readAhead (n, window, &node)) != 0)
+             return stat;                        /* the cluster has to be read from the storage device */
+  memcpy (buf, node->buffer, CLUSTER_SIZE);
+
+  return 0;
+}
+
+/*
+ *  Write a cluster of data to the buffercache, inside the critical region.
+ */
+
+static int cacheWriteCluster (uint32_t n, void *buf)
+{
+  struct shard *s = shardOf (n);                 /* shard of the cluster */
+  SOBufferCacheNode *node;                       /* pointer to a node of the storage area */
+  int stat;                                      /* status of operation */
+
+  if (buf == NULL) return -EINVAL;               /* checking for null pointer */
+  if ((n + BLOCKS_PER_CLUSTER) > bnmax)          /* checking for cluster number */
+     return -EINVAL;
+  if (commType == UNBUF) return writeUnbuffered (n, BLOCKS_PER_CLUSTER, buf);
+
+  countAccess (n, BLOCKS_PER_CLUSTER, (node = searchClusterNodeOnN (&s->index, n, s->clusters.nLHead)) != NULL);
+  if (node != NULL)
+     moveAtHead (node);
+     else if ((stat = loadCluster (n, false, &node)) != 0)
+             return stat;                        /* a node has to be assigned to the cluster */
+  memcpy (node->buffer, buf, CLUSTER_SIZE);
+  markChanged (node);
+
+  return 0;
+}
+
+/*
+ *  Flush a cluster of data to the storage device, inside the critical region.
+ */
+
+static int cacheFlushCluster (uint32_t n, void *buf)
+{
+  struct shard *s = shardOf (n);                 /* shard of the cluster */
+  SOBufferCacheNode *node[BLOCKS_PER_CLUSTER];   /* pointers to the nodes holding the blocks of the cluster */
+  unsigned char *p;                              /* pointer to the current block of the cluster */
+  uint32_t i;                                    /* counting variable */
+  int stat;                                      /* status of operation */
+
+  if (buf == NULL) return -EINVAL;               /* checking for null pointer */
+  if ((n + BLOCKS_PER_CLUSTER) > bnmax)          /* checking for cluster number */
+     return -EINVAL;
+  if (commType == UNBUF) return writeUnbuffered (n, BLOCKS_PER_CLUSTER, buf);
+
+  if ((node[0] = searchClusterNodeOnN (&s->index, n, s->clusters.nLHead)) != NULL)
+     { /* the cluster is already in the storage area */
+       memcpy (node[0]->buffer, buf, CLUSTER_SIZE);
+       if ((stat = writeDevice (n, BLOCKS_PER_CLUSTER, node[0]->buffer)) != 0) return stat;
+       countWriteBack (node[0]);
+       markSame (node[0]);
+       moveAtHead (node[0]);
+       return 0;
+     }
+
+  /* the whole cluster is written at once, the blocks already in the storage area are updated */
+
+  for (i = 0, p = buf; i < BLOCKS_PER_CLUSTER; i++, p += BLOCK_SIZE)
+    if ((node[i] = holder (n + i)) != NULL)
+       memcpy (node[i]->buffer + (n + i - node[i]->n) * BLOCK_SIZE, p, BLOCK_SIZE);
+  if ((stat = writeDevice (n, BLOCKS_PER_CLUSTER, buf)) != 0) return stat;
+  for (i = 0; i < BLOCKS_PER_CLUSTER; i++)
+    if (node[i] != NULL)
+       { if (node[i]->size == 1) markSame (node[i]);
+         moveAtHead (node[i]);
+       }
+
+  return 0;
+}
+
+/*
+ *  Synchronize a cluster of data with the same cluster in the storage device, inside the critical region.
+ */
+
+static int cacheSyncCluster (uint32_t n)
+{
+  struct shard *s = shardOf (n);                 /* shard of the cluster */
+  SOBufferCacheNode *node[BLOCKS_PER_CLUSTER];   /* pointers to the changed nodes holding blocks of the cluster */
+  SOBufferCacheNode *p;                          /* pointer to a node of the storage area */
+  uint32_t i, j, nNodes = 0;                     /* counting variables / number of changed nodes */
+  int stat = 0;                                  /* status of operation */
+
+  if ((n + BLOCKS_PER_CLUSTER) > bnmax)          /* checking for cluster number */
+     return -EINVAL;
+  if (commType == UNBUF) return 0;
+
+  if ((p = searchClusterNodeOnN (&s->index, n, s->clusters.nLHead)) != NULL)
+     { /* the cluster is already in the storage area */
+       if (p->stat == CHANGED)
+          { if ((stat = writeDevice (n, BLOCKS_PER_CLUSTER, p->buffer)) != 0) return stat;
+            countWriteBack (p);
+            markSame (p);
+            moveAtHead (p);
+          }
+       return 0;
+     }
+
+  /* the writing of the changed nodes holding blocks of the cluster is submitted as a whole */
+
+  for (i = 0; i < BLOCKS_PER_CLUSTER; i++)
+  { if (((p = holder (n + i)) == NULL) || (p->stat != CHANGED)) continue;
+    for (j = 0; (j < nNodes) && (node[j] != p); j++) ;
+    if (j == nNodes) node[nNodes++] = p;         /* a cluster holding several blocks is written once */
+  }
+  if ((nNodes != 0) && ((stat = writeNodes (node, nNodes)) != 0))
+     return stat;                                /* the nodes are in ascending order of their blocks */
+
+  for (j = 0; j < nNodes; j++)
+  { countWriteBack (node[j]);
+    markSame (node[j]);
+    moveAtHead (node[j]);
+  }
+
+  return 0;
+}
+
+/*
+ *  Synchronize the whole storage area with the storage device, inside the critical region.
+ */
+
+static int cacheSync (void)
+{
+  int stat;                                      /* status of operation */
+
+  if ((commType == BUF) && ((stat = writeBackNodes ()) != 0))
+     return stat;
+
+  pthread_mutex_lock (&devLock);
+  stat = soSyncDevice ();
+  pthread_mutex_unlock (&devLock);
+
+  return stat;
+}
+
+/*
+ *  Pin a block (cluster) in the storage area, inside the critical region.
+ */
+
+static int cachePin (uint32_t n, uint32_t size, void **p_data)
+{
+  struct shard *s = shardOf (n);                 /* shard of the block (cluster) */
+  SOBufferCacheNode *node;                       /* pointer to the node holding the block (cluster) */
+  unsigned char *data;                           /* pointer to the block (cluster) contents in the node */
+  int stat;                                      /* status of operation */
+
+  if (p_data == NULL) return -EINVAL;            /* checking for null pointer */
+  if ((n >= bnmax) || (size > bnmax - n))        /* checking for block (cluster) number */
+     return -EINVAL;
+  if (commType == UNBUF) return pinCopy (n, size, p_data);
+
+  if (size == 1)
+     { countAccess (n, 1, (node = lookUpBlock (n, &data)) != NULL);
+       if (node == NULL)
+          { /* the block has to be read from the storage device */
+            if ((stat = getFreeNode (&s->blocks, &node)) != 0) return stat;
+            if ((stat = readDevice (n, 1, node->buffer)) != 0)
+               { node->n_next = s->blocks.free;
+                 s->blocks.free = node;
+                 return stat;
+               }
+            node->n = n;
+            storeNode (&s->blocks, node);
+            data = node->buffer;
+          }
+     }
+     else { countAccess (n, size, (node = searchClusterNodeOnN (&s->index, n, s->clusters.nLHead)) != NULL);
+            if (node != NULL)
+               moveAtHead (node);
+               else if ((stat = loadCluster (n, true, &node)) != 0)
+                       return stat;              /* the cluster has to be read from the storage device */
+            data = node->buffer;
+          }
+  node->pins += 1;
+  *p_data = data;
+
+  return 0;
+}
+
+/*
+ *  Mark a pinned block (cluster) as changed, inside the critical region.
+ */
+
+static int cacheMarkPinned (uint32_t n, uint32_t size)
+{
+  SOBufferCacheNode *node;                       /* pointer to the node holding the block (cluster) */
+  struct pinned *p;                              /* pointer to the entry of the block (cluster), in unbuffered mode */
+
+  if ((n >= bnmax) || (size > bnmax - n))        /* checking for block (cluster) number */
+     return -EINVAL;
+  if (commType == UNBUF)
+     { pthread_mutex_lock (&pinLock);
+       p = pinnedCopy (n, size);
+       pthread_mutex_unlock (&pinLock);
+       return (p == NULL) ? -EINVAL : writeUnbuffered (n, size, p->data);
+     }
+
+  if ((node = pinnedNode (n, size)) == NULL) return -EINVAL;
+  markChanged (node);
+
+  return 0;
+}
+
+/*
+ *  Unpin a block (cluster), inside the critical region.
+ */
+
+static int cacheUnpin (uint32_t n, uint32_t size)
+{
+  SOBufferCacheNode *node;                       /* pointer to the node holding the block (cluster) */
+  struct pinned *p;                              /* pointer to the entry of the block (cluster), in unbuffered mode */
+  int stat = 0;                                  /* status of operation */
+
+  if ((n >= bnmax) || (size > bnmax - n))        /* checking for block (cluster) number */
+     return -EINVAL;
+  if (commType == UNBUF)
+     { pthread_mutex_lock (&pinLock);
+       if ((p = pinnedCopy (n, size)) == NULL)
+          stat = -EINVAL;
+          else p->pins -= 1;
+       pthread_mutex_unlock (&pinLock);
+       return stat;
+     }
+
+  if ((node = pinnedNode (n, size)) == NULL) return -EINVAL;
+  node->pins -= 1;
+
+  return 0;
+}
+
+/*
+ *  Initialize the shards: their locks, the nodes of their pools and the parameters of the replacement policy.
+ */
+
+static void initShards (void)
+{
+  struct shard *s;                               /* pointer to a shard */
+  uint32_t k;                                    /* counting variable */
+
+  for (k = 0; k < NSHARDS; k++)
+  { s = &shard[k];
+    pthread_mutex_init (&s->lock, NULL);
+    s->blocks.shard = s->clusters.shard = s;
+    s->blocks.size = 1;
+    s->clusters.size = BLOCKS_PER_CLUSTER;
+  }
+  resetPools ();
+}
+
+/*
+ *  Get the shard of the nodes whose (first) block is a given one.
+ *
+ *  Blocks are hashed by groups of BLOCKS_PER_CLUSTER, so that the nodes holding the blocks of a cluster are, at most,
+ *  in two shards. The low bits of the hash are taken: as the multiplier is odd, any NSHARDS successive groups fall in
+ *  different shards, so that the table of inodes and the clusters of a file are spread evenly over them.
+ */
+
+static struct shard *shardOf (uint32_t n)
+{
+  return &shard[((n / BLOCKS_PER_CLUSTER) * SHARD_MULT) & (NSHARDS - 1)];
+}
+
+/*
+ *  Get the set of the shards which may hold a given number of successive blocks.
+ *
+ *  It comprises the shards of the nodes whose (first) block ranges from BLOCKS_PER_CLUSTER - 1 blocks before the first
+ *  one, as the cluster holding it may start there, to the last one.
+ */
+
+static uint32_t shardSet (uint32_t n, uint32_t count)
+{
+  uint64_t g, last;                              /* group of blocks / last group */
+  uint32_t set = 0;                              /* set of shards */
+
+  g = ((n < BLOCKS_PER_CLUSTER) ? 0 : n - BLOCKS_PER_CLUSTER + 1) / BLOCKS_PER_CLUSTER;
+  last = ((uint64_t) n + ((count == 0) ? 1 : count) - 1) / BLOCKS_PER_CLUSTER;
+  for (; (g <= last) && (set != ALL_SHARDS); g++)
+    set |= UINT32_C (1) << (shardOf ((uint32_t) (g * BLOCKS_PER_CLUSTER)) - shard);
+
+  return set;
+}
+
+/*
+ *  Lock a set of shards, in ascending order, so that operations locking overlapping sets never deadlock.
+ */
+
+static void lockShards (uint32_t set)
+{
+  uint32_t k;                                    /* counting variable */
+
+  pthread_once (&shardsOnce, initShards);
+  for (k = 0; k < NSHARDS; k++)
+    if (set & (UINT32_C (1) << k))
+       pthread_mutex_lock (&shard[k].lock);
+}
+
+/*
+ *  Unlock a set of shards.
+ */
+
+static void unlockShards (uint32_t set)
+{
+  uint32_t k;                                    /* counting variable */
+
+  for (k = NSHARDS; k > 0; k--)
+    if (set & (UINT32_C (1) << (k - 1)))
+       pthread_mutex_unlock (&shard[k-1].lock);
+}
+
+/*
+ *  Check if the storage area is in use (any of its nodes is assigned to a block or a cluster), inside the critical
+ *  region.
+ */
+
+static bool inUse (void)
+{
+  uint32_t k;                                    /* counting variable */
+
+  for (k = 0; k < NSHARDS; k++)
+    if ((shard[k].blocks.nUsed + shard[k].clusters.nUsed) != 0)
+       return true;
+
+  return false;
+}
+
+/*
+ *  Get the number of nodes of each pool of a shard, for a given size of the storage area.
+ *
+ *  The storage area is split evenly by the shards and, in each shard, there are as many block nodes as cluster nodes.
+ */
+
+static uint32_t poolNodes (uint32_t size)
+{
+  uint64_t nNodes;                               /* number of nodes of a pool */
+
+  if (size == 0) return SHARD_BUFFERS;           /* the size is not set */
+
+  nNodes = ((uint64_t) size << 20) / NSHARDS / NODE_PAIR;
+
+  return (nNodes < SHARD_MIN) ? SHARD_MIN : (uint32_t) nNodes;
+}
+
+/*
+ *  Allocate the nodes of all the pools, their contents and the rings of ghost entries, inside the critical region.
+ */
+
+static int allocPools (uint32_t nNodes)
+{
+  struct pool *p;                                /* pointer to a pool */
+  uint32_t j, k;                                 /* counting variables */
+
+  for (k = 0; k < NSHARDS; k++)
+    for (j = 0; j < 2; j++)
+    { p = (j == 0) ? &shard[k].blocks : &shard[k].clusters;
+      p->nNodes = nNodes;
+      p->kOut = (nNodes / 2 < 1) ? 1 : nNodes / 2;
+      p->node = calloc (nNodes, sizeof (SOBufferCacheNode));
+      p->ghost = calloc (p->kOut, sizeof (uint32_t));
+      p->data = mmap (NULL, (size_t) nNodes * p->size * BLOCK_SIZE, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (p->data == MAP_FAILED) p->data = NULL;
+      if ((p->node == NULL) || (p->ghost == NULL) || (p->data == NULL))
+         { freePools ();
+           return -ENOMEM;
+         }
+    }
+  if (((flushKey = malloc (2 * (size_t) nNodes * sizeof (struct key))) == NULL) ||
+      ((dirty = malloc (NSHARDS * 2 * (size_t) nNodes * sizeof (SOBufferCacheNode *))) == NULL))
+     { freePools ();
+       return -ENOMEM;
+     }
+
+  return 0;
+}
+
+/*
+ *  Release the nodes of all the pools, their contents and the rings of ghost entries, inside the critical region.
+ */
+
+static void freePools (void)
+{
+  struct pool *p;                                /* pointer to a pool */
+  uint32_t j, k;                                 /* counting variables */
+
+  for (k = 0; k < NSHARDS; k++)
+    for (j = 0; j < 2; j++)
+    { p = (j == 0) ? &shard[k].blocks : &shard[k].clusters;
+      if (p->data != NULL) munmap (p->data, (size_t) p->nNodes * p->size * BLOCK_SIZE);
+      free (p->node);
+      free (p->ghost);
+      p->node = NULL;
+      p->data = NULL;
+      p->ghost = NULL;
+      p->free = NULL;
+      p->nNodes = p->limit = 0;
+    }
+  free (flushKey);
+  free (dirty);
+  flushKey = NULL;
+  dirty = NULL;
+}
+
+/*
+ *  Check if a cluster is stored in the storage area, inside the critical region (of its shard, at least).
+ */
+
+static bool clusterStored (uint32_t n)
+{
+  struct shard *s = shardOf (n);                 /* shard of the cluster */
+
+  return (commType == BUF) && (searchClusterNodeOnN (&s->index, n, s->clusters.nLHead) != NULL);
+}
+
+/*
+ *  Reset the storage area: all the nodes are returned to the free lists of their pools and nothing stays pinned.
+ */
+
+static void resetPools (void)
+{
+  struct shard *s;                               /* pointer to a shard */
+  struct pool *p;                                /* pointer to a pool */
+  uint32_t i, j, k;                              /* counting variables */
+
+  for (k = 0; k < NSHARDS; k++)
+  { s = &shard[k];
+    for (j = 0; j < 2; j++)
+    { p = (j == 0) ? &s->blocks : &s->clusters;
+      p->limit = p->nNodes;
+      for (i = 0; i < p->nNodes; i++)
+      { p->node[i].buffer = p->data + (size_t) i * p->size * BLOCK_SIZE;
+        p->node[i].size = p->size;
+        p->node[i].stat = SAME;
+        p->node[i].pins = 0;
+        p->node[i].n_next = (i + 1 < p->nNodes) ? &p->node[i+1] : NULL;
+      }
+      p->free = (p->nNodes != 0) ? &p->node[0] : NULL;
+      p->kIn = p->nNodes / 4;
+    }
+    s->blocks.nUsed = s->clusters.nUsed = 0;
+    s->blocks.nLHead = s->blocks.lATLHead = s->blocks.lATLTail = s->blocks.inHead = s->blocks.inTail = NULL;
+    s->clusters.nLHead = s->clusters.lATLHead = s->clusters.lATLTail = s->clusters.inHead = s->clusters.inTail = NULL;
+    s->blocks.nIn = s->blocks.nOut = s->blocks.next = 0;
+    s->clusters.nIn = s->clusters.nOut = s->clusters.next = 0;
+    s->blockCeiling = 0;
+    s->clusterFloor = UINT32_MAX;
+    s->nChanged = 0;
+  }
+  pthread_mutex_lock (&streamLock);
+  for (i = 0; i < RA_STREAMS; i++)
+  { stream[i].next = UINT32_MAX;
+    stream[i].window = 0;
+  }
+  pthread_mutex_unlock (&streamLock);
+  pthread_mutex_lock (&pinLock);
+  for (i = 0; i < UNBUF_PINS; i++)
+    pinned[i].pins = 0;
+  pthread_mutex_unlock (&pinLock);
+}
+
+/*
+ *  Change the number of nodes of a pool in service, inside the critical region of its shard.
+ *
+ *  The nodes taken out of service are the last ones: those assigned to a block (cluster) are written back, if they are
+ *  changed, and freed, their contents is returned to the system and they are left out of the list of free nodes. A
+ *  pinned node, and so those before it, stays in service. The nodes brought back into service are added to the list of
+ *  free nodes.
+ */
+
+static int resizePool (struct pool *p, uint32_t limit)
+{
+  SOBufferCacheNode *node, **p_node;             /* pointer to a node / to the link to a free node */
+  size_t page = (size_t) sysconf (_SC_PAGESIZE); /* size of a page of main memory */
+  size_t from, to;                               /* range of the contents which is returned to the system */
+  uint32_t i;                                    /* counting variable */
+  int stat = 0;                                  /* status of operation */
+
+  if (limit > p->nNodes) limit = p->nNodes;
+  if (limit < SHARD_MIN) limit = SHARD_MIN;
+
+  /* bring nodes back into service */
+
+  for (i = p->limit; i < limit; i++)
+  { p->node[i].n_next = p->free;
+    p->free = &p->node[i];
+  }
+
+  /* take nodes out of service, the last one first */
+
+  for (i = p->limit; i > limit; i--)
+  { node = &p->node[i-1];
+    p_node = &p->free;
+    while ((*p_node != NULL) && (*p_node != node))
+      p_node = &(*p_node)->n_next;
+    if (*p_node != NULL)
+       *p_node = node->n_next;                   /* the node is free */
+       else { if (node->pins != 0) break;        /* the node is pinned */
+              if (node->stat == CHANGED)
+                 { if ((stat = writeDevice (node->n, node->size, node->buffer)) != 0) break;
+                   countWriteBack (node);
+                 }
+              p->shard->access.region[regionOf (node->n, node->size)].evictions += 1;
+              if ((stat = releaseNode (p, node)) != 0) return stat;
+              p->free = node->n_next;            /* releaseNode put it at the head of the list of free nodes */
+            }
+  }
+  if (i < p->limit)
+     { from = ((size_t) i * p->size * BLOCK_SIZE + page - 1) & ~(page - 1);
+       to = (size_t) p->limit * p->size * BLOCK_SIZE;
+       if (from < to) madvise (p->data + from, to - from, MADV_DONTNEED);
+     }
+  p->limit = (i > limit) ? i : limit;
+  p->kIn = p->limit / 4;
+
+  if (stat != 0) return stat;
+
+  return (p->limit == limit) ? 0 : -EBUSY;
+}
+
+/*
+ *  Get the node of the storage area which holds a block: either a block node or the cluster node the block belongs to.
+ *
+ *  The look ups are bounded by the highest block ever stored in a block node and by the lowest cluster ever stored in
+ *  each shard, so that accessing the table of inodes seldom looks for clusters and vice versa.
+ */
+
+static SOBufferCacheNode *holder (uint32_t n)
+{
+  struct shard *s = shardOf (n);                 /* shard of a node which may hold the block */
+  SOBufferCacheNode *node;                       /* pointer to a node of the storage area */
+  uint32_t i;                                    /* counting variable */
+
+  if ((n <= s->blockCeiling) && ((node = searchNodeOnN (&s->index, n, s->blocks.nLHead)) != NULL))
+     return node;
+  for (i = 0; (i < BLOCKS_PER_CLUSTER) && (i <= n); i++)
+  { s = shardOf (n - i);
+    if ((n - i >= s->clusterFloor) && ((node = searchClusterNodeOnN (&s->index, n - i, s->clusters.nLHead)) != NULL))
+       return node;
+  }
+
+  return NULL;
+}
+
+/*
+ *  Look up a block in the storage area.
+ *
+ *  If it is there, the node which holds it is moved to the head of the list based on the last access time of its pool
+ *  and a pointer to the block contents in the node is stored.
+ */
+
+static SOBufferCacheNode *lookUpBlock (uint32_t n, unsigned char **p_data)
+{
+  SOBufferCacheNode *node;                       /* pointer to the node holding the block */
+
+  if ((node = holder (n)) != NULL)
+     { *p_data = node->buffer + (n - node->n) * BLOCK_SIZE;
+       moveAtHead (node);
+     }
+
+  return node;
+}
+
+/*
+ *  Get the pool of a node assigned to a block (cluster).
+ */
+
+static struct pool *poolOf (SOBufferCacheNode *node)
+{
+  struct shard *s = shardOf (node->n);           /* shard of the node */
+
+  return (node->size == 1) ? &s->blocks : &s->clusters;
+}
+
+/*
+ *  Get the region of the storage device of a block (cluster).
+ */
+
+static uint32_t regionOf (uint32_t n, uint32_t size)
+{
+  if (n < itableStart) return CACHE_SUPERBLOCK;
+  if (dzoneStart == 0)
+     return (size == 1) ? CACHE_INODETABLE : CACHE_DATAZONE;       /* the region is told by the way of access */
+
+  return (n < dzoneStart) ? CACHE_INODETABLE : CACHE_DATAZONE;
+}
+
+/*
+ *  Count a read, write or pin of a block (cluster), inside the critical region (of its shard, at least).
+ */
+
+static void countAccess (uint32_t n, uint32_t size, bool hit)
+{
+  SOBufferCacheRegionStats *r = &shardOf (n)->access.region[regionOf (n, size)];   /* statistics of its region */
+
+  if (hit)
+     r->hits += 1;
+     else r->misses += 1;
+}
+
+/*
+ *  Count the writing of the contents of a node to the storage device, inside the critical region (of its shard, at
+ *  least).
+ */
+
+static void countWriteBack (SOBufferCacheNode *node)
+{
+  shardOf (node->n)->access.region[regionOf (node->n, node->size)].writebacks += 1;
+}
+
+/*
+ *  Move a node to the head of the list based on the last access time of its pool.
+ *
+ *  A node in the first-in first-out queue of the 2Q policy stays where it is: the accesses which closely follow the
+ *  first one tell nothing about the block (cluster) being accessed often.
+ */
+
+static void moveAtHead (SOBufferCacheNode *node)
+{
+  struct pool *p = poolOf (node);                /* pool of the node */
+
+  if (node->queue == AM)
+     moveNodeAtHeadLAT (node, &p->lATLHead, &p->lATLTail);
+}
+
+/*
+ *  Select the node of a pool to be replaced: the least recently accessed one which is not pinned.
+ *
+ *  Under the 2Q policy, it is taken from the first-in first-out queue, instead, if the queue is longer than allowed or
+ *  every node of the list based on the last access time is pinned (or there is none).
+ */
+
+static SOBufferCacheNode *victim (struct pool *p)
+{
+  SOBufferCacheNode *in, *am;                    /* oldest unpinned nodes of the queue and of the list */
+
+  for (in = p->inTail; (in != NULL) && (in->pins != 0); in = in->access_prev) ;
+  for (am = p->lATLTail; (am != NULL) && (am->pins != 0); am = am->access_prev) ;
+  if ((in != NULL) && ((p->nIn > p->kIn) || (am == NULL)))
+     return in;
+
+  return (am != NULL) ? am : in;
+}
+
+/*
+ *  Get a node of a pool to be assigned to a new block (cluster).
+ *
+ *  Free nodes are used first; afterwards, the node selected for replacement is extracted and its contents, if changed,
+ *  is written back to the storage device. If it comes from the first-in first-out queue of the 2Q policy, its block
+ *  (cluster) is remembered.
+ */
+
+static int getFreeNode (struct pool *p, SOBufferCacheNode **p_node)
+{
+  SOBufferCacheNode *node;                       /* pointer to the selected node */
+  SOBufferCacheNode **p_head, **p_tail;          /* pointers to the head and the tail of the list of the node */
+  int stat;                                      /* status of operation */
+
+  if (p->free != NULL)
+     { node = p->free;
+       p->free = node->n_next;
+     }
+     else { if ((node = victim (p)) == NULL)
+               return -ENOBUFS;                  /* all the nodes are pinned */
+            if (node->queue == A1IN)
+               { p_head = &p->inHead;
+                 p_tail = &p->inTail;
+               }
+               else { p_head = &p->lATLHead;
+                      p_tail = &p->lATLTail;
+                    }
+            if (extractNode (&p->shard->index, node, &p->nLHead, p_head, p_tail) != 0)
+               return -ELIBBAD;
+            if (node->stat == CHANGED)
+               { p->shard->stats.evictions += 1;
+                 if ((stat = writeDevice (node->n, node->size, node->buffer)) != 0)
+                    { insertNode (&p->shard->index, node, &p->nLHead, p_head, p_tail);   /* keep the changed contents */
+                      return stat;
+                    }
+                 countWriteBack (node);
+                 markSame (node);
+               }
+            p->shard->access.region[regionOf (node->n, node->size)].evictions += 1;
+            p->nUsed -= 1;
+            if (node->queue == A1IN)
+               { p->nIn -= 1;
+                 rememberNode (p, node);
+               }
+          }
+  node->n_prev = node->n_next = NULL;
+  node->access_prev = node->access_next = NULL;
+  node->stat = SAME;
+  node->pins = 0;
+
+  *p_node = node;
+  return 0;
+}
+
+/*
+ *  Remember the block (cluster) of a node replaced from the first-in first-out queue of a pool.
+ *
+ *  It is entered in the ring of the pool and given a ghost entry in the index of its shard; if the ring is full, the
+ *  block (cluster) which is there for the longest time is forgotten.
+ */
+
+static void rememberNode (struct pool *p, SOBufferCacheNode *node)
+{
+  if (p->nOut == p->kOut)
+     leaveGhost (&p->shard->index, p->ghost[p->next], p->size);
+     else p->nOut += 1;
+  p->ghost[p->next] = node->n;
+  p->next = (p->next + 1) % p->kOut;
+  enterGhost (&p->shard->index, node->n, p->size);
+}
+
+/*
+ *  Store a node, already assigned to a block (cluster), in its pool.
+ *
+ *  Under the 2Q policy, it is stored in the list based on the last access time only if its block (cluster) is
+ *  remembered; otherwise, it is stored in the first-in first-out queue.
+ */
+
+static void storeNode (struct pool *p, SOBufferCacheNode *node)
+{
+  struct shard *s = p->shard;                    /* shard of the pool */
+
+  if ((replPolicy == CACHE_LRU) || leaveGhost (&s->index, node->n, node->size))
+     { node->queue = AM;
+       insertNode (&s->index, node, &p->nLHead, &p->lATLHead, &p->lATLTail);
+     }
+     else { node->queue = A1IN;
+            insertNode (&s->index, node, &p->nLHead, &p->inHead, &p->inTail);
+            p->nIn += 1;
+          }
+  p->nUsed += 1;
+  if ((node->size == 1) && (node->n > s->blockCeiling)) s->blockCeiling = node->n;
+  if ((node->size != 1) && (node->n < s->clusterFloor)) s->clusterFloor = node->n;
+}
+
+/*
+ *  Release a node stored in its pool, whatever its last access time, and return it to the free list.
+ *
+ *  Its contents, if changed, is supposed to have been saved beforehand.
+ */
+
+static int releaseNode (struct pool *p, SOBufferCacheNode *node)
+{
+  markSame (node);
+  if (node->queue == A1IN)
+     { if (extractNode (&p->shard->index, node, &p->nLHead, &p->inHead, &p->inTail) != 0)
+          return -ELIBBAD;
+       p->nIn -= 1;
+     }
+     else if (extractNode (&p->shard->index, node, &p->nLHead, &p->lATLHead, &p->lATLTail) != 0)
+             return -ELIBBAD;
+  node->n_next = p->free;
+  p->free = node;
+  p->nUsed -= 1;
+
+  return 0;
+}
+
+/*
+ *  Release the stored clusters which overlap the one starting at a given block without being it.
+ *
+ *  It only happens if a cluster is accessed out of the alignment of the data zone. Their contents, if changed, is
+ *  written back to the storage device first.
+ */
+
+static int dropOverlaps (uint32_t n)
+{
+  struct shard *sh;                              /* shard of an overlapping cluster */
+  SOBufferCacheNode *node;                       /* pointer to an overlapping cluster node */
+  uint32_t s;                                    /* first block of an overlapping cluster */
+  int stat;                                      /* status of operation */
+
+  for (s = (n < BLOCKS_PER_CLUSTER) ? 0 : n - BLOCKS_PER_CLUSTER + 1; s < n + BLOCKS_PER_CLUSTER; s++)
+  { sh = shardOf (s);
+    if ((s != n) && (s >= sh->clusterFloor) && ((node = searchClusterNodeOnN (&sh->index, s, sh->clusters.nLHead)) != NULL))
+       { if (node->stat == CHANGED)
+            { sh->stats.evictions += 1;
+              if ((stat = writeDevice (s, BLOCKS_PER_CLUSTER, node->buffer)) != 0) return stat;
+              countWriteBack (node);
+            }
+         sh->access.region[regionOf (s, BLOCKS_PER_CLUSTER)].evictions += 1;
+         if ((stat = releaseNode (&sh->clusters, node)) != 0) return stat;
+       }
+  }
+
+  return 0;
+}
+
+/*
+ *  Check if any block of the cluster starting at a given block is pinned in a block node of its own, or any stored
+ *  cluster which overlaps it without being it is pinned.
+ */
+
+static bool pinsOverlap (uint32_t n)
+{
+  struct shard *sh;                              /* shard of a block node or an overlapping cluster */
+  SOBufferCacheNode *node;                       /* pointer to a node of the storage area */
+  uint32_t s;                                    /* block of the cluster / first block of an overlapping cluster */
+
+  for (s = (n < BLOCKS_PER_CLUSTER) ? 0 : n - BLOCKS_PER_CLUSTER + 1; s < n + BLOCKS_PER_CLUSTER; s++)
+  { sh = shardOf (s);
+    if ((s != n) && (s >= sh->clusterFloor) &&
+        ((node = searchClusterNodeOnN (&sh->index, s, sh->clusters.nLHead)) != NULL) && (node->pins != 0))
+       return true;
+    if ((s >= n) && (s <= sh->blockCeiling) &&
+        ((node = searchNodeOnN (&sh->index, s, sh->blocks.nLHead)) != NULL) && (node->pins != 0))
+       return true;
+  }
+
+  return false;
+}
+
+/*
+ *  Get the node which holds a pinned block (cluster), inside the critical region.
+ *
+ *  A pinned block may be held by a cluster node.
+ */
+
+static SOBufferCacheNode *pinnedNode (uint32_t n, uint32_t size)
+{
+  struct shard *s = shardOf (n);                 /* shard of the block (cluster) */
+  SOBufferCacheNode *node;                       /* pointer to the node holding the block (cluster) */
+
+  node = (size == 1) ? holder (n) : searchClusterNodeOnN (&s->index, n, s->clusters.nLHead);
+
+  return ((node != NULL) && (node->pins != 0)) ? node : NULL;
+}
+
+/*
+ *  Pin a block (cluster) in unbuffered mode: it is read into a private buffer, unless it is already pinned.
+ */
+
+static int pinCopy (uint32_t n, uint32_t size, void **p_data)
+{
+  struct pinned *p;                              /* pointer to the entry of the block (cluster) */
+  uint32_t i = 0;                                /* counting variable */
+  int stat = 0;                                  /* status of operation */
+
+  pthread_mutex_lock (&pinLock);
+  if ((p = pinnedCopy (n, size)) == NULL)
+     { while ((i < UNBUF_PINS) && (pinned[i].pins != 0))
+         i += 1;
+       if (i == UNBUF_PINS)
+          stat = -ENOBUFS;                       /* all the entries are in use */
+          else { p = &pinned[i];
+                 p->n = n;
+                 p->size = size;
+                 stat = readDevice (n, size, p->data);
+               }
+     }
+  if (stat == 0)
+     { p->pins += 1;
+       *p_data = p->data;
+     }
+  pthread_mutex_unlock (&pinLock);
+
+  return stat;
+}
+
+/*
+ *  Get the entry of a block (cluster) pinned in unbuffered mode, with the lock of the entries held.
+ */
+
+static struct pinned *pinnedCopy (uint32_t n, uint32_t size)
+{
+  uint32_t i;                                    /* counting variable */
+
+  for (i = 0; i < UNBUF_PINS; i++)
+    if ((pinned[i].pins != 0) && (pinned[i].n == n) && (pinned[i].size == size))
+       return &pinned[i];
+
+  return NULL;
+}
+
+/*
+ *  Write a block (cluster) to the storage device in unbuffered mode.
+ *
+ *  The blocks it shares with those pinned meanwhile (but the one being written, if it is itself pinned) are updated, so
+ *  that their private copies stay the same as the storage device.
+ */
+
+static int writeUnbuffered (uint32_t n, uint32_t size, void *buf)
+{
+  struct pinned *p;                              /* pointer to the entry of a pinned block (cluster) */
+  uint32_t first, last, i;                       /* range of the shared blocks / counting variable */
+  int stat;                                      /* status of operation */
+
+  if ((stat = writeDevice (n, size, buf)) != 0) return stat;
+
+  pthread_mutex_lock (&pinLock);
+  for (i = 0; i < UNBUF_PINS; i++)
+  { p = &pinned[i];
+    if ((p->pins == 0) || (p->data == buf)) continue;
+    first = (p->n > n) ? p->n : n;
+    last = (p->n + p->size < n + size) ? p->n + p->size : n + size;
+    if (first < last)
+       memcpy (p->data + (first - p->n) * BLOCK_SIZE, (unsigned char *) buf + (first - n) * BLOCK_SIZE,
+               (last - first) * BLOCK_SIZE);
+  }
+  pthread_mutex_unlock (&pinLock);
+
+  return 0;
+}
+
+/*
+ *  Assign a cluster node to a cluster which is not stored in the storage area.
+ *
+ *  If required, the cluster contents is read from the storage device. The blocks of the cluster which are stored in
+ *  block nodes are absorbed by the new node: their contents is more recent than that of the storage device. Nothing
+ *  is done if any of them, or any overlapping cluster, is pinned, as its node can not be released.
+ */
+
+static int loadCluster (uint32_t n, bool fill, SOBufferCacheNode **p_node)
+{
+  struct pool *p = &shardOf (n)->clusters;       /* pool of the cluster node */
+  struct shard *s;                               /* shard of a block node */
+  SOBufferCacheNode *node, *block;               /* pointers to the cluster node and to a block node */
+  uint32_t i;                                    /* counting variable */
+  int stat;                                      /* status of operation */
+
+  if (pinsOverlap (n)) return -EBUSY;
+  if ((stat = dropOverlaps (n)) != 0) return stat;
+  if ((stat = getFreeNode (p, &node)) != 0) return stat;
+  if (fill && ((stat = readDevice (n, BLOCKS_PER_CLUSTER, node->buffer)) != 0))
+     { node->n_next = p->free;
+       p->free = node;
+       return stat;
+     }
+  node->n = n;
+  for (i = 0; i < BLOCKS_PER_CLUSTER; i++)
+  { s = shardOf (n + i);
+    if ((n + i <= s->blockCeiling) && ((block = searchNodeOnN (&s->index, n + i, s->blocks.nLHead)) != NULL))
+       { memcpy (node->buffer + i * BLOCK_SIZE, block->buffer, BLOCK_SIZE);
+         if (block->stat == CHANGED)
+            { markChanged (node);
+              if (block->changed < node->changed) node->changed = block->changed;
+            }
+         if ((stat = releaseNode (&s->blocks, block)) != 0) return stat;
+       }
+  }
+  storeNode (p, node);
+
+  *p_node = node;
+  return 0;
+}
+
+/*
+ *  Get the readahead window of a cluster which is going to be read.
+ *
+ *  If the cluster is the one expected next by a stream, the window of the stream doubles; otherwise, the least
+ *  recently accessed stream is replaced by a new one, whose window is a single cluster. The stream becomes the most
+ *  recently accessed one.
+ */
+
+static uint32_t readAheadWindow (uint32_t n)
+{
+  struct stream s;                               /* stream the cluster belongs to */
+  uint32_t i = 0;                                /* counting variable */
+
+  pthread_mutex_lock (&streamLock);
+  while ((i < RA_STREAMS - 1) && (stream[i].next != n))
+    i += 1;
+  if (stream[i].next == n)
+     s.window = (2 * stream[i].window < RA_MAX) ? 2 * stream[i].window : RA_MAX;
+     else s.window = 1;
+  s.next = n + BLOCKS_PER_CLUSTER;
+  for (; i > 0; i--)
+    stream[i] = stream[i-1];
+  stream[0] = s;
+  pthread_mutex_unlock (&streamLock);
+
+  return s.window;
+}
+
+/*
+ *  Assign cluster nodes to a missing cluster and to the following ones of its readahead window and read them in a
+ *  single transfer.
+ *
+ *  The window is cut short at the first cluster which is beyond the end of the device or has any of its blocks already
+ *  stored. If the missing cluster has itself any of its blocks stored, it is loaded on its own. The nodes are all got
+ *  before any of them is stored, so that none of the clusters is replaced before it is read.
+ */
+
+static int readAhead (uint32_t n, uint32_t window, SOBufferCacheNode **p_node)
+{
+  SOBufferCacheNode *node[RA_MAX];               /* cluster nodes of the window */
+  struct pool *pool[RA_MAX];                     /* pools of the cluster nodes of the window */
+  void *buf[RA_MAX];                             /* contents of the cluster nodes of the window */
+  uint32_t count, i, k;                          /* number of clusters to be read / counting variables */
+  uint32_t m;                                    /* first block of a cluster of the window */
+  int stat;                                      /* status of operation */
+
+  for (count = 0, m = n; (count < window) && (m + BLOCKS_PER_CLUSTER <= bnmax); count++, m += BLOCKS_PER_CLUSTER)
+  { i = 0;
+    while ((i < BLOCKS_PER_CLUSTER) && (holder (m + i) == NULL))
+      i += 1;
+    if (i < BLOCKS_PER_CLUSTER) break;           /* some of its blocks are already stored */
+  }
+  if (count < 2) return loadCluster (n, true, p_node);
+
+  for (k = 0; k < count; k++)
+  { pool[k] = &shardOf (n + k * BLOCKS_PER_CLUSTER)->clusters;
+    if ((stat = getFreeNode (pool[k], &node[k])) != 0) break;
+    buf[k] = node[k]->buffer;
+  }
+  if (k == count)
+     { pthread_mutex_lock (&devLock);
+       stat = soReadRawClusters (n, count, buf);
+       pthread_mutex_unlock (&devLock);
+     }
+  if (stat != 0)
+     { for (i = 0; i < k; i++)
+       { node[i]->n_next = pool[i]->free;
+         pool[i]->free = node[i];
+       }
+       return stat;
+     }
+
+  /* the cluster which was asked for is stored last, as the most recently accessed */
+
+  for (k = count; k > 0; k--)
+  { node[k-1]->n = n + (k - 1) * BLOCKS_PER_CLUSTER;
+    storeNode (pool[k-1], node[k-1]);
+  }
+
+  *p_node = node[0];
+  return 0;
+}
+
+/*
+ *  Read a block (cluster) from the storage device, which is locked meanwhile.
+ */
+
+static int readDevice (uint32_t n, uint32_t size, void *buf)
+{
+  int stat;                                      /* status of operation */
+
+  pthread_mutex_lock (&devLock);
+  stat = (size == 1) ? soReadRawBlock (n, buf) : soReadRawCluster (n, buf);
+  pthread_mutex_unlock (&devLock);
+
+  return stat;
+}
+
+/*
+ *  Write a block (cluster) to the storage device, which is locked meanwhile.
+ */
+
+static int writeDevice (uint32_t n, uint32_t size, void *buf)
+{
+  int stat;                                      /* status of operation */
+
+  pthread_mutex_lock (&devLock);
+  stat = (size == 1) ? soWriteRawBlock (n, buf) : soWriteRawCluster (n, buf);
+  pthread_mutex_unlock (&devLock);
+
+  return stat;
+}
+
+/*
+ *  Mark the contents of a node, already assigned to a block (cluster), as changed.
+ *
+ *  The instant of the first change since it was last written is recorded. If its shard has more changed nodes than
+ *  allowed, the flusher is woken up.
+ */
+
+static void markChanged (SOBufferCacheNode *node)
+{
+  struct shard *s;                               /* shard of the node */
+
+  if (node->stat == CHANGED) return;
+
+  s = shardOf (node->n);
+  node->stat = CHANGED;
+  node->changed = clockNs ();
+  s->nChanged += 1;
+  if (flusherOn && (flushRatio != 0) && (100 * s->nChanged > flushRatio * (s->blocks.limit + s->clusters.limit)))
+     { pthread_mutex_lock (&flushLock);
+       flushWanted = true;
+       pthread_cond_signal (&flushGo);
+       pthread_mutex_unlock (&flushLock);
+     }
+}
+
+/*
+ *  Mark the contents of a node as the same as the corresponding one in the storage device.
+ */
+
+static void markSame (SOBufferCacheNode *node)
+{
+  if (node->stat != CHANGED) return;
+
+  node->stat = SAME;
+  shardOf (node->n)->nChanged -= 1;
+}
+
+/*
+ *  Submit the writing of the contents of a node to the storage device, which is supposed to be locked.
+ */
+
+static int submitNode (SOBufferCacheNode *node)
+{
+  if (node->size == 1)
+     return soSubmitWriteRawBlock (node->n, node->buffer);
+     else return soSubmitWriteRawCluster (node->n, node->buffer);
+}
+
+/*
+ *  Write back the contents of all the nodes of the storage area whose status is marked changed, inside the critical
+ *  region (of all the shards).
+ *
+ *  They are collected from all the shards and sorted by their physical block number, so that the nodes holding
+ *  contiguous blocks (clusters) are written in runs, as \e writeNodes does; only when all of them were carried out
+ *  successfully, is their status marked same.
+ */
+
+static int writeBackNodes (void)
+{
+  struct pool *p;                                /* pointer to a pool of the storage area */
+  SOBufferCacheNode *node;                       /* pointer to a node of the storage area */
+  uint32_t i, k, nDirty = 0;                     /* counting variables / number of changed nodes */
+  int stat;                                      /* status of operation */
+
+  for (k = 0; k < 2 * NSHARDS; k++)
+  { p = (k % 2 == 0) ? &shard[k/2].blocks : &shard[k/2].clusters;
+    for (i = 0; i < p->nUsed; i++)
+    { node = (i == 0) ? getFirstNodeOnN (&shard[k/2].index, p->nLHead) : getNextNodeOnN (&shard[k/2].index);
+      if (node == NULL) return -ELIBBAD;
+      if (node->stat == CHANGED) dirty[nDirty++] = node;
+    }
+  }
+  if (nDirty == 0) return 0;
+
+  qsort (dirty, nDirty, sizeof (SOBufferCacheNode *), compareNodes);
+  if ((stat = writeNodes (dirty, nDirty)) != 0) return stat;
+  for (i = 0; i < nDirty; i++)
+  { countWriteBack (dirty[i]);
+    markSame (dirty[i]);
+  }
+
+  return 0;
+}
+
+/*
+ *  Write back the contents of a set of changed nodes, sorted by their physical block number, inside the critical
+ *  region (of their shards, at least).
+ *
+ *  Nodes holding contiguous blocks (clusters) make up a run, which is written by a single vectored write of, at most,
+ *  WB_BLOCKS blocks at a time. The writing of a node on its own is submitted, and all of them are waited for at the
+ *  end, so that the device queue is kept deep. The status of the nodes is left unchanged.
+ */
+
+static int writeNodes (SOBufferCacheNode *node[], uint32_t nNodes)
+{
+  void *buf[WB_BLOCKS];                          /* contents of the blocks of the current piece of a run */
+  uint32_t i, j, k, b, nBlks;                    /* counting variables / number of blocks of the current piece */
+  int stat = 0;                                  /* status of operation */
+
+  pthread_mutex_lock (&devLock);
+  for (i = 0; (i < nNodes) && (stat == 0); i = j)
+  { j = i + 1;
+    while ((j < nNodes) && (node[j]->n == node[j-1]->n + node[j-1]->size))
+      j += 1;                                    /* contiguous blocks (clusters) */
+    if (j - i == 1)
+       { stat = submitNode (node[i]);
+         continue;
+       }
+    for (k = i, nBlks = 0; (k < j) && (stat == 0); k++)
+    { if (nBlks + node[k]->size > WB_BLOCKS)
+         { stat = soWriteRawBlocks (node[k]->n - nBlks, nBlks, buf);
+           nBlks = 0;
+         }
+      for (b = 0; b < node[k]->size; b++)
+        buf[nBlks++] = node[k]->buffer + b * BLOCK_SIZE;
+    }
+    if (stat == 0)
+       stat = soWriteRawBlocks (node[j-1]->n + node[j-1]->size - nBlks, nBlks, buf);
+  }
+  if (stat != 0)
+     soWaitRawIO ();
+     else stat = soWaitRawIO ();
+  pthread_mutex_unlock (&devLock);
+
+  return stat;
+}
+
+/*
+ *  Start the flusher thread, inside the critical region (of all the shards).
+ */
+
+static int startFlusher (void)
+{
+  pthread_condattr_t attr;                       /* attributes of the condition which wakes up the flusher */
+
+  pthread_condattr_init (&attr);
+  pthread_condattr_setclock (&attr, CLOCK_MONOTONIC);
+  pthread_cond_init (&flushGo, &attr);
+  pthread_condattr_destroy (&attr);
+  flusherStop = flushWanted = false;
+  if (pthread_create (&flushThread, NULL, flusher, NULL) != 0)
+     { pthread_cond_destroy (&flushGo);
+       return -EAGAIN;
+     }
+  flusherOn = true;
+
+  return 0;
+}
+
+/*
+ *  Terminate the flusher thread, if it is running.
+ *
+ *  Changes stop waking it up before it is asked to terminate, so that the condition is not signaled once destroyed.
+ */
+
+static void stopFlusher (void)
+{
+  bool on;                                       /* the flusher thread is running */
+
+  lockShards (ALL_SHARDS);
+  on = flusherOn;
+  flusherOn = false;
+  unlockShards (ALL_SHARDS);
+  if (!on) return;
+
+  pthread_mutex_lock (&flushLock);
+  flusherStop = true;
+  pthread_cond_signal (&flushGo);
+  pthread_mutex_unlock (&flushLock);
+  pthread_join (flushThread, NULL);
+  pthread_cond_destroy (&flushGo);
+}
+
+/*
+ *  Life cycle of the flusher thread.
+ *
+ *  It wakes up every half of the age threshold (or every second, if there is none), or when a shard has too many
+ *  changed nodes, and writes back the nodes of every shard which are due, a shard at a time. Whether there are too many
+ *  changed nodes is decided on the whole storage area.
+ */
+
+static void *flusher (void *arg)
+{
+  struct timespec ts;                            /* instant when the flusher wakes up */
+  uint64_t wake;                                 /* the same, in nanoseconds */
+  uint32_t k, nChanged, nNodes;                  /* counting variable / number of changed nodes / in service */
+  bool over;                                     /* there are too many changed nodes */
+
+  pthread_mutex_lock (&flushLock);
+  while (!flusherStop)
+  { if (!flushWanted)
+       { wake = clockNs () + ((flushAge != 0) ? (uint64_t) flushAge * 500000 : FLUSH_IDLE);
+         ts.tv_sec = (time_t) (wake / 1000000000);
+         ts.tv_nsec = (long) (wake % 1000000000);
+         pthread_cond_timedwait (&flushGo, &flushLock, &ts);
+         if (flusherStop) break;
+       }
+    flushWanted = false;
+    pthread_mutex_unlock (&flushLock);
+    for (k = 0, nChanged = nNodes = 0; k < NSHARDS; k++)
+    { pthread_mutex_lock (&shard[k].lock);
+      nChanged += shard[k].nChanged;
+      nNodes += shard[k].blocks.limit + shard[k].clusters.limit;
+      pthread_mutex_unlock (&shard[k].lock);
+    }
+    over = (flushRatio != 0) && (100 * nChanged > flushRatio * nNodes);
+    for (k = 0; k < NSHARDS; k++)
+    { pthread_mutex_lock (&shard[k].lock);
+      flushNodes (&shard[k], over);
+      pthread_mutex_unlock (&shard[k].lock);
+    }
+    pthread_mutex_lock (&flushLock);
+  }
+  pthread_mutex_unlock (&flushLock);
+
+  return NULL;
+}
+
+/*
+ *  Carry out a round of the flusher over a shard, inside its critical region.
+ *
+ *  All the changed nodes are due, if there are too many of them in the storage area; otherwise, only those changed
+ *  for longer than the age threshold. The nodes which are due are sorted by their physical block number and written
+ *  back in runs of, at most, FLUSH_RUN nodes. The critical region is left between runs, so that requests are kept
+ *  waiting for one run at most; hence, the nodes are looked up again before each run is written.
+ */
+
+static void flushNodes (struct shard *s, bool over)
+{
+  struct pool *pool[2] = { &s->blocks, &s->clusters };     /* pools of the shard */
+  SOBufferCacheNode *node;                       /* pointer to a node of the shard */
+  uint64_t limit = 0;                            /* latest instant of change of a node which is due */
+  uint32_t nKeys = 0;                            /* number of nodes which are due */
+  uint32_t i, k, count;                          /* counting variables / number of nodes of a run */
+
+  if ((commType != BUF) || (s->nChanged == 0)) return;
+
+  if (flushAge != 0) limit = clockNs () - (uint64_t) flushAge * 1000000;
+  for (k = 0; k < 2; k++)
+    for (i = 0; i < pool[k]->nUsed; i++)
+    { node = (i == 0) ? getFirstNodeOnN (&s->index, pool[k]->nLHead) : getNextNodeOnN (&s->index);
+      if ((node != NULL) && (node->stat == CHANGED) && (over || ((flushAge != 0) && (node->changed <= limit))))
+         { flushKey[nKeys].n = node->n;
+           flushKey[nKeys].size = node->size;
+           nKeys += 1;
+         }
+    }
+  if (nKeys == 0) return;
+  s->stats.rounds += 1;
+  qsort (flushKey, nKeys, sizeof (struct key), compareKeys);
+
+  for (i = 0; i < nKeys; i += count)
+  { if (i != 0)
+       { pthread_mutex_unlock (&s->lock);        /* let the requests which are waiting go on */
+         sched_yield ();
+         pthread_mutex_lock (&s->lock);
+       }
+    count = (nKeys - i < FLUSH_RUN) ? nKeys - i : FLUSH_RUN;
+    if (writeRun (s, &flushKey[i], count) != 0)
+       { s->stats.errors += 1;
+         return;
+       }
+  }
+}
+
+/*
+ *  Write back a run of changed nodes of a shard, sorted by their physical block number, inside its critical region.
+ *
+ *  The nodes which are no longer stored, or were written back meanwhile, are skipped. The others are written as
+ *  \e writeNodes does.
+ */
+
+static int writeRun (struct shard *s, struct key *k, uint32_t nKeys)
+{
+  SOBufferCacheNode *node[FLUSH_RUN];            /* nodes of the run */
+  uint32_t i, nNodes = 0;                        /* counting variable / number of nodes of the run */
+  int stat;                                      /* status of operation */
+
+  for (i = 0; i < nKeys; i++)
+  { node[nNodes] = (k[i].size == 1) ? searchNodeOnN (&s->index, k[i].n, s->blocks.nLHead)
+                                    : searchClusterNodeOnN (&s->index, k[i].n, s->clusters.nLHead);
+    if ((node[nNodes] != NULL) && (node[nNodes]->stat == CHANGED))
+       nNodes += 1;
+  }
+  if (nNodes == 0) return 0;
+
+  if ((stat = writeNodes (node, nNodes)) != 0) return stat;
+
+  for (i = 0; i < nNodes; i++)
+  { countWriteBack (node[i]);
+    markSame (node[i]);
+  }
+  s->stats.runs += 1;
+  s->stats.nodes += nNodes;
+
+  return 0;
+}
+
+/*
+ *  Compare two changed nodes by their physical block number (for qsort).
+ */
+
+static int compareKeys (const void *a, const void *b)
+{
+  uint32_t na = ((const struct key *) a)->n, nb = ((const struct key *) b)->n;
+
+  return (na > nb) - (na < nb);
+}
+
+/*
+ *  Compare two pointers to nodes by the physical block number of the nodes (for qsort).
+ */
+
+static int compareNodes (const void *a, const void *b)
+{
+  uint32_t na = (*(SOBufferCacheNode * const *) a)->n, nb = (*(SOBufferCacheNode * const *) b)->n;
+
+  return (na > nb) - (na < nb);
+}
+
+/*
+ *  Read the monotonic clock in nanoseconds.
+ */
+
+static uint64_t clockNs (void)
+{
+  struct timespec ts;                            /* clock reading */
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+
+  return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/*
+ *  Have the upper layer release the blocks (clusters) it keeps pinned, but does not use, outside any critical region.
+ *
+ *  It tells whether any of them was unpinned.
+ */
+
+static bool reclaim (void)
+{
+  int (*release) (void);                         /* function which releases the pins */
+
+  lockShards (ALL_SHARDS);                       /* enter critical region */
+  release = reclaimPins;
+  unlockShards (ALL_SHARDS);                     /* exit critical region */
+
+  return (release != NULL) && (release () > 0);
+}
@@ -10,7 +10,11 @@
  *  probability of access in the near future is higher.
  *
  *  The buffercache may be regarded as a storage area resident in main memory having the ability to store K data blocks
- *  of the device's storage space.
+ *  and L data clusters of the device's storage space.
+ *  Clusters are stored as a whole, in nodes of their own, so that accessing a stored cluster takes a single look up and
+ *  a miss a single transfer from the storage device. Blocks which are accessed on their own (the superblock and the
+ *  table of inodes) are stored in nodes of a block size. A block is never stored twice: a block of a stored cluster is
+ *  accessed in place and the blocks of a cluster which is going to be stored are absorbed by it.
  *  Data transfer between the main memory and the device works according to the following rules:
  *    \li every time a data block (cluster) is required for reading, it is looked up in the storage area: if it is
  *        there, the contents is copied to the supplied buffer location; otherwise, it is first read from the device
@@ -25,7 +29,42 @@
  *        if needed (the status is marked <em>changed</em>), is first transfered to the device, then it becomes
  *        available for a new assignment.
  *
+ *  The replacement policy just described (LRU) is the default one. Yet, a single long sequential access, like reading
+ *  a large file or checking the consistency of the file system, replaces by itself every block (cluster) which is
+ *  frequently accessed, the table of inodes, the directories and the clusters of indirect references. So, the
+ *  scan-resistant 2Q policy may be selected instead: a block (cluster) which is accessed for the first time is stored
+ *  in a first-in first-out queue, taking up a fourth of the nodes, whose further accesses are ignored; only when it is
+ *  accessed again, after being replaced while its replacement is still remembered, is it stored in the list based on
+ *  the last access time. Blocks (clusters) which are accessed only once are, therefore, replaced first, and they never
+ *  take the place of those accessed often.
+ *
+ *  Changed blocks (clusters) may also be written back by a flusher thread in the background, when the percentage of
+ *  changed nodes rises above a threshold or a change is older than another threshold. Nodes are then written in
+ *  ascending order of the physical block number, contiguous clusters in a single transfer, so that a request seldom
+ *  has to write back a node before it is replaced.
+ *
+ *  The buffercache may be accessed by concurrent callers. The storage area is split in shards by the physical block
+ *  number, each one with its own lock and lists based on the last access time, so that accesses to different blocks
+ *  (clusters) seldom wait for each other; the replacement policy applies to each shard on its own.
+ *
+ *  A block (cluster) may also be pinned, instead of being copied: a pointer to its contents in the storage area is
+ *  got, which stays valid until it is unpinned, as the node is never replaced meanwhile. The caller changes the
+ *  contents in place and then marks it \e changed. Metadata, like directories and clusters of references, may thus be
+ *  walked and updated without copying whole clusters back and forth. The contents of a pinned node is accessed outside
+ *  the critical region of the buffercache, so callers pinning the same block (cluster) must synchronize themselves.
+ *  In unbuffered mode, a pinned block (cluster) is read into a private buffer instead, which is written to the device
+ *  as soon as it is marked \e changed and is updated whenever any of its blocks is written through the buffercache.
+ *
  *  The following operations are defined:
+ *    \li set the operating mode of the storage device
+ *    \li set the replacement policy of the storage area
+ *    \li set the thresholds of the flusher thread
+ *    \li set the size of the storage area
+ *    \li resize the storage area in use
+ *    \li get the statistics of the writing back of changed nodes
+ *    \li set the regions of the storage device which the statistics of accesses are split by
+ *    \li get the statistics of accesses to the storage area, by region
+ *    \li print the statistics of accesses to the storage area, by region
  *    \li initialize the storage area and assign it to the storage device
  *    \li unassign the storage area from the storage device and perform the required housekeeping duties
  *    \li read a block of data from the buffercache
@@ -35,7 +74,11 @@
  *    \li read a cluster of data from the buffercache
  *    \li write a cluster of data to the buffercache
  *    \li flush a cluster of data to the storage device
- *    \li synchronize a cluster of data with the same cluster in the storage device.
+ *    \li synchronize a cluster of data with the same cluster in the storage device
+ *    \li synchronize the whole storage area with the storage device
+ *    \li pin a block (cluster) of data in the buffercache
+ *    \li mark a pinned block (cluster) of data as changed
+ *    \li unpin a block (cluster) of data.
  *
  *  \author Artur Carneiro Pereira - September 2007
  *  \author Miguel Oliveira e Silva - September 2009
@@ -49,12 +92,237 @@
 #ifndef SOFS_BUFFERCACHE_H_
 #define SOFS_BUFFERCACHE_H_
 
+#include <stdio.h>
 #include <stdint.h>
+
+#include "sofs_rawdisk.h"
+
 /** \brief the communication channel to the storage device is buffered */
 #define BUF    0
 /** \brief the communication channel to the storage device is unbuffered */
 #define UNBUF  1
 
+/** \brief replacement policy: the node accessed least recently is replaced */
+#define CACHE_LRU  0
+/** \brief replacement policy: scan-resistant 2Q, nodes accessed only once are replaced first */
+#define CACHE_2Q   1
+
+/** \brief maximum size of the storage area (in MiB) */
+#define CACHE_MAX_SIZE  (65536)
+
+/**
+ *  \brief Definition of the statistics of the writing back of changed nodes.
+ */
+
+typedef struct soBufferCacheFlushStats
+{
+   /** \brief number of times a request had to write back a changed node before replacing it */
+    uint64_t evictions;
+   /** \brief number of rounds of the flusher over a shard which found changed nodes to be written back */
+    uint64_t rounds;
+   /** \brief number of runs of nodes written back by the flusher */
+    uint64_t runs;
+   /** \brief number of nodes written back by the flusher */
+    uint64_t nodes;
+   /** \brief number of runs the flusher failed to write back */
+    uint64_t errors;
+   /** \brief number of nodes presently changed */
+    uint64_t changed;
+} SOBufferCacheFlushStats;
+
+/** \brief region of the storage device: the superblock */
+#define CACHE_SUPERBLOCK  0
+/** \brief region of the storage device: the table of inodes */
+#define CACHE_INODETABLE  1
+/** \brief region of the storage device: the data zone */
+#define CACHE_DATAZONE    2
+/** \brief number of regions of the storage device */
+#define CACHE_REGIONS     3
+
+/**
+ *  \brief Definition of the statistics of accesses to the storage area of a region of the storage device.
+ */
+
+typedef struct soBufferCacheRegionStats
+{
+   /** \brief number of reads, writes and pins of a block (cluster) which was stored */
+    uint64_t hits;
+   /** \brief number of reads, writes and pins of a block (cluster) which was not stored */
+    uint64_t misses;
+   /** \brief number of nodes replaced to store another block (cluster) */
+    uint64_t evictions;
+   /** \brief number of times the contents of a node was written to the storage device */
+    uint64_t writebacks;
+} SOBufferCacheRegionStats;
+
+/**
+ *  \brief Definition of the statistics of accesses to the storage area.
+ */
+
+typedef struct soBufferCacheStats
+{
+   /** \brief statistics of each region: \c CACHE_SUPERBLOCK, \c CACHE_INODETABLE and \c CACHE_DATAZONE */
+    SOBufferCacheRegionStats region[CACHE_REGIONS];
+} SOBufferCacheStats;
+
+/**
+ *  \brief Set the operating mode of the storage device.
+ *
+ *  The mode is applied every time the storage area is subsequently assigned to the storage device, until it is set
+ *  again.
+ *
+ *  \param mode operating mode of the storage device (durability mode | backend, see sofs_rawdisk.h)
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the operating mode is invalid
+ *  \return -\c EBUSY, if the storage area is already in use
+ */
+
+extern int soSetBufferCacheMode (uint32_t mode);
+
+/**
+ *  \brief Set the replacement policy of the storage area.
+ *
+ *  The policy is applied every time the storage area is subsequently assigned to the storage device, until it is set
+ *  again.
+ *
+ *  \param policy replacement policy (\c CACHE_LRU, by default, or \c CACHE_2Q)
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the replacement policy is invalid
+ *  \return -\c EBUSY, if the storage area is already in use
+ */
+
+extern int soSetBufferCachePolicy (uint32_t policy);
+
+/**
+ *  \brief Set the thresholds of the flusher thread.
+ *
+ *  The flusher writes back changed nodes in the background: all of them, when the percentage of changed nodes of the
+ *  storage area rises above the ratio threshold; those changed for longer than the age threshold, otherwise. The
+ *  thresholds are applied every time the storage area is subsequently assigned to the storage device, until they are
+ *  set again. If both are zero (the default), there is no flusher.
+ *
+ *  \param ratio percentage of changed nodes (zero, if there is no such threshold)
+ *  \param age age of a change, in milliseconds (zero, if there is no such threshold)
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the percentage is greater than 100
+ *  \return -\c EBUSY, if the storage area is already in use
+ */
+
+extern int soSetBufferCacheFlusher (uint32_t ratio, uint32_t age);
+
+/**
+ *  \brief Set the size of the storage area.
+ *
+ *  The size is applied every time the storage area is subsequently assigned to the storage device, until it is set
+ *  again: all the nodes and their contents are allocated then, evenly split by the shards and, in each shard, with as
+ *  many block nodes as cluster nodes. If it is zero (the default), the storage area has NBUFFERS block nodes and
+ *  NCLUSTERS cluster nodes.
+ *
+ *  \param size size of the storage area, in MiB (zero, if it is not set)
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the size is greater than \c CACHE_MAX_SIZE
+ *  \return -\c EBUSY, if the storage area is already in use
+ */
+
+extern int soSetBufferCacheSize (uint32_t size);
+
+/**
+ *  \brief Resize the storage area in use.
+ *
+ *  It is meant to let go of main memory, when it becomes scarce, and to take it back afterwards. The nodes of the
+ *  storage area beyond the new size are taken out of service: their contents is written back to the storage device,
+ *  if it was changed, and returned to the system. The storage area can not grow beyond the size it was assigned to the
+ *  storage device with, nor shrink below a few nodes per shard; a size of zero brings all its nodes back into service.
+ *  In unbuffered mode, nothing is done.
+ *
+ *  \param size new size of the storage area, in MiB
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the size is greater than \c CACHE_MAX_SIZE
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EBUSY, if pinned nodes are kept in service, so that the storage area is larger than requested
+ *  \return -\c EIO, if it fails on writing
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+extern int soResizeBufferCache (uint32_t size);
+
+/**
+ *  \brief Get the statistics of the writing back of changed nodes.
+ *
+ *  They are kept since the storage area was last assigned to the storage device.
+ *
+ *  \param p_stats pointer to a location where the statistics are to be stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the <em>pointer</em> is \c NULL
+ */
+
+extern int soGetBufferCacheFlushStats (SOBufferCacheFlushStats *p_stats);
+
+/**
+ *  \brief Set the regions of the storage device which the statistics of accesses are split by.
+ *
+ *  The superblock is stored below the first block of the table of inodes, which is stored below the first block of the
+ *  data zone. Until they are set, the superblock is block 0 and the region of the other blocks is told by the way they
+ *  are accessed: blocks accessed on their own belong to the table of inodes and clusters to the data zone. The regions
+ *  are kept until they are set again.
+ *
+ *  \param itStart physical number of the first block of the table of inodes
+ *  \param dzStart physical number of the first block of the data zone
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the table of inodes starts at block 0 or after the data zone
+ */
+
+extern int soSetBufferCacheRegions (uint32_t itStart, uint32_t dzStart);
+
+/**
+ *  \brief Set the function which releases the blocks (clusters) the upper layer keeps pinned while they are not in use.
+ *
+ *  When a block (cluster) can not be read, written or pinned because all the nodes which may hold it are pinned (all
+ *  the entries of the table of pinned blocks (clusters), in unbuffered mode), the function is called, outside any
+ *  critical region, and the operation is tried once more if it reports that any block (cluster) was unpinned. It is
+ *  kept until it is set again.
+ *
+ *  \param release pointer to the function, which returns the number of blocks (clusters) unpinned (\c NULL, if none)
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ */
+
+extern int soSetBufferCacheReclaim (int (*release) (void));
+
+/**
+ *  \brief Get the statistics of accesses to the storage area, by region of the storage device.
+ *
+ *  They are kept since the storage area was last assigned to the storage device, and survive its unassignment. In
+ *  unbuffered mode, there is no storage area and nothing is counted.
+ *
+ *  \param p_stats pointer to a location where the statistics are to be stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the <em>pointer</em> is \c NULL
+ */
+
+extern int soGetBufferCacheStats (SOBufferCacheStats *p_stats);
+
+/**
+ *  \brief Print the statistics of accesses to the storage area, by region of the storage device.
+ *
+ *  For each region with some activity, the counters and the percentage of hits are printed.
+ *
+ *  \param fp stream where the statistics are to be printed
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the <em>stream</em> is \c NULL
+ */
+
+extern int soPrintBufferCacheStats (FILE *fp);
+
 /**
  *  \brief Initialize the storage area and assign it to the storage device.
  *
@@ -62,6 +330,10 @@
  *  storage device may be minimized.
  *  This communication may be unbuffered or buffered: it will be unbuffered, if the second argument is \c UNBUF , and
  *  buffered, in any other case.
+ *  The storage device is opened in the operating mode previously set by \e soSetBufferCacheMode (\c DEV_SYNC, by
+ *  default) and the storage area is managed by the replacement policy previously set by \e soSetBufferCachePolicy
+ *  (\c CACHE_LRU, by default). Its size is the one previously set by \e soSetBufferCacheSize. If thresholds were
+ *  previously set by \e soSetBufferCacheFlusher, the flusher thread is started.
  *
  *  \param devname absolute path to the Linux file that simulates the storage device
  *  \param type type of the communication channel that is opened
@@ -70,7 +342,9 @@
  *  \return -\c EINVAL, if the argument is \c NULL
  *  \return -\c EBUSY, if the storage area is already in use or the device is already opened
  *  \return -\c ELIBBAD, if the supporting file size is invalid
- *  \return -<em>other specific error</em> issued by \e lseek system call
+ *  \return -\c ENOMEM, if the storage area or its index can not be allocated
+ *  \return -\c EAGAIN, if the flusher thread can not be created
+ *  \return -<em>other specific error</em> issued by \e open system call
  */
 
 extern int soOpenBufferCache (const char *devname, uint32_t type);
@@ -79,14 +353,13 @@ extern int soOpenBufferCache (const char *devname, uint32_t type);
  *  \brief Unassign the storage area from the storage device and perform the required housekeeping duties.
  *
  *  The buffered/unbuffered communication channel previously established with the storage device is closed.
- *  This means, namely, that the contents of the storage area is flushed into the storage device to keep data
- *  consistent.
+ *  This means, namely, that the flusher thread, if running, is terminated and the contents of the storage area is
+ *  flushed into the storage device to keep data consistent.
  *
  *  \return <tt>0 (zero)</tt>, on success
  *  \return -\c EBADF, if the device is not already opened
  *  \return -\c EIO, if it fails on writing
  *  \return -\c ELIBBAD, if the internal data is inconsistent
- *  \return -<em>other specific error</em> issued by \e lseek system call
  */
 
 extern int soCloseBufferCache (void);
@@ -104,8 +377,8 @@ extern int soCloseBufferCache (void);
  *  \return -\c EINVAL, if the <em>buffer pointer</em> is \c NULL or the <em>block number</em> is out of range
  *  \return -\c EBADF, if the device is not already opened
  *  \return -\c EIO, if it fails on reading or writing
+ *  \return -\c ENOBUFS, if all the nodes which may hold the block are pinned
  *  \return -\c ELIBBAD, if the buffercache is inconsistent
- *  \return -<em>other specific error</em> issued by \e lseek system call
  */
 
 extern int soReadCacheBlock (uint32_t n, void *buf);
@@ -123,8 +396,8 @@ extern int soReadCacheBlock (uint32_t n, void *buf);
  *  \return -\c EINVAL, if <em>buffer pointer</em> is \c NULL or <em>block number</em> is out of range
  *  \return -\c EBADF, if the device is not already opened
  *  \return -\c EIO, if it fails on writing
+ *  \return -\c ENOBUFS, if all the nodes which may hold the block are pinned
  *  \return -\c ELIBBAD, if the buffercache is inconsistent
- *  \return -<em>other specific error</em> issued by \e lseek system call
  */
 
 extern int soWriteCacheBlock (uint32_t n, void *buf);
@@ -143,7 +416,6 @@ extern int soWriteCacheBlock (uint32_t n, void *buf);
  *  \return -\c EBADF, if the device is not already opened
  *  \return -\c EIO, if it fails on writing
  *  \return -\c ELIBBAD, if the buffercache is inconsistent
- *  \return -<em>other specific error</em> issued by \e lseek system call
  */
 
 extern int soFlushCacheBlock (uint32_t n, void *buf);
@@ -160,7 +432,6 @@ extern int soFlushCacheBlock (uint32_t n, void *buf);
  *  \return -\c EBADF, if the device is not already opened
  *  \return -\c EIO, if it fails on writing
  *  \return -\c ELIBBAD, if the buffercache is inconsistent
- *  \return -<em>other specific error</em> issued by \e lseek system call
  */
 
 extern int soSyncCacheBlock (uint32_t n);
@@ -179,8 +450,9 @@ extern int soSyncCacheBlock (uint32_t n);
  *  \return -\c EINVAL, if the <em>buffer pointer</em> is \c NULL or the <em>block number</em> is out of range
  *  \return -\c EBADF, if the device is not already opened
  *  \return -\c EIO, if it fails on reading or writing
+ *  \return -\c EBUSY, if any of its blocks, or an overlapping cluster, is pinned on its own
+ *  \return -\c ENOBUFS, if all the nodes which may hold the cluster are pinned
  *  \return -\c ELIBBAD, if the buffercache is inconsistent
- *  \return -<em>other specific error</em> issued by \e lseek system call
  */
 
 extern int soReadCacheCluster (uint32_t n, void *buf);
@@ -199,8 +471,9 @@ extern int soReadCacheCluster (uint32_t n, void *buf);
  *  \return -\c EINVAL, if <em>buffer pointer</em> is \c NULL or <em>block number</em> is out of range
  *  \return -\c EBADF, if the device is not already opened
  *  \return -\c EIO, if it fails on writing
+ *  \return -\c EBUSY, if any of its blocks, or an overlapping cluster, is pinned on its own
+ *  \return -\c ENOBUFS, if all the nodes which may hold the cluster are pinned
  *  \return -\c ELIBBAD, if the buffercache is inconsistent
- *  \return -<em>other specific error</em> issued by \e lseek system call
  */
 
 extern int soWriteCacheCluster (uint32_t n, void *buf);
@@ -220,7 +493,6 @@ extern int soWriteCacheCluster (uint32_t n, void *buf);
  *  \return -\c EBADF, if the device is not already opened
  *  \return -\c EIO, if it fails on writing
  *  \return -\c ELIBBAD, if the buffercache is inconsistent
- *  \return -<em>other specific error</em> issued by \e lseek system call
  */
 
 extern int soFlushCacheCluster (uint32_t n, void *buf);
@@ -238,9 +510,123 @@ extern int soFlushCacheCluster (uint32_t n, void *buf);
  *  \return -\c EBADF, if the device is not already opened
  *  \return -\c EIO, if it fails on writing
  *  \return -\c ELIBBAD, if the buffercache is inconsistent
- *  \return -<em>other specific error</em> issued by \e lseek system call
  */
 
 extern int soSyncCacheCluster (uint32_t n);
 
+/**
+ *  \brief Synchronize the whole storage area with the storage device.
+ *
+ *  The contents of all the nodes of the storage area whose status is marked \e changed is transferred to the storage
+ *  device and their status is marked \e same. Afterwards, the storage device is itself synchronized, so that, in
+ *  \c DEV_DATASYNC mode, the data reaches stable storage.
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on writing or synchronizing
+ *  \return -\c ELIBBAD, if the buffercache is inconsistent
+ */
+
+extern int soSyncBufferCache (void);
+
+/**
+ *  \brief Pin a block of data in the buffercache.
+ *
+ *  The block is looked up in the storage area and, if missing, read from the storage device, as in
+ *  soReadCacheBlock. A pointer to its contents in the storage area is stored instead of a copy. The node holding the
+ *  block is not replaced until the block is unpinned as many times as it was pinned.
+ *
+ *  \param n physical number of the data block to be pinned
+ *  \param p_data pointer to the location where the pointer to the block contents is to be stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the <em>pointer</em> is \c NULL or the <em>block number</em> is out of range
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on reading or writing
+ *  \return -\c ENOBUFS, if all the nodes which may hold the block are pinned
+ *  \return -\c ELIBBAD, if the buffercache is inconsistent
+ */
+
+extern int soPinCacheBlock (uint32_t n, void **p_data);
+
+/**
+ *  \brief Mark a pinned block of data as changed.
+ *
+ *  It must be called after the block contents is changed through the pointer got when it was pinned, and before it is
+ *  unpinned.
+ *
+ *  \param n physical number of the pinned data block
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the <em>block number</em> is out of range or the block is not pinned
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on writing (unbuffered mode)
+ */
+
+extern int soMarkCacheBlockChanged (uint32_t n);
+
+/**
+ *  \brief Unpin a block of data.
+ *
+ *  The pointer got when it was pinned must no longer be used.
+ *
+ *  \param n physical number of the pinned data block
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the <em>block number</em> is out of range or the block is not pinned
+ */
+
+extern int soUnpinCacheBlock (uint32_t n);
+
+/**
+ *  \brief Pin a cluster of data in the buffercache.
+ *
+ *  The cluster is looked up in the storage area and, if missing, read from the storage device, as in
+ *  soReadCacheCluster (but no readahead takes place). A pointer to its contents in the storage area is stored instead
+ *  of a copy. The node holding the cluster is not replaced until the cluster is unpinned as many times as it was
+ *  pinned.
+ *
+ *  \param n physical number of the first block of the data cluster to be pinned
+ *  \param p_data pointer to the location where the pointer to the cluster contents is to be stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the <em>pointer</em> is \c NULL or the <em>block number</em> is out of range
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on reading or writing
+ *  \return -\c EBUSY, if any of its blocks, or an overlapping cluster, is pinned on its own
+ *  \return -\c ENOBUFS, if all the nodes which may hold the cluster are pinned
+ *  \return -\c ELIBBAD, if the buffercache is inconsistent
+ */
+
+extern int soPinCacheCluster (uint32_t n, void **p_data);
+
+/**
+ *  \brief Mark a pinned cluster of data as changed.
+ *
+ *  It must be called after the cluster contents is changed through the pointer got when it was pinned, and before it
+ *  is unpinned.
+ *
+ *  \param n physical number of the first block of the pinned data cluster
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the <em>block number</em> is out of range or the cluster is not pinned
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on writing (unbuffered mode)
+ */
+
+extern int soMarkCacheClusterChanged (uint32_t n);
+
+/**
+ *  \brief Unpin a cluster of data.
+ *
+ *  The pointer got when it was pinned must no longer be used.
+ *
+ *  \param n physical number of the first block of the pinned data cluster
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the <em>block number</em> is out of range or the cluster is not pinned
+ */
+
+extern int soUnpinCacheCluster (uint32_t n);
+
 #endif /* SOFS_BUFFERCACHE_H_ */
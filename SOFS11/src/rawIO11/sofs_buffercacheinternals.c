@@ -0,0 +1,468 @@
+/**
+ *  \file sofs_buffercacheinternals.c (implementation file)
+ *
+ *  \brief Set of operations to internally manage the buffercache.
+ *
+ *  The buffercache is conceived as two double-linked lists: the first, holding all the nodes of the storage area, is
+ *  indexed by the physical block number of the storage device they are referencing; the second, based on the order of
+ *  last access to the block. Hence, one needs to define operations to insert, retrieve and access its nodes.
+ *  A storage area may be split in several pools of nodes (of blocks and of clusters), each one with its own pair of
+ *  lists, which share the same index: an entry is identified by the physical number of the (first) block and by the
+ *  number of blocks of the node. A storage area split in shards has an index per shard: every operation is carried out
+ *  on the index which is supplied, so that shards accessed in parallel do not interfere.
+ *  One should notice that this module does not stand alone: it supposes a very tight coupling with the buffercache
+ *  implementation, its only application.
+ *
+ *  The index is an open-addressing hash table with linear probing, kept at most half full, so that looking up a block
+ *  and inserting or retrieving a node take constant time whatever the size of the storage area. Removed entries are
+ *  filled by shifting back the following ones in their probe sequence, so no tombstones are left behind.
+ *  The double-linked list based on the physical block number is, therefore, no longer sorted: new nodes are placed at
+ *  its head.
+ *  The index may also keep ghost entries: blocks (clusters) which are no longer stored, but whose recent replacement
+ *  the replacement policy wants to remember. A ghost entry has no node and is never returned by a look up.
+ *
+ *  The following operations are defined:
+ *    \li set up the index for a storage area of a given number of nodes
+ *    \li release the index
+ *    \li access the first node of the double-linked list based on the physical block number of the storage device
+ *    \li access the next node of the double-linked list based on the physical block number of the storage device
+ *    \li check if a given block, whose physical number is given, has already been stored in the storage area
+ *    \li check if a given cluster, whose physical number is given, has already been stored in the storage area
+ *    \li insert a node in the two double-linked lists infrastructure
+ *    \li retrieve a node from the two double-linked lists infrastructure
+ *    \li extract a given node from the two double-linked lists infrastructure
+ *    \li move a node already present in the storage area to the head of the double-linked list based on the last access
+ *        time
+ *    \li enter a ghost entry for a block (cluster) in the index
+ *    \li remove the ghost entry of a block (cluster) from the index.
+ *
+ *  \author António Rui Borges - July 2010 / August 2011
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+
+#include "sofs_buffercachenode.h"
+#include "sofs_buffercacheinternals.h"
+
+/** \brief multiplier of the hash function (2^32 divided by the golden ratio) */
+#define HASH_MULT  (2654435769U)
+
+/*
+ *  Internal data structure
+ */
+
+/** \brief Definition of an entry of the index */
+struct soNodeSlot
+{
+   /** \brief physical block number (copied, so that probing does not touch the nodes) */
+    uint32_t n;
+   /** \brief number of blocks of the node (copied, likewise) */
+    uint32_t size;
+   /** \brief node where the block contents is stored (\c NULL, if the entry is empty) */
+    SOBufferCacheNode *node;
+};
+
+/** \brief Node which the ghost entries of the index point to (it never belongs to the storage area) */
+static SOBufferCacheNode ghost;
+
+/*
+ *  Allusion to internal functions
+ */
+
+static uint32_t home (SONodeIndex *idx, uint32_t n);
+static struct soNodeSlot *lookUp (SONodeIndex *idx, uint32_t n, uint32_t size);
+static void removeSlot (SONodeIndex *idx, struct soNodeSlot *p);
+static void unlinkLAT (SOBufferCacheNode *node, SOBufferCacheNode **p_lATLHead, SOBufferCacheNode **p_lATLTail);
+
+/**
+ *  \brief Set up the index for a storage area of a given number of nodes.
+ *
+ *  The index is allocated with, at least, twice as many entries as the number of nodes and is left empty. Any index
+ *  previously set up is released.
+ *
+ *  \param idx pointer to the index
+ *  \param nNodes number of nodes of the storage area (added to the number of ghost entries it may keep)
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the number of nodes is zero or too large
+ *  \return -\c ENOMEM, if the index can not be allocated
+ */
+
+int setUpNodeIndex (SONodeIndex *idx, uint32_t nNodes)
+{
+  uint32_t bits;                                 /* number of bits of the home entry */
+
+  if ((nNodes == 0) || (nNodes > (UINT32_C (1) << 30))) return -EINVAL;
+
+  for (bits = 1; (UINT32_C (1) << bits) < 2 * nNodes; bits++) ;
+  freeNodeIndex (idx);
+  if ((idx->slot = calloc ((size_t) 1 << bits, sizeof (struct soNodeSlot))) == NULL)
+     return -ENOMEM;
+  idx->bits = bits;
+  idx->mask = (UINT32_C (1) << bits) - 1;
+
+  return 0;
+}
+
+/**
+ *  \brief Release the index.
+ *
+ *  It must be set up again before any node is inserted in the storage area.
+ *
+ *  \param idx pointer to the index
+ */
+
+void freeNodeIndex (SONodeIndex *idx)
+{
+  free (idx->slot);
+  idx->slot = NULL;
+  idx->mask = idx->bits = idx->nEntries = 0;
+  idx->iter = NULL;
+}
+
+/**
+ *  \brief Access the first node of the double-linked list based on the physical block number of the storage device.
+ *
+ *  The iterator of the index is set to the value of the argument and a pointer to the node pointed to by the
+ *  iterator variable is returned.
+ *
+ *  \param idx pointer to the index
+ *  \param head pointer to the head of the linked list based on the physical block number of the storage device
+ *
+ *  \return value of the <em>iterator</em> variable
+ */
+
+SOBufferCacheNode *getFirstNodeOnN (SONodeIndex *idx, SOBufferCacheNode *head)
+{
+  idx->iter = head;
+
+  return idx->iter;
+}
+
+/**
+ *  \brief Access the next node of the double-linked list based on the physical block number of the storage device.
+ *
+ *  The iterator of the index is iterated if it does not already point to the last node of the linked list, and
+ *  a pointer to the node pointed to by the iterator variable is returned.
+ *
+ *  \param idx pointer to the index
+ *
+ *  \return value of the <em>iterator</em> variable
+ */
+
+SOBufferCacheNode *getNextNodeOnN (SONodeIndex *idx)
+{
+  if ((idx->iter != NULL) && (idx->iter->n_next != NULL))
+     idx->iter = idx->iter->n_next;
+
+  return idx->iter;
+}
+
+/**
+ *  \brief Check if a given block, whose physical number is given, has already been stored in the storage area.
+ *
+ *  The block is looked up in the index. The head of the linked list based on the block number of the storage device
+ *  only tells whether the storage area is empty.
+ *
+ *  \param idx pointer to the index
+ *  \param nBlock physical block number
+ *  \param head pointer to the head of the linked list based on the block number of the storage device
+ *
+ *  \return pointer to the node where the block contents is stored, or \c NULL if the block has not been stored yet
+ */
+
+SOBufferCacheNode *searchNodeOnN (SONodeIndex *idx, uint32_t nBlock, SOBufferCacheNode *head)
+{
+  struct soNodeSlot *p;                          /* entry of the index */
+
+  if ((head == NULL) || (idx->slot == NULL)) return NULL;
+
+  p = lookUp (idx, nBlock, 1);
+
+  return (p->node == &ghost) ? NULL : p->node;
+}
+
+/**
+ *  \brief Check if a given cluster, whose physical number is given, has already been stored in the storage area.
+ *
+ *  The cluster is looked up in the index. The head of the linked list based on the block number of the storage device
+ *  only tells whether the pool of clusters of the storage area is empty.
+ *
+ *  \param idx pointer to the index
+ *  \param nBlock physical number of the first block of the cluster
+ *  \param head pointer to the head of the linked list based on the block number of the storage device
+ *
+ *  \return pointer to the node where the cluster contents is stored, or \c NULL if the cluster has not been stored yet
+ */
+
+SOBufferCacheNode *searchClusterNodeOnN (SONodeIndex *idx, uint32_t nBlock, SOBufferCacheNode *head)
+{
+  struct soNodeSlot *p;                          /* entry of the index */
+
+  if ((head == NULL) || (idx->slot == NULL)) return NULL;
+
+  p = lookUp (idx, nBlock, BLOCKS_PER_CLUSTER);
+
+  return (p->node == &ghost) ? NULL : p->node;
+}
+
+/**
+ *  \brief Insert a node in the two double-linked lists infrastructure.
+ *
+ *  A node whose contents belongs to a block of the storage device, which is supposed not to be stored in the storage
+ *  area yet, is inserted at the head of both lists and entered in the index, where it takes the place of the ghost
+ *  entry of the block, if there is one. If the node is already present, the block is already stored in another node
+ *  or the index is not set up (or is full), nothing is done.
+ *
+ *  \param idx pointer to the index
+ *  \param node pointer to the node to be inserted
+ *  \param p_nLHead pointer to a location where the pointer to the head of the double linked list based on the physical
+ *                  block number of the storage device, is stored
+ *  \param p_lATLHead pointer to a location where the pointer to the head of the double-linked list based on the last
+ *                    access time, is stored
+ *  \param p_lATLTail pointer to a location where the pointer to the tail of the double-linked list based on the last
+ *                    access time, is stored
+ */
+
+void insertNode (SONodeIndex *idx, SOBufferCacheNode *node, SOBufferCacheNode **p_nLHead,
+                 SOBufferCacheNode **p_lATLHead, SOBufferCacheNode **p_lATLTail)
+{
+  struct soNodeSlot *p;                          /* entry of the index */
+
+  if ((node == NULL) || (idx->slot == NULL)) return;
+
+  p = lookUp (idx, node->n, node->size);
+  if (p->node == NULL)
+     { if (2 * (idx->nEntries + 1) > idx->mask + 1) return;          /* more entries than the index was set up for */
+       p->n = node->n;
+       p->size = node->size;
+       idx->nEntries += 1;
+     }
+     else if (p->node != &ghost) return;         /* the block (cluster) is already stored */
+  p->node = node;
+
+  node->n_prev = NULL;
+  node->n_next = *p_nLHead;
+  if (*p_nLHead != NULL) (*p_nLHead)->n_prev = node;
+  *p_nLHead = node;
+
+  node->access_prev = NULL;
+  node->access_next = *p_lATLHead;
+  if (*p_lATLHead != NULL)
+     (*p_lATLHead)->access_prev = node;
+     else *p_lATLTail = node;
+  *p_lATLHead = node;
+}
+
+/**
+ *  \brief Retrieve a node from the two double-linked lists infrastructure.
+ *
+ *  The node which the tail of the double-linked list based on last access time points to, is retrieved from the two
+ *  double-linked lists infrastructure and removed from the index. If the storage area is inconsistent, nothing is
+ *  done.
+ *
+ *  \param idx pointer to the index
+ *  \param p_nLHead pointer to a location where the pointer to the head of the double linked list based on the physical
+ *                  block number of the storage device, is stored
+ *  \param p_lATLHead pointer to a location where the pointer to the head of the double-linked list based on the last
+ *                    access time, is stored
+ *  \param p_lATLTail pointer to a location where the pointer to the tail of the double-linked list based on the last
+ *                    access time, is stored
+ *
+ *  \return pointer to the retrieved node, or \c NULL if the storage area is empty or inconsistent
+ */
+
+SOBufferCacheNode *retrieveNode (SONodeIndex *idx, SOBufferCacheNode **p_nLHead, SOBufferCacheNode **p_lATLHead,
+                                 SOBufferCacheNode **p_lATLTail)
+{
+  SOBufferCacheNode *node = *p_lATLTail;         /* node to be retrieved */
+
+  if (extractNode (idx, node, p_nLHead, p_lATLHead, p_lATLTail) != 0) return NULL;
+
+  return node;
+}
+
+/**
+ *  \brief Extract a given node from the two double-linked lists infrastructure.
+ *
+ *  The node, wherever it stands in the double-linked list based on last access time, is retrieved from the two
+ *  double-linked lists infrastructure and removed from the index.
+ *
+ *  \param idx pointer to the index
+ *  \param node pointer to the node to be extracted
+ *  \param p_nLHead pointer to a location where the pointer to the head of the double linked list based on the physical
+ *                  block number of the storage device, is stored
+ *  \param p_lATLHead pointer to a location where the pointer to the head of the double-linked list based on the last
+ *                    access time, is stored
+ *  \param p_lATLTail pointer to a location where the pointer to the tail of the double-linked list based on the last
+ *                    access time, is stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the node pointer is \c NULL
+ *  \return -\c ELIBBAD, if the node is not stored in the storage area or the index is not set up
+ */
+
+int extractNode (SONodeIndex *idx, SOBufferCacheNode *node, SOBufferCacheNode **p_nLHead,
+                 SOBufferCacheNode **p_lATLHead, SOBufferCacheNode **p_lATLTail)
+{
+  struct soNodeSlot *p;                          /* entry of the index */
+
+  if (node == NULL) return -EINVAL;
+  if (idx->slot == NULL) return -ELIBBAD;
+  p = lookUp (idx, node->n, node->size);
+  if (p->node != node) return -ELIBBAD;          /* the index is inconsistent */
+  removeSlot (idx, p);
+
+  unlinkLAT (node, p_lATLHead, p_lATLTail);
+  if (node->n_prev != NULL)
+     node->n_prev->n_next = node->n_next;
+     else *p_nLHead = node->n_next;
+  if (node->n_next != NULL)
+     node->n_next->n_prev = node->n_prev;
+  if (idx->iter == node) idx->iter = NULL;
+  node->n_prev = node->n_next = NULL;
+
+  return 0;
+}
+
+/**
+ *  \brief Move the node to the head of the double-linked list based on last access time.
+ *
+ *  The node which is supposed to have been accessed, is retrieved from its location in the double-linked list based on
+ *  the last access time and placed at the head of the list. If the node pointer is \c NULL or the storage area is
+ *  inconsistent, nothing is done.
+ *
+ *  \param node pointer to the node to be inserted
+ *  \param p_lATLHead pointer to a location where the pointer to the head of the double-linked list based on the last
+ *                    access time, is stored
+ *  \param p_lATLTail pointer to a location where the pointer to the tail of the double-linked list based on the last
+ *                    access time, is stored
+ */
+
+void moveNodeAtHeadLAT (SOBufferCacheNode *node, SOBufferCacheNode **p_lATLHead, SOBufferCacheNode **p_lATLTail)
+{
+  if ((node == NULL) || (*p_lATLHead == NULL)) return;
+  if (node == *p_lATLHead) return;               /* nothing to be done */
+
+  unlinkLAT (node, p_lATLHead, p_lATLTail);
+  node->access_prev = NULL;
+  node->access_next = *p_lATLHead;
+  if (*p_lATLHead != NULL)
+     (*p_lATLHead)->access_prev = node;
+     else *p_lATLTail = node;
+  *p_lATLHead = node;
+}
+
+/**
+ *  \brief Enter a ghost entry for a block (cluster) in the index.
+ *
+ *  The block (cluster), which is supposed to have just been replaced, is remembered by the index without being stored
+ *  in the storage area. If the block is stored or has already a ghost entry, or the index is not set up (or is full),
+ *  nothing is done.
+ *
+ *  \param idx pointer to the index
+ *  \param nBlock physical number of the (first) block
+ *  \param size number of blocks: 1, for a block, or \c BLOCKS_PER_CLUSTER, for a cluster
+ */
+
+void enterGhost (SONodeIndex *idx, uint32_t nBlock, uint32_t size)
+{
+  struct soNodeSlot *p;                          /* entry of the index */
+
+  if (idx->slot == NULL) return;
+  if (2 * (idx->nEntries + 1) > idx->mask + 1) return;     /* more entries than the index was set up for */
+
+  p = lookUp (idx, nBlock, size);
+  if (p->node != NULL) return;                   /* the block (cluster) is already known */
+  p->n = nBlock;
+  p->size = size;
+  p->node = &ghost;
+  idx->nEntries += 1;
+}
+
+/**
+ *  \brief Remove the ghost entry of a block (cluster) from the index.
+ *
+ *  \param idx pointer to the index
+ *  \param nBlock physical number of the (first) block
+ *  \param size number of blocks: 1, for a block, or \c BLOCKS_PER_CLUSTER, for a cluster
+ *
+ *  \return \c true, if the block (cluster) had a ghost entry, which was removed
+ *  \return \c false, otherwise
+ */
+
+bool leaveGhost (SONodeIndex *idx, uint32_t nBlock, uint32_t size)
+{
+  struct soNodeSlot *p;                          /* entry of the index */
+
+  if (idx->slot == NULL) return false;
+
+  p = lookUp (idx, nBlock, size);
+  if (p->node != &ghost) return false;
+  removeSlot (idx, p);
+
+  return true;
+}
+
+/*
+ *  Home entry of a block in the index (Fibonacci hashing: consecutive blocks are spread apart).
+ */
+
+static uint32_t home (SONodeIndex *idx, uint32_t n)
+{
+  return (uint32_t) (n * HASH_MULT) >> (32 - idx->bits);
+}
+
+/*
+ *  Look up a block (cluster) in the index.
+ *
+ *  The entry which holds the block (cluster) is returned or, if it is not there, the empty entry which ends its probe
+ *  sequence. As the index is kept at most half full, such an entry always exists.
+ */
+
+static struct soNodeSlot *lookUp (SONodeIndex *idx, uint32_t n, uint32_t size)
+{
+  uint32_t i;                                    /* entry being checked */
+
+  for (i = home (idx, n); idx->slot[i].node != NULL; i = (i + 1) & idx->mask)
+    if ((idx->slot[i].n == n) && (idx->slot[i].size == size)) break;
+
+  return &idx->slot[i];
+}
+
+/*
+ *  Remove an entry from the index, shifting back the following ones which would no longer be reached.
+ */
+
+static void removeSlot (SONodeIndex *idx, struct soNodeSlot *p)
+{
+  uint32_t i, j;                                 /* empty entry / entry being checked */
+
+  i = (uint32_t) (p - idx->slot);
+  for (j = (i + 1) & idx->mask; idx->slot[j].node != NULL; j = (j + 1) & idx->mask)
+    if (((j - home (idx, idx->slot[j].n)) & idx->mask) >= ((j - i) & idx->mask))
+       { idx->slot[i] = idx->slot[j];
+         i = j;
+       }
+  idx->slot[i].node = NULL;
+  idx->nEntries -= 1;
+}
+
+/*
+ *  Unlink a node from the double-linked list based on the last access time.
+ */
+
+static void unlinkLAT (SOBufferCacheNode *node, SOBufferCacheNode **p_lATLHead, SOBufferCacheNode **p_lATLTail)
+{
+  if (node->access_prev != NULL)
+     node->access_prev->access_next = node->access_next;
+     else *p_lATLHead = node->access_next;
+  if (node->access_next != NULL)
+     node->access_next->access_prev = node->access_prev;
+     else *p_lATLTail = node->access_prev;
+  node->access_prev = node->access_next = NULL;
+}
@@ -3,20 +3,31 @@
  *
  *  \brief Set of operations to internally manage the buffercache.
  *
- *  The buffercache is conceived as two double-linked lists: the first, based on the physical block number of the
- *  storage device it is referencing; the second, based on the order of last access to the block. Hence, one needs to
- *  define operations to insert, retrieve and access its nodes.
+ *  The buffercache is conceived as two double-linked lists: the first, holding all the nodes of the storage area, is
+ *  indexed by the physical block number of the storage device they are referencing; the second, based on the order of
+ *  last access to the block. Hence, one needs to define operations to insert, retrieve and access its nodes.
+ *  The index is a hash table, so a block is looked up in constant time whatever the size of the storage area.
+ *  A storage area may be split in several pools of nodes (of blocks and of clusters), each one with its own pair of
+ *  lists, which share the same index. The index may also remember blocks (clusters) which have recently been
+ *  replaced, by keeping ghost entries for them. A storage area split in shards has an index per shard, which is
+ *  supplied to every operation.
  *  One should notice that this module does not stand alone: it supposes a very tight coupling with the buffercache
  *  implementation, its only application.
  *
  *  The following operations are defined:
+ *    \li set up the index for a storage area of a given number of nodes
+ *    \li release the index
  *    \li access the first node of the double-linked list based on the physical block number of the storage device
  *    \li access the next node of the double-linked list based on the physical block number of the storage device
  *    \li check if a given block, whose physical number is given, has already been stored in the storage area
+ *    \li check if a given cluster, whose physical number is given, has already been stored in the storage area
  *    \li insert a node in the two double-linked lists infrastructure
  *    \li retrieve a node from the two double-linked lists infrastructure
+ *    \li extract a given node from the two double-linked lists infrastructure
  *    \li move a node already present in the storage area to the head of the double-linked list based on the last access
- *        time.
+ *        time
+ *    \li enter a ghost entry for a block (cluster) in the index
+ *    \li remove the ghost entry of a block (cluster) from the index.
  *
  *  \author António Rui Borges - July 2010 / August 2011
  */
@@ -25,55 +36,117 @@
 #define SOFS_BUFFERCACHEINTERNALS_H_
 
 #include <stdint.h>
+#include <stdbool.h>
 
 #include "sofs_buffercachenode.h"
 
+/** \brief Definition of the index of a storage area (or of a shard of it) */
+typedef struct soNodeIndex
+{
+   /** \brief entries of the index (an open-addressing hash table) */
+    struct soNodeSlot *slot;
+   /** \brief number of entries minus one (the number of entries is a power of two) */
+    uint32_t mask;
+   /** \brief number of bits of the home entry of a block */
+    uint32_t bits;
+   /** \brief number of entries in use */
+    uint32_t nEntries;
+   /** \brief iterator over the double-linked list based on the physical block number */
+    SOBufferCacheNode *iter;
+} SONodeIndex;
+
+/**
+ *  \brief Set up the index for a storage area of a given number of nodes.
+ *
+ *  The index is allocated with, at least, twice as many entries as the number of nodes and is left empty. Any index
+ *  previously set up is released.
+ *
+ *  \param idx pointer to the index
+ *  \param nNodes number of nodes of the storage area (added to the number of ghost entries it may keep)
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the number of nodes is zero or too large
+ *  \return -\c ENOMEM, if the index can not be allocated
+ */
+
+extern int setUpNodeIndex (SONodeIndex *idx, uint32_t nNodes);
+
+/**
+ *  \brief Release the index.
+ *
+ *  It must be set up again before any node is inserted in the storage area.
+ *
+ *  \param idx pointer to the index
+ */
+
+extern void freeNodeIndex (SONodeIndex *idx);
+
 /**
  *  \brief Access the first node of the double-linked list based on the physical block number of the storage device.
  *
- *  An iterator internal variable is set to the value of the argument and a pointer to the node pointed to by the
+ *  The iterator of the index is set to the value of the argument and a pointer to the node pointed to by the
  *  iterator variable is returned.
  *
+ *  \param idx pointer to the index
  *  \param head pointer to the head of the linked list based on the physical block number of the storage device
  *
  *  \return value of the <em>iterator</em> variable
  */
 
-extern SOBufferCacheNode *getFirstNodeOnN (SOBufferCacheNode *head);
+extern SOBufferCacheNode *getFirstNodeOnN (SONodeIndex *idx, SOBufferCacheNode *head);
 
 /**
  *  \brief Access the next node of the double-linked list based on the physical block number of the storage device.
  *
- *  The iterator internal variable is iterated if it does not already point to the last node of the linked list, and
+ *  The iterator of the index is iterated if it does not already point to the last node of the linked list, and
  *  a pointer to the node pointed to by the iterator variable is returned.
  *
+ *  \param idx pointer to the index
+ *
  *  \return value of the <em>iterator</em> variable
  */
 
-extern SOBufferCacheNode *getNextNodeOnN (void);
+extern SOBufferCacheNode *getNextNodeOnN (SONodeIndex *idx);
 
 /**
  *  \brief Check if a given block, whose physical number is given, has already been stored in the storage area.
  *
- *  The double-linked list based on the physical block number of the storage device is traversed from the node pointed
- *  to by the second argument to find out if there is a node whose contents belongs to the block whose physical number
- *  is passed as the first argument.
+ *  The block is looked up in the index. The head of the linked list based on the block number of the storage device
+ *  only tells whether the storage area is empty.
  *
+ *  \param idx pointer to the index
  *  \param nBlock physical block number
  *  \param head pointer to the head of the linked list based on the block number of the storage device
  *
  *  \return pointer to the node where the block contents is stored, or \c NULL if the block has not been stored yet
  */
 
-extern SOBufferCacheNode *searchNodeOnN (uint32_t nBlock, SOBufferCacheNode *head);
+extern SOBufferCacheNode *searchNodeOnN (SONodeIndex *idx, uint32_t nBlock, SOBufferCacheNode *head);
+
+/**
+ *  \brief Check if a given cluster, whose physical number is given, has already been stored in the storage area.
+ *
+ *  The cluster is looked up in the index. The head of the linked list based on the block number of the storage device
+ *  only tells whether the pool of clusters of the storage area is empty.
+ *
+ *  \param idx pointer to the index
+ *  \param nBlock physical number of the first block of the cluster
+ *  \param head pointer to the head of the linked list based on the block number of the storage device
+ *
+ *  \return pointer to the node where the cluster contents is stored, or \c NULL if the cluster has not been stored yet
+ */
+
+extern SOBufferCacheNode *searchClusterNodeOnN (SONodeIndex *idx, uint32_t nBlock, SOBufferCacheNode *head);
 
 /**
  *  \brief Insert a node in the two double-linked lists infrastructure.
  *
  *  A node whose contents belongs to a block of the storage device, which is supposed not to be stored in the storage
- *  area yet, is inserted in the two double-linked lists infrastructure. If the node is already present or the storage
- *  area is inconsistent, nothing is done.
+ *  area yet, is inserted at the head of both lists and entered in the index, where it takes the place of the ghost
+ *  entry of the block, if there is one. If the node is already present, the block is already stored in another node
+ *  or the index is not set up (or is full), nothing is done.
  *
+ *  \param idx pointer to the index
  *  \param node pointer to the node to be inserted
  *  \param p_nLHead pointer to a location where the pointer to the head of the double linked list based on the physical
  *                  block number of the storage device, is stored
@@ -83,15 +156,17 @@ extern SOBufferCacheNode *searchNodeOnN (uint32_t nBlock, SOBufferCacheNode *hea
  *                    access time, is stored
  */
 
-extern void insertNode (SOBufferCacheNode *node, SOBufferCacheNode **p_nLHead, SOBufferCacheNode **p_lATLHead,
-                        SOBufferCacheNode **p_lATLTail);
+extern void insertNode (SONodeIndex *idx, SOBufferCacheNode *node, SOBufferCacheNode **p_nLHead,
+                        SOBufferCacheNode **p_lATLHead, SOBufferCacheNode **p_lATLTail);
 
 /**
  *  \brief Retrieve a node from the two double-linked lists infrastructure.
  *
  *  The node which the tail of the double-linked list based on last access time points to, is retrieved from the two
- *  double-linked lists infrastructure. If the storage area is inconsistent, nothing is done.
+ *  double-linked lists infrastructure and removed from the index. If the storage area is inconsistent, nothing is
+ *  done.
  *
+ *  \param idx pointer to the index
  *  \param p_nLHead pointer to a location where the pointer to the head of the double linked list based on the physical
  *                  block number of the storage device, is stored
  *  \param p_lATLHead pointer to a location where the pointer to the head of the double-linked list based on the last
@@ -102,8 +177,31 @@ extern void insertNode (SOBufferCacheNode *node, SOBufferCacheNode **p_nLHead, S
  *  \return pointer to the retrieved node, or \c NULL if the storage area is empty or inconsistent
  */
 
-extern SOBufferCacheNode *retrieveNode (SOBufferCacheNode **p_nLHead, SOBufferCacheNode **p_lATLHead,
-                                        SOBufferCacheNode **p_lATLTail);
+extern SOBufferCacheNode *retrieveNode (SONodeIndex *idx, SOBufferCacheNode **p_nLHead,
+                                        SOBufferCacheNode **p_lATLHead, SOBufferCacheNode **p_lATLTail);
+
+/**
+ *  \brief Extract a given node from the two double-linked lists infrastructure.
+ *
+ *  The node, wherever it stands in the double-linked list based on last access time, is retrieved from the two
+ *  double-linked lists infrastructure and removed from the index.
+ *
+ *  \param idx pointer to the index
+ *  \param node pointer to the node to be extracted
+ *  \param p_nLHead pointer to a location where the pointer to the head of the double linked list based on the physical
+ *                  block number of the storage device, is stored
+ *  \param p_lATLHead pointer to a location where the pointer to the head of the double-linked list based on the last
+ *                    access time, is stored
+ *  \param p_lATLTail pointer to a location where the pointer to the tail of the double-linked list based on the last
+ *                    access time, is stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the node pointer is \c NULL
+ *  \return -\c ELIBBAD, if the node is not stored in the storage area or the index is not set up
+ */
+
+extern int extractNode (SONodeIndex *idx, SOBufferCacheNode *node, SOBufferCacheNode **p_nLHead,
+                        SOBufferCacheNode **p_lATLHead, SOBufferCacheNode **p_lATLTail);
 
 /**
  *  \brief Move the node to the head of the double-linked list based on last access time.
@@ -121,4 +219,31 @@ extern SOBufferCacheNode *retrieveNode (SOBufferCacheNode **p_nLHead, SOBufferCa
 
 extern void moveNodeAtHeadLAT (SOBufferCacheNode *node, SOBufferCacheNode **p_lATLHead, SOBufferCacheNode **p_lATLTail);
 
+/**
+ *  \brief Enter a ghost entry for a block (cluster) in the index.
+ *
+ *  The block (cluster), which is supposed to have just been replaced, is remembered by the index without being stored
+ *  in the storage area. If the block is stored or has already a ghost entry, or the index is not set up (or is full),
+ *  nothing is done.
+ *
+ *  \param idx pointer to the index
+ *  \param nBlock physical number of the (first) block
+ *  \param size number of blocks: 1, for a block, or \c BLOCKS_PER_CLUSTER, for a cluster
+ */
+
+extern void enterGhost (SONodeIndex *idx, uint32_t nBlock, uint32_t size);
+
+/**
+ *  \brief Remove the ghost entry of a block (cluster) from the index.
+ *
+ *  \param idx pointer to the index
+ *  \param nBlock physical number of the (first) block
+ *  \param size number of blocks: 1, for a block, or \c BLOCKS_PER_CLUSTER, for a cluster
+ *
+ *  \return \c true, if the block (cluster) had a ghost entry, which was removed
+ *  \return \c false, otherwise
+ */
+
+extern bool leaveGhost (SONodeIndex *idx, uint32_t nBlock, uint32_t size);
+
 #endif /* SOFS_BUFFERCACHEINTERNALS_H_ */
@@ -18,24 +18,38 @@
  *
  *  The buffercache is conceived as two double-linked lists: the first, based on the block number of the storage device
  *  it is referencing; the second, based on the order of last access to the block.
+ *  A node references either a single block or a whole cluster.
  *  So, besides the pointers which are required to implement this dynamic structure, each node contains:
- *    \li a buffer area to store locally the contents of the referenced block
- *    \li the physical block number
+ *    \li a buffer area to store locally the contents of the referenced block (cluster)
+ *    \li the physical block number and the number of blocks
  *    \li a status flag which signals whether the block contents is, or is not, synchronized with the contents of the
- *        corresponding block in the storage device.
+ *        corresponding block in the storage device
+ *    \li the queue of the replacement policy the node belongs to
+ *    \li the number of pins, which keep the node from being replaced while its contents is accessed in place
+ *    \li the instant when the contents was changed, so that a changed node is not kept for too long.
  */
 
 typedef struct soBufferCacheNode
 {
-   /** \brief contents of the data block */
-    unsigned char buffer[BLOCK_SIZE];
-   /** \brief physical block number */
+   /** \brief contents of the data block (cluster) */
+    unsigned char *buffer;
+   /** \brief physical block number (of the first block, for a cluster) */
     uint32_t n;
+   /** \brief number of blocks: 1, for a block, or \c BLOCKS_PER_CLUSTER, for a cluster */
+    uint32_t size;
    /** \brief status of the data block
     *  \li <em>same</em> - the contents is the same as the corresponding block in the storage device
     *  \li <em>changed</em> - the contents is potentially different
     */
     uint32_t stat;
+   /** \brief queue of the replacement policy: the list based on the last access time proper, or the first-in first-out
+    *         queue where the nodes accessed only once stay under the 2Q policy (see sofs_buffercache.h) */
+    uint32_t queue;
+   /** \brief number of times the block (cluster) is pinned: the node is not replaced while it is not zero */
+    uint32_t pins;
+   /** \brief instant of the first change of the contents since it was last written (in nanoseconds of the monotonic
+    *         clock), meaningful only if the status is <em>changed</em> */
+    uint64_t changed;
 
    /** \brief double-linked list based on block number:
     *         pointer to previous node */
@@ -52,10 +66,11 @@ typedef struct soBufferCacheNode
     struct soBufferCacheNode *access_next;
 } SOBufferCacheNode;
 
-/** \brief the contents of a block in the storage area is the same as the corresponding block in the storage device */
+/** \brief the contents of a block (cluster) in the storage area is the same as the corresponding one in the storage
+ *         device */
 #define SAME    0
-/** \brief the contents of a block in the storage area is potentially different from the corresponding block in the
- *         storage device */
+/** \brief the contents of a block (cluster) in the storage area is potentially different from the corresponding one in
+ *         the storage device */
 #define CHANGED 1
 
 #endif /* SOFS_BUFFERCACHENODE_H_ */
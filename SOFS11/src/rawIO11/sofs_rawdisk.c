@@ -7,10 +7,32 @@
  *  The following operations are defined:
  *    \li open a communication channel with the storage device
  *    \li close the communication channel previously established
+ *    \li force the data written so far to stable storage
  *    \li read a block of data from the storage device
  *    \li write a block of data to the storage device
  *    \li read a cluster of data from the storage device
- *    \li write a cluster of data to the storage device.
+ *    \li write a cluster of data to the storage device
+ *    \li read a run of contiguous clusters of data from the storage device
+ *    \li write a run of contiguous clusters of data to the storage device
+ *    \li read / write a run of contiguous blocks of data from / to the storage device
+ *    \li submit the reading / writing of a block or a cluster of data without waiting for it to be carried out
+ *    \li wait for all the submitted requests to be carried out
+ *    \li get direct access to a block or a cluster of data of a memory-mapped storage device
+ *    \li get, reset and print the transfer statistics of the storage device
+ *    \li set up the simulation of a slower storage device
+ *    \li parse the description of a simulated storage device
+ *    \li get the size of a storage device.
+ *
+ *  The storage device is either a single Linux file or a stripe set: a small text file which lists the Linux files of
+ *  its members, across which the device is striped (RAID-0). See \e soOpenDevice for the format.
+ *  Data transfers use positional system calls (\e pread / \e pwrite and their vectored counterparts), so the file
+ *  offset shared by the communication channel is never moved and each transfer takes a single system call.
+ *  Each transfer is timed with the monotonic clock and accounted for in the transfer statistics: a couple of clock
+ *  readings and a few additions, cheap enough to be always on.
+ *  A slower device may be simulated: the completion of each transfer is then delayed according to a simple model of
+ *  a single-head device (fixed latency, seek distance and transfer rate), which is kept in virtual time. Transfers
+ *  queue up behind each other on the simulated device, but the completion of submitted requests is only waited for
+ *  in \e soWaitRawIO, so that their simulated time overlaps with the caller's work just like on a real device.
  *
  *  \author Artur Carneiro Pereira - September 2007
  *  \author Miguel Oliveira e Silva - September 2009
@@ -18,23 +40,135 @@
  */
 
 #include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
 #include <unistd.h>
 #include <inttypes.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
 #include <errno.h>
+#include <time.h>
+#include <limits.h>
+#include <libgen.h>
+#include <pthread.h>
 #define __USE_GNU
 #include <fcntl.h>
 
 #include "sofs_const.h"
 #include "sofs_probe.h"
+#include "sofs_rawdisk.h"
+
+/** \brief Maximum number of clusters transferred by a single vectored system call (Linux UIO_MAXIOV) */
+#define MAX_IOV  (1024)
+/** \brief Alignment of main memory buffers required by direct transfers (O_DIRECT) */
+#define DIRECT_ALIGN  (4096)
+/** \brief Number of aligned buffers of the pool: transfers are carried out one at a time */
+#define POOL_SIZE  (1)
+/** \brief Distance between successive aligned buffers of the pool */
+#define POOL_STRIDE  (((CLUSTER_SIZE + DIRECT_ALIGN - 1) / DIRECT_ALIGN) * DIRECT_ALIGN)
+/** \brief Byte offset of a block in the supporting file (computed in 64-bit arithmetic, so that devices larger than
+ *         4 GB are reached) */
+#define OFFSET(n)  ((off_t) (n) * BLOCK_SIZE)
+/** \brief Maximum number of members of a stripe set */
+#define MAX_MEMBERS  (16)
+/** \brief Tag which starts the first line of the description of a stripe set */
+#define STRIPE_TAG  "SOFS11-STRIPE"
+/** \brief Checking if a main memory buffer may be used in a direct transfer */
+#define ALIGNED(buf)  (((uintptr_t) (buf) % DIRECT_ALIGN) == 0)
 
 /*
  *  Internal data structure
  */
-/** \brief File descriptor of the Linux file that simulates the magnetic disk */
+/** \brief File descriptor of the Linux file that simulates the magnetic disk (the first member of a stripe set) */
 static int fd = -1;
 /** \brief Number of blocks of the storage device */
 static uint32_t bnmax = 0;
+/** \brief Description of a member of the storage device */
+struct member
+{ int fd;                                        /* file descriptor of its Linux file */
+  unsigned char *map;                            /* mapping in main memory (memory-mapped backend) */
+  pthread_t worker;                              /* thread which carries out its part of striped transfers */
+  bool busy;                                     /* signaling if its part of a striped transfer is pending */
+  bool isWrite;                                  /* direction of the pending part */
+  off_t off;                                     /* byte offset of the pending part in its Linux file */
+  uint32_t nIov;                                 /* number of entries of the scatter / gather list */
+  struct iovec iov[MAX_IOV];                     /* scatter / gather list of the pending part */
+  ssize_t size, done;                            /* number of bytes to be transferred / effectively transferred */
+};
+/** \brief Members of the storage device (a single one, if it is not striped) */
+static struct member member[MAX_MEMBERS];
+/** \brief Number of members of the storage device */
+static uint32_t nMembers = 0;
+/** \brief Number of blocks of the storage device held by each member */
+static uint32_t memberBlocks = 0;
+/** \brief Stripe unit (in blocks), zero if the storage device is not striped */
+static uint32_t stripeBlocks = 0;
+/** \brief Number of worker threads which carry out the parts of striped transfers in parallel */
+static uint32_t nWorkers = 0;
+/** \brief Number of parts of the current striped transfer which are still pending */
+static uint32_t nPending = 0;
+/** \brief Signaling if the worker threads must terminate */
+static bool workersQuit = false;
+/** \brief Access lock to the parts of striped transfers */
+static pthread_mutex_t jobLock = PTHREAD_MUTEX_INITIALIZER;
+/** \brief Signaling that parts of a striped transfer were handed out */
+static pthread_cond_t jobGo = PTHREAD_COND_INITIALIZER;
+/** \brief Signaling that all the parts of a striped transfer were carried out */
+static pthread_cond_t jobDone = PTHREAD_COND_INITIALIZER;
+/** \brief Durability mode of the storage device */
+static uint32_t devMode = DEV_SYNC;
+/** \brief Backend in use to carry out transfers */
+static uint32_t devBackend = DEV_PREAD;
+/** \brief Signaling if the host page cache is bypassed (direct transfers) */
+static bool devDirect = false;
+/** \brief Storage area of the pool of aligned buffers (direct transfers) */
+static unsigned char *pool = NULL;
+/** \brief Stack of the free aligned buffers of the pool */
+static unsigned char *poolFree[POOL_SIZE];
+/** \brief Number of free aligned buffers of the pool */
+static uint32_t nPoolFree = 0;
+/** \brief Status of the first submitted request which failed since the last wait */
+static int pendingStat = 0;
+/** \brief Transfer statistics of the storage device */
+static SORawStats stats;
+/** \brief Parameters of the simulated storage device */
+static SORawSimulation sim;
+/** \brief Signaling if a slower storage device is being simulated */
+static bool simOn = false;
+/** \brief Block where the head of the simulated device rests */
+static uint32_t simHead = 0;
+/** \brief Instant when the simulated device becomes idle (in nanoseconds of the monotonic clock) */
+static uint64_t simIdleNs = 0;
+/** \brief Instant when the last submitted request completes on the simulated device (zero, if none is pending) */
+static uint64_t simPendingNs = 0;
+
+/*
+ *  Allusion to internal functions
+ */
+
+static int rawRunIO (uint32_t n, uint32_t count, uint32_t size, void *bufs[], bool isWrite);
+static int submitRawIO (uint32_t n, uint32_t size, void *buf, bool isWrite);
+static int rawIO (uint32_t n, uint32_t size, void *buf, bool isWrite);
+static int fileIO (uint32_t n, uint32_t size, void *buf, bool isWrite);
+static int mapIO (uint32_t n, uint32_t size, void *buf, bool isWrite);
+static int openMembers (const char *devname, int flags);
+static int openMember (const char *path, int flags, uint64_t *p_nblk);
+static void closeMembers (void);
+static uint32_t locate (uint32_t n, uint32_t nblk, uint32_t *p_m, off_t *p_off);
+static int stripeIO (uint32_t n, const struct iovec *iov, uint32_t iovcnt, bool isWrite);
+static void runJobs (void);
+static void doJob (struct member *p);
+static void *jobWorker (void *arg);
+static void startWorkers (void);
+static void stopWorkers (void);
+static uint64_t clockNs (void);
+static SORawKindStats *kindStats (size_t size, bool isWrite);
+static void account (SORawKindStats *k, size_t size, uint64_t ns, int stat);
+static void printNs (FILE *fp, double ns);
+static uint64_t simulate (uint32_t n, size_t size);
+static void simWait (uint64_t until);
 
 /**
  *  \brief Open the storage device.
@@ -42,37 +176,96 @@ static uint32_t bnmax = 0;
  *  A communication channel is established with the storage device.
  *  It is supposed that no communication channel was previously established.
  *  The Linux file that simulates the storage device must exist and have a size multiple of the block size.
+ *  It may instead describe a stripe set (RAID-0), in text form: the first line is <tt>SOFS11-STRIPE unit</tt>, where
+ *  \e unit is the stripe unit in clusters, and each of the following lines names the Linux file of a member (relative
+ *  paths are taken from the directory of the description; empty lines and lines starting with '#' are skipped).
+ *  There must be between 2 and 16 members. Successive stripe units of the device are laid out on successive members,
+ *  round-robin, and each member contributes as many whole stripe units as the smallest of them holds. The parts of a
+ *  transfer which fall on different members are carried out in parallel.
+ *  The durability mode states when written data is forced to stable storage:
+ *    \li \c DEV_SYNC: every write operation on the device (the file is opened with \c O_SYNC); data written through
+ *        the buffercache, which is write-back, only reaches the device, and stable storage, when the buffercache
+ *        writes it back
+ *    \li \c DEV_DATASYNC: only at synchronization points (\e soSyncDevice and \e soCloseDevice)
+ *    \li \c DEV_UNSAFE: never, it is left to the host operating system (benchmarking only).
+ *  The backend states how transfers are carried out: \c DEV_PREAD uses positional system calls, \c DEV_MMAP maps the
+ *  whole device in main memory, so that every transfer becomes a memory copy and read-only consumers may access the
+ *  device contents in place.
+ *  Finally, with \c DEV_DIRECT, the host page cache is bypassed: main memory buffers which are not suitably aligned
+ *  are served through a pool of aligned buffers. It can not be combined with \c DEV_MMAP.
+ *  The transfer statistics are reset.
  *
  *  \param devname absolute path to the Linux file that simulates the storage device
+ *  \param mode operating mode of the storage device (durability mode | backend [| \c DEV_DIRECT])
  *  \param p_bnmax pointer to a location where the number of blocks of the device is to be stored
  *
  *  \return <tt>0 (zero)</tt>, on success
- *  \return -\c EINVAL, if \e devname or \e p_bnmax are \c NULL
+ *  \return -\c EINVAL, if \e devname or \e p_bnmax are \c NULL or the operating mode is invalid
  *  \return -\c EBUSY, if the device is already opened
- *  \return -\c ELIBBAD, if the supporting file size is invalid
- *  \return -<em>other specific error</em> issued by \e lseek system call
+ *  \return -\c ELIBBAD, if the supporting file size is invalid or the description of a stripe set is malformed
+ *  \return -\c EFBIG, if the device has more than 2^32 blocks or, for \c DEV_MMAP, does not fit in the address space
+ *  \return -\c ENOMEM, if the pool of aligned buffers can not be allocated
+ *  \return -<em>other specific error</em> issued by \e open, \e fstat or \e mmap system calls
  */
 
-int soOpenDevice (const char *devname, uint32_t *p_bnmax)
+int soOpenDevice (const char *devname, uint32_t mode, uint32_t *p_bnmax)
 {
-  soColorProbe (651, "07;31", "soOpenDevice(\"%s\", %p)\n", devname, p_bnmax);
+  soColorProbe (651, "07;31", "soOpenDevice(\"%s\", %"PRIu32", %p)\n", devname, mode, p_bnmax);
 
   if ((devname == NULL) || (p_bnmax == NULL))
      return -EINVAL;                             /* checking for null pointers */
+  if (((mode & DEV_DURABILITY) > DEV_UNSAFE) || ((mode & DEV_BACKEND) > DEV_MMAP) ||
+      ((mode & DEV_DIRECT) && ((mode & DEV_BACKEND) == DEV_MMAP)))
+     return -EINVAL;                             /* checking for operating mode */
   if (fd != -1) return -EBUSY;                   /* checking for device open state */
 
-  /* opening supporting file in sync mode for read and write */
+  memset (&stats, 0, sizeof (stats));            /* a new session of the device starts */
+  simHead = 0;                                   /* park the head of the simulated device */
+  simIdleNs = 0;
+  simPendingNs = 0;
 
-  if ((fd = open (devname, O_RDWR | O_SYNC)) == -1)
-     return -errno;                              /* checking for opening error */
+  /* opening the supporting files for read and write, in sync and direct modes if so required */
 
-  /* checking device for conformity */
+  int flags = O_RDWR;                            /* flags of the opening */
+  int stat;                                      /* status of operation */
 
-  struct stat st;
-  if (stat (devname, &st) == -1) return -errno;
-  if ((st.st_size % BLOCK_SIZE) != 0) return -ELIBBAD;
+  if ((mode & DEV_DURABILITY) == DEV_SYNC) flags |= O_SYNC;
+  if (mode & DEV_DIRECT) flags |= O_DIRECT;
+  if ((stat = openMembers (devname, flags)) != 0) return stat;
+  if (((mode & DEV_BACKEND) == DEV_MMAP) && (((uint64_t) memberBlocks * BLOCK_SIZE) > SIZE_MAX))
+     { closeMembers ();                          /* the device does not fit in the address space */
+       return -EFBIG;
+     }
+  devMode = mode & DEV_DURABILITY;
+
+  /* setting up the pool of aligned buffers and the backend */
 
-  bnmax = st.st_size / BLOCK_SIZE;               /* get number of blocks of the device */
+  uint32_t i;                                    /* counting variable */
+
+  if ((devDirect = ((mode & DEV_DIRECT) != 0)))
+     { if (posix_memalign ((void **) &pool, DIRECT_ALIGN, POOL_SIZE * POOL_STRIDE) != 0)
+          { pool = NULL;
+            devDirect = false;
+            closeMembers ();
+            return -ENOMEM;
+          }
+       for (i = 0; i < POOL_SIZE; i++)
+         poolFree[i] = pool + i * POOL_STRIDE;
+       nPoolFree = POOL_SIZE;
+     }
+  devBackend = mode & DEV_BACKEND;
+  if (devBackend == DEV_MMAP)
+     { for (i = 0; i < nMembers; i++)
+         if ((member[i].map = mmap (NULL, (size_t) memberBlocks * BLOCK_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED,
+                                    member[i].fd, 0)) == MAP_FAILED)
+            { stat = -errno;
+              member[i].map = NULL;
+              closeMembers ();
+              return stat;
+            }
+     }
+  if ((nMembers > 1) && (devBackend == DEV_PREAD))
+     startWorkers ();
   *p_bnmax = bnmax;
 
   return 0;
@@ -82,21 +275,72 @@ int soOpenDevice (const char *devname, uint32_t *p_bnmax)
  *  \brief Close the storage device.
  *
  *  The communication channel previously established with the storage device is closed.
+ *  Any submitted request is waited for and, in \c DEV_DATASYNC mode, the data written so far is forced to stable
+ *  storage before.
  *
  *  \return <tt>0 (zero)</tt>, on success
  *  \return -\c EBADF, if the device is not opened
+ *  \return -\c EIO, if a submitted request failed or it fails on synchronizing
  */
 
 int soCloseDevice (void)
 {
   soColorProbe (652, "07;31", "soCloseDevice()\n");
 
+  int stat;                                      /* status of operation */
+
+  if (fd == -1) return -EBADF;                   /* checking for device close state */
+
+  stat = soSyncDevice ();                        /* force written data to stable storage */
+  stopWorkers ();
+  devBackend = DEV_PREAD;
+  if (devDirect)
+     { free (pool);
+       pool = NULL;
+       nPoolFree = 0;
+       devDirect = false;
+     }
+  closeMembers ();                               /* unmap and close the supporting files, reset number of blocks
+                                                    and file descriptor */
+  devMode = DEV_SYNC;                            /* reset durability mode */
+
+  return stat;
+}
+
+/**
+ *  \brief Synchronize the storage device.
+ *
+ *  Any submitted request is waited for first. Then, the data written so far to the storage device is forced to stable
+ *  storage, if the durability mode so requires.
+ *  This is only effective in \c DEV_DATASYNC mode (\e fdatasync or, for a memory-mapped device, \e msync): in
+ *  \c DEV_SYNC mode every write to the device is already synchronous and in \c DEV_UNSAFE mode synchronization is
+ *  deliberately skipped. Data still held in the buffercache is not affected: it has to be written back first.
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EBADF, if the device is not opened
+ *  \return -\c EIO, if a submitted request failed or it fails on synchronizing
+ */
+
+int soSyncDevice (void)
+{
+  soColorProbe (659, "07;31", "soSyncDevice()\n");
+
+  int stat;                                      /* status of operation */
+
   if (fd == -1) return -EBADF;                   /* checking for device close state */
 
-  close (fd);                                    /* close the device */
-  bnmax = 0;                                     /* reset number of blocks of the storage device */
-  fd = -1;                                       /* reset file descriptor of the Linux file that simulates the
-                                                    magnetic disk */
+  if ((stat = soWaitRawIO ()) != 0) return stat;
+  if (devMode == DEV_DATASYNC)
+     { uint64_t t0 = clockNs ();                 /* start of the synchronization */
+       uint32_t i;                               /* counting variable */
+       for (i = 0; i < nMembers; i++)
+         if (devBackend == DEV_MMAP)
+            { if (msync (member[i].map, (size_t) memberBlocks * BLOCK_SIZE, MS_SYNC) == -1) stat = -1; }
+            else if (fdatasync (member[i].fd) == -1) stat = -1;
+       stats.syncs += 1;
+       stats.syncNs += clockNs () - t0;
+       if (stat == -1) return -EIO;
+     }
 
   return 0;
 }
@@ -115,7 +359,6 @@ int soCloseDevice (void)
  *  \return -\c EINVAL, if the <em>buffer pointer</em> is \c NULL or the <em>block number</em> is out of range
  *  \return -\c EBADF, if the device is not already opened
  *  \return -\c EIO, if it fails on reading
- *  \return -<em>other specific error</em> issued by \e lseek system call
  */
 
 int soReadRawBlock (uint32_t n, void *buf)
@@ -126,12 +369,9 @@ int soReadRawBlock (uint32_t n, void *buf)
   if (n >= bnmax) return -EINVAL;                /* checking for block number */
   if (fd == -1) return -EBADF;                   /* checking for device closed state */
 
-  /* set file current position to the required block and read its contents */
+  /* read the contents of the required block */
 
-  if (lseek (fd, BLOCK_SIZE * n, SEEK_SET) == -1) return -errno;
-  if (read (fd, buf, BLOCK_SIZE) != BLOCK_SIZE) return -EIO;
-
-  return 0;
+  return rawIO (n, BLOCK_SIZE, buf, false);
 }
 
 /**
@@ -148,7 +388,6 @@ int soReadRawBlock (uint32_t n, void *buf)
  *  \return -\c EINVAL, if <em>buffer pointer</em> is \c NULL or <em>block number</em> is out of range
  *  \return -\c EBADF, if the device is not already opened
  *  \return -\c EIO, if it fails on writing
- *  \return -<em>other specific error</em> issued by \e lseek system call
  */
 
 int soWriteRawBlock (uint32_t n, void *buf)
@@ -159,12 +398,9 @@ int soWriteRawBlock (uint32_t n, void *buf)
   if (n >= bnmax) return -EINVAL;                /* checking for block number */
   if (fd == -1) return -EBADF;                   /* checking for device closed state */
 
-  /* set file current position to the required block and write its contents */
+  /* write the contents of the required block */
 
-  if (lseek (fd, BLOCK_SIZE * n, SEEK_SET) == -1) return -errno;
-  if (write (fd, buf, BLOCK_SIZE) != BLOCK_SIZE) return -EIO;
-
-  return 0;
+  return rawIO (n, BLOCK_SIZE, buf, true);
 }
 
 /**
@@ -181,7 +417,6 @@ int soWriteRawBlock (uint32_t n, void *buf)
  *  \return -\c EINVAL, if the <em>buffer pointer</em> is \c NULL or the <em>block number</em> is out of range
  *  \return -\c EBADF, if the device is not already opened
  *  \return -\c EIO, if it fails on reading
- *  \return -<em>other specific error</em> issued by \e lseek system call
  */
 
 int soReadRawCluster (uint32_t n, void *buf)
@@ -189,16 +424,13 @@ int soReadRawCluster (uint32_t n, void *buf)
   soColorProbe (655, "07;31", "soReadRawCluster(%"PRIu32", %p)\n", n, buf);
 
   if (buf == NULL) return -EINVAL;               /* checking for null pointer */
-  if ((n + BLOCKS_PER_CLUSTER) > bnmax)          /* checking for cluster number */
+  if (((uint64_t) n + BLOCKS_PER_CLUSTER) > bnmax)        /* checking for cluster number */
      return -EINVAL;
   if (fd == -1) return -EBADF;                   /* checking for device closed state */
 
-  /* Set file current position to first block of the required cluster and read blocks contents in succession */
-
-  if (lseek (fd, BLOCK_SIZE * n, SEEK_SET) == -1) return -errno;
-  if (read (fd, buf, CLUSTER_SIZE) != CLUSTER_SIZE) return -EIO;
+  /* read blocks contents in succession, starting at the first block of the required cluster */
 
-  return 0;
+  return rawIO (n, CLUSTER_SIZE, buf, false);
 }
 
 /**
@@ -215,7 +447,6 @@ int soReadRawCluster (uint32_t n, void *buf)
  *  \return -\c EINVAL, if <em>buffer pointer</em> is \c NULL or <em>block number</em> is out of range
  *  \return -\c EBADF, if the device is not already opened
  *  \return -\c EIO, if it fails on writing
- *  \return -<em>other specific error</em> issued by \e lseek system call
  */
 
 int soWriteRawCluster (uint32_t n, void *buf)
@@ -223,14 +454,1081 @@ int soWriteRawCluster (uint32_t n, void *buf)
   soColorProbe (656, "07;31", "soWriteRawCluster(%"PRIu32", %p)\n", n, buf);
 
   if (buf == NULL) return -EINVAL;               /* checking for null pointer */
-  if ((n + BLOCKS_PER_CLUSTER) > bnmax)          /* checking for cluster number */
+  if (((uint64_t) n + BLOCKS_PER_CLUSTER) > bnmax)        /* checking for cluster number */
      return -EINVAL;
   if (fd == -1) return -EBADF;                   /* checking for device closed state */
 
-  /* Set file current position to first block of the required cluster and write blocks contents in succession */
+  /* write blocks contents in succession, starting at the first block of the required cluster */
+
+  return rawIO (n, CLUSTER_SIZE, buf, true);
+}
+
+/**
+ *  \brief Read a run of contiguous clusters of data from the storage device.
+ *
+ *  The device is organized as a linear array of data blocks. A cluster is a group of successive blocks.
+ *  The physical number of the first block of the first data cluster to be read, the number of successive clusters and
+ *  an array of pointers to previously allocated buffers, one per cluster, are supplied as arguments. The buffers need
+ *  not be contiguous in main memory: the whole run is transferred by a single vectored read.
+ *
+ *  \param n physical number of the first block of the first data cluster to be read from
+ *  \param count number of successive clusters to be read
+ *  \param bufs array of pointers to the buffers where the data of each cluster must be read into
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the <em>buffer array pointer</em> or any of the <em>buffer pointers</em> is \c NULL, the
+ *                      <em>number of clusters</em> is zero or the run is out of range or too large to be transferred
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on reading
+ */
+
+int soReadRawClusters (uint32_t n, uint32_t count, void *bufs[])
+{
+  soColorProbe (657, "07;31", "soReadRawClusters(%"PRIu32", %"PRIu32", %p)\n", n, count, bufs);
+
+  return rawRunIO (n, count, BLOCKS_PER_CLUSTER, bufs, false);
+}
+
+/**
+ *  \brief Write a run of contiguous clusters of data to the storage device.
+ *
+ *  The device is organized as a linear array of data blocks. A cluster is a group of successive blocks.
+ *  The physical number of the first block of the first data cluster to be written, the number of successive clusters
+ *  and an array of pointers to previously allocated buffers, one per cluster, are supplied as arguments. The buffers
+ *  need not be contiguous in main memory: the whole run is transferred by a single vectored write.
+ *
+ *  \param n physical number of the first block of the first data cluster to be written into
+ *  \param count number of successive clusters to be written
+ *  \param bufs array of pointers to the buffers containing the data of each cluster to be written from
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the <em>buffer array pointer</em> or any of the <em>buffer pointers</em> is \c NULL, the
+ *                      <em>number of clusters</em> is zero or the run is out of range or too large to be transferred
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on writing
+ */
+
+int soWriteRawClusters (uint32_t n, uint32_t count, void *bufs[])
+{
+  soColorProbe (658, "07;31", "soWriteRawClusters(%"PRIu32", %"PRIu32", %p)\n", n, count, bufs);
+
+  return rawRunIO (n, count, BLOCKS_PER_CLUSTER, bufs, true);
+}
+
+/**
+ *  \brief Read a run of contiguous blocks of data from the storage device.
+ *
+ *  The device is organized as a linear array of data blocks.
+ *  The physical number of the first block to be read, the number of successive blocks and an array of pointers to
+ *  previously allocated buffers, one per block, are supplied as arguments. The buffers need not be contiguous in main
+ *  memory, those which are adjacent are taken as a whole: the whole run is transferred by a single vectored read.
+ *
+ *  \param n physical number of the first block to be read from
+ *  \param count number of successive blocks to be read
+ *  \param bufs array of pointers to the buffers where the data of each block must be read into
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the <em>buffer array pointer</em> or any of the <em>buffer pointers</em> is \c NULL, the
+ *                      <em>number of blocks</em> is zero or the run is out of range or too large to be transferred
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on reading
+ */
+
+int soReadRawBlocks (uint32_t n, uint32_t count, void *bufs[])
+{
+  soColorProbe (673, "07;31", "soReadRawBlocks(%"PRIu32", %"PRIu32", %p)\n", n, count, bufs);
+
+  return rawRunIO (n, count, 1, bufs, false);
+}
+
+/**
+ *  \brief Write a run of contiguous blocks of data to the storage device.
+ *
+ *  The device is organized as a linear array of data blocks.
+ *  The physical number of the first block to be written, the number of successive blocks and an array of pointers to
+ *  previously allocated buffers, one per block, are supplied as arguments. The buffers need not be contiguous in main
+ *  memory, those which are adjacent are taken as a whole: the whole run is transferred by a single vectored write.
+ *
+ *  \param n physical number of the first block to be written into
+ *  \param count number of successive blocks to be written
+ *  \param bufs array of pointers to the buffers containing the data of each block to be written from
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the <em>buffer array pointer</em> or any of the <em>buffer pointers</em> is \c NULL, the
+ *                      <em>number of blocks</em> is zero or the run is out of range or too large to be transferred
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on writing
+ */
+
+int soWriteRawBlocks (uint32_t n, uint32_t count, void *bufs[])
+{
+  soColorProbe (674, "07;31", "soWriteRawBlocks(%"PRIu32", %"PRIu32", %p)\n", n, count, bufs);
+
+  return rawRunIO (n, count, 1, bufs, true);
+}
+
+/**
+ *  \brief Submit the reading of a block of data from the storage device.
+ *
+ *  The request is handed to the device backend, which presently carries it out at once, and any failure is only
+ *  reported when waiting for it. On a simulated device, its completion is only waited for then as well.
+ *  The buffer must not be accessed before \e soWaitRawIO is called. Submitted requests are not ordered among
+ *  themselves, nor with respect to the other operations, so the same block must not be referred to twice before
+ *  waiting.
+ *
+ *  \param n physical number of the data block to be read from
+ *  \param buf pointer to the buffer where the data must be read into
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the <em>buffer pointer</em> is \c NULL or the <em>block number</em> is out of range
+ *  \return -\c EBADF, if the device is not already opened
+ */
+
+int soSubmitReadRawBlock (uint32_t n, void *buf)
+{
+  soColorProbe (660, "07;31", "soSubmitReadRawBlock(%"PRIu32", %p)\n", n, buf);
+
+  if (buf == NULL) return -EINVAL;               /* checking for null pointer */
+  if (n >= bnmax) return -EINVAL;                /* checking for block number */
+  if (fd == -1) return -EBADF;                   /* checking for device closed state */
+
+  return submitRawIO (n, BLOCK_SIZE, buf, false);
+}
+
+/**
+ *  \brief Submit the writing of a block of data to the storage device.
+ *
+ *  The request is handed to the device backend, which presently carries it out at once, and any failure is only
+ *  reported when waiting for it. On a simulated device, its completion is only waited for then as well.
+ *  The buffer must not be changed before \e soWaitRawIO is called.
+ *
+ *  \param n physical number of the block to be written into
+ *  \param buf pointer to the buffer containing the data to be written from
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if <em>buffer pointer</em> is \c NULL or <em>block number</em> is out of range
+ *  \return -\c EBADF, if the device is not already opened
+ */
+
+int soSubmitWriteRawBlock (uint32_t n, void *buf)
+{
+  soColorProbe (661, "07;31", "soSubmitWriteRawBlock(%"PRIu32", %p)\n", n, buf);
+
+  if (buf == NULL) return -EINVAL;               /* checking for null pointer */
+  if (n >= bnmax) return -EINVAL;                /* checking for block number */
+  if (fd == -1) return -EBADF;                   /* checking for device closed state */
+
+  return submitRawIO (n, BLOCK_SIZE, buf, true);
+}
+
+/**
+ *  \brief Submit the reading of a cluster of data from the storage device.
+ *
+ *  The request is handed to the device backend, which presently carries it out at once, and any failure is only
+ *  reported when waiting for it. On a simulated device, its completion is only waited for then as well.
+ *  The buffer must not be accessed before \e soWaitRawIO is called.
+ *
+ *  \param n physical number of the first block of the data cluster to be read from
+ *  \param buf pointer to the buffer where the data must be read into
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the <em>buffer pointer</em> is \c NULL or the <em>block number</em> is out of range
+ *  \return -\c EBADF, if the device is not already opened
+ */
+
+int soSubmitReadRawCluster (uint32_t n, void *buf)
+{
+  soColorProbe (662, "07;31", "soSubmitReadRawCluster(%"PRIu32", %p)\n", n, buf);
+
+  if (buf == NULL) return -EINVAL;               /* checking for null pointer */
+  if (((uint64_t) n + BLOCKS_PER_CLUSTER) > bnmax)        /* checking for cluster number */
+     return -EINVAL;
+  if (fd == -1) return -EBADF;                   /* checking for device closed state */
+
+  return submitRawIO (n, CLUSTER_SIZE, buf, false);
+}
+
+/**
+ *  \brief Submit the writing of a cluster of data to the storage device.
+ *
+ *  The request is handed to the device backend, which presently carries it out at once, and any failure is only
+ *  reported when waiting for it. On a simulated device, its completion is only waited for then as well.
+ *  The buffer must not be changed before \e soWaitRawIO is called.
+ *
+ *  \param n physical number of the first block of the data cluster to be written into
+ *  \param buf pointer to the buffer containing the data to be written from
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if <em>buffer pointer</em> is \c NULL or <em>block number</em> is out of range
+ *  \return -\c EBADF, if the device is not already opened
+ */
+
+int soSubmitWriteRawCluster (uint32_t n, void *buf)
+{
+  soColorProbe (663, "07;31", "soSubmitWriteRawCluster(%"PRIu32", %p)\n", n, buf);
+
+  if (buf == NULL) return -EINVAL;               /* checking for null pointer */
+  if (((uint64_t) n + BLOCKS_PER_CLUSTER) > bnmax)        /* checking for cluster number */
+     return -EINVAL;
+  if (fd == -1) return -EBADF;                   /* checking for device closed state */
+
+  return submitRawIO (n, CLUSTER_SIZE, buf, true);
+}
+
+/**
+ *  \brief Wait for all the submitted requests to be carried out.
+ *
+ *  On a simulated device, it waits until the last of them is complete.
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if any of the requests submitted since the last wait failed
+ */
+
+int soWaitRawIO (void)
+{
+  soColorProbe (664, "07;31", "soWaitRawIO()\n");
+
+  int stat;                                      /* status of operation */
+
+  if (fd == -1) return -EBADF;                   /* checking for device closed state */
+
+  if (simPendingNs != 0)
+     { simWait (simPendingNs);                   /* the simulated device is not done yet */
+       simPendingNs = 0;
+     }
+  stat = pendingStat;
+  pendingStat = 0;
+
+  return stat;
+}
+
+/**
+ *  \brief Get direct access to a block of data of the storage device.
+ *
+ *  It is only available with the \c DEV_MMAP backend: a pointer to the block contents inside the mapping of the
+ *  device is handed out, so that no transfer takes place. The contents must only be read, and the pointer is no longer
+ *  valid after the device is closed. Consumers should fall back to \e soReadRawBlock, if -\c EOPNOTSUPP is returned.
+ *
+ *  \param n physical number of the data block to be accessed
+ *  \param p_buf pointer to a location where the pointer to the block contents is to be stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the <em>pointer</em> is \c NULL or the <em>block number</em> is out of range
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EOPNOTSUPP, if the device is not memory-mapped
+ */
+
+int soPeekRawBlock (uint32_t n, const void **p_buf)
+{
+  soColorProbe (665, "07;31", "soPeekRawBlock(%"PRIu32", %p)\n", n, p_buf);
+
+  if (p_buf == NULL) return -EINVAL;             /* checking for null pointer */
+  if (n >= bnmax) return -EINVAL;                /* checking for block number */
+  if (fd == -1) return -EBADF;                   /* checking for device closed state */
+  if (devBackend != DEV_MMAP) return -EOPNOTSUPP;
+
+  uint32_t m;                                    /* member holding the block */
+  off_t off;                                     /* byte offset of the block in the member */
+
+  locate (n, 1, &m, &off);
+  *p_buf = member[m].map + off;
+
+  return 0;
+}
+
+/**
+ *  \brief Get direct access to a cluster of data of the storage device.
+ *
+ *  It is only available with the \c DEV_MMAP backend: a pointer to the cluster contents inside the mapping of the
+ *  device is handed out, so that no transfer takes place. The contents must only be read, and the pointer is no longer
+ *  valid after the device is closed. Consumers should fall back to \e soReadRawCluster, if -\c EOPNOTSUPP is
+ *  returned. On a stripe set, a cluster which straddles two members is not contiguous in main memory and can not be
+ *  accessed in place either.
+ *
+ *  \param n physical number of the first block of the data cluster to be accessed
+ *  \param p_buf pointer to a location where the pointer to the cluster contents is to be stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the <em>pointer</em> is \c NULL or the <em>block number</em> is out of range
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EOPNOTSUPP, if the device is not memory-mapped or the cluster straddles two members of a stripe set
+ */
+
+int soPeekRawCluster (uint32_t n, const void **p_buf)
+{
+  soColorProbe (666, "07;31", "soPeekRawCluster(%"PRIu32", %p)\n", n, p_buf);
+
+  if (p_buf == NULL) return -EINVAL;             /* checking for null pointer */
+  if (((uint64_t) n + BLOCKS_PER_CLUSTER) > bnmax)        /* checking for cluster number */
+     return -EINVAL;
+  if (fd == -1) return -EBADF;                   /* checking for device closed state */
+  if (devBackend != DEV_MMAP) return -EOPNOTSUPP;
+
+  uint32_t m;                                    /* member holding the cluster */
+  off_t off;                                     /* byte offset of the cluster in the member */
+
+  if (locate (n, BLOCKS_PER_CLUSTER, &m, &off) != BLOCKS_PER_CLUSTER)
+     return -EOPNOTSUPP;                         /* the cluster straddles two members */
+  *p_buf = member[m].map + off;
+
+  return 0;
+}
+
+/**
+ *  \brief Get a snapshot of the transfer statistics of the storage device.
+ *
+ *  They are kept since the device was last opened or the statistics were last reset, and survive the closing of the
+ *  device.
+ *
+ *  \param p_stats pointer to a location where the statistics are to be stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the <em>pointer</em> is \c NULL
+ */
+
+int soGetRawStats (SORawStats *p_stats)
+{
+  soColorProbe (667, "07;31", "soGetRawStats(%p)\n", p_stats);
+
+  if (p_stats == NULL) return -EINVAL;           /* checking for null pointer */
+
+  *p_stats = stats;
+
+  return 0;
+}
+
+/**
+ *  \brief Reset the transfer statistics of the storage device.
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ */
+
+int soResetRawStats (void)
+{
+  soColorProbe (668, "07;31", "soResetRawStats()\n");
+
+  memset (&stats, 0, sizeof (stats));
+
+  return 0;
+}
+
+/**
+ *  \brief Print the transfer statistics of the storage device.
+ *
+ *  For each kind of transfer with some activity, the counters, the mean and the maximum latency, the throughput while
+ *  busy and the non-empty buckets of the latency histogram are printed.
+ *
+ *  \param fp stream where the statistics are to be printed
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the <em>stream</em> is \c NULL
+ */
+
+int soPrintRawStats (FILE *fp)
+{
+  soColorProbe (669, "07;31", "soPrintRawStats(%p)\n", fp);
+
+  static const char *kindName[RAW_KINDS] = { "block read", "block write", "cluster read", "cluster write" };
+  SORawStats st = stats;                         /* snapshot of the statistics */
+  SORawKindStats *k;                             /* statistics of the current kind of transfer */
+  uint32_t i, b;                                 /* counting variables */
+
+  if (fp == NULL) return -EINVAL;                /* checking for null pointer */
+
+  fprintf (fp, "Raw device transfers\n");
+  for (i = 0; i < RAW_KINDS; i++)
+  { k = &st.kind[i];
+    if (k->ops == 0) continue;
+    fprintf (fp, "   %-13s %"PRIu64" ops, %"PRIu64" errors, %"PRIu64" bytes, mean ", kindName[i], k->ops, k->errors,
+             k->bytes);
+    printNs (fp, (double) k->totalNs / k->ops);
+    fprintf (fp, ", max ");
+    printNs (fp, (double) k->maxNs);
+    if (k->totalNs != 0)
+       fprintf (fp, ", %.1f MB/s while busy", (double) k->bytes * 1e3 / k->totalNs);
+    fprintf (fp, "\n");
+    if (k->submitted != 0)
+       fprintf (fp, "      %"PRIu64" submitted\n", k->submitted);
+    fprintf (fp, "      latency histogram:");
+    for (b = 0; b < RAW_LAT_BUCKETS; b++)
+      if (k->latency[b] != 0)
+         { fprintf (fp, " %s", (b == RAW_LAT_BUCKETS - 1) ? ">=" : "<");
+           printNs (fp, (double) ((b == RAW_LAT_BUCKETS - 1) ? (UINT64_C(1) << (b - 1)) : (UINT64_C(1) << b)));
+           fprintf (fp, ": %"PRIu64"", k->latency[b]);
+         }
+    fprintf (fp, "\n");
+  }
+  if (st.syncs != 0)
+     { fprintf (fp, "   %-13s %"PRIu64" ops, mean ", "sync", st.syncs);
+       printNs (fp, (double) st.syncNs / st.syncs);
+       fprintf (fp, "\n");
+     }
+
+  return 0;
+}
+
+/**
+ *  \brief Set up the simulation of a slower storage device.
+ *
+ *  The parameters take effect at once and are kept across the opening and closing of the device; the head is parked
+ *  at block 0 whenever the device is opened.
+ *
+ *  \param p_sim pointer to the parameters of the simulated device (\c NULL turns the simulation off)
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ */
+
+int soSetRawSimulation (const SORawSimulation *p_sim)
+{
+  soColorProbe (670, "07;31", "soSetRawSimulation(%p)\n", p_sim);
+
+  if (p_sim == NULL)
+     memset (&sim, 0, sizeof (sim));
+     else sim = *p_sim;
+  simOn = (sim.latencyUs != 0) || (sim.bandwidthMBs != 0) || (sim.seekNsPerBlock != 0);
+
+  return 0;
+}
+
+/**
+ *  \brief Parse the description of a simulated storage device.
+ *
+ *  The description has the format <em>latency:bandwidth:seek</em>, in microseconds, MB/s and nanoseconds per block,
+ *  respectively. Trailing fields may be omitted and empty fields are taken as zero: for instance, "8000:120:50"
+ *  resembles a spinning disk and "500::" a network volume with a fixed round trip.
+ *
+ *  \param spec description of the simulated device
+ *  \param p_sim pointer to a location where the parameters are to be stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if any of the <em>pointers</em> is \c NULL or the description is malformed
+ */
+
+int soParseRawSimulation (const char *spec, SORawSimulation *p_sim)
+{
+  soColorProbe (671, "07;31", "soParseRawSimulation(\"%s\", %p)\n", spec, p_sim);
+
+  uint32_t *field[3];                            /* fields of the description, in order */
+  unsigned long val;                             /* value of the current field */
+  char *end;                                     /* end of the current field */
+  uint32_t i;                                    /* counting variable */
+
+  if ((spec == NULL) || (p_sim == NULL)) return -EINVAL;   /* checking for null pointers */
+
+  memset (p_sim, 0, sizeof (SORawSimulation));
+  field[0] = &p_sim->latencyUs;
+  field[1] = &p_sim->bandwidthMBs;
+  field[2] = &p_sim->seekNsPerBlock;
+  for (i = 0; i < 3; i++)
+  { if ((*spec != ':') && (*spec != '\0'))
+       { if ((*spec < '0') || (*spec > '9')) return -EINVAL;
+         errno = 0;
+         val = strtoul (spec, &end, 10);
+         if ((errno != 0) || (val > UINT32_MAX)) return -EINVAL;
+         *field[i] = (uint32_t) val;
+         spec = end;
+       }
+    if (*spec == '\0') return 0;
+    if (*spec != ':') return -EINVAL;
+    spec += 1;
+  }
+
+  return -EINVAL;                                /* too many fields */
+}
+
+/**
+ *  \brief Get the size of a storage device.
+ *
+ *  The Linux file that simulates the storage device, or the files of the members of a stripe set, are checked just
+ *  like on opening the device (see \e soOpenDevice) and the number of blocks of the device is computed. It is meant
+ *  for tools which have to know the size of the device before opening it, so the device must not be opened.
+ *
+ *  \param devname path to the Linux file that simulates the storage device
+ *  \param p_nblocks pointer to a location where the number of blocks of the device is to be stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if any of the <em>pointers</em> is \c NULL
+ *  \return -\c EBUSY, if the device is opened
+ *  \return -\c ELIBBAD, if the supporting file size is invalid or the description of a stripe set is malformed
+ *  \return -\c EFBIG, if the device has more than 2^32 blocks
+ *  \return -<em>other specific error</em> issued by \e open or \e fstat system calls
+ */
+
+int soGetDeviceSize (const char *devname, uint32_t *p_nblocks)
+{
+  soColorProbe (672, "07;31", "soGetDeviceSize(\"%s\", %p)\n", devname, p_nblocks);
+
+  int stat;                                      /* status of operation */
+
+  if ((devname == NULL) || (p_nblocks == NULL))
+     return -EINVAL;                             /* checking for null pointers */
+  if (fd != -1) return -EBUSY;                   /* checking for device close state */
+
+  if ((stat = openMembers (devname, O_RDONLY)) != 0) return stat;
+  *p_nblocks = bnmax;
+  closeMembers ();
+
+  return 0;
+}
+
+/*
+ *  Transfer a run of contiguous blocks (clusters) between the storage device and a set of buffers, one per block
+ *  (cluster), whose size is given in blocks.
+ *
+ *  Buffers which are adjacent in main memory make up a single entry of the scatter / gather list, unless the device is
+ *  a stripe set. The run is split in chunks of, at most, MAX_IOV entries (the limit imposed on a vectored transfer);
+ *  each chunk takes a single preadv / pwritev system call (one per member, in parallel, on a stripe set). If the
+ *  device is memory-mapped, or some of the buffers are not aligned for a direct transfer, the buffers are transferred
+ *  one at a time.
+ */
+
+static int rawRunIO (uint32_t n, uint32_t count, uint32_t size, void *bufs[], bool isWrite)
+{
+  struct iovec iov[MAX_IOV];                     /* scatter / gather list of the current chunk */
+  size_t len = (size_t) size * BLOCK_SIZE;       /* size of a buffer in bytes */
+  uint32_t i, first, nIov;                       /* counting variables / number of entries of the current chunk */
+  size_t total;                                  /* number of bytes to be transferred */
+  ssize_t done;                                  /* number of bytes effectively transferred */
+  uint64_t t0;                                   /* start of the transfer of the current chunk */
+
+  if ((bufs == NULL) || (count == 0)) return -EINVAL;      /* checking for null pointer and empty run */
+  if ((count > bnmax / size) || (((uint64_t) n + (uint64_t) count * size) > bnmax))
+     return -EINVAL;                                       /* checking for block (cluster) numbers */
+  if (count > SSIZE_MAX / len) return -EINVAL;   /* checking for the size of the run in bytes */
+  for (i = 0; i < count; i++)
+    if (bufs[i] == NULL) return -EINVAL;         /* checking for null pointers */
+  if (fd == -1) return -EBADF;                   /* checking for device closed state */
+
+  bool inTurn = (devBackend == DEV_MMAP);       /* signaling if the buffers are to be transferred one at a time */
+
+  for (i = 0; (i < count) && !inTurn; i++)
+    inTurn = devDirect && !ALIGNED (bufs[i]);    /* unaligned buffers have to go through the pool */
+  if (inTurn)
+     { int stat;                                 /* status of operation */
+       for (i = 0; i < count; i++)
+         if ((stat = rawIO (n + i * size, (uint32_t) len, bufs[i], isWrite)) != 0) return stat;
+       return 0;
+     }
+
+  for (first = 0; first < count; first = i)
+  { for (i = first, nIov = 0; i < count; i++)
+    { if ((nIov != 0) && (nMembers == 1) &&
+          ((unsigned char *) iov[nIov-1].iov_base + iov[nIov-1].iov_len == (unsigned char *) bufs[i]))
+         iov[nIov-1].iov_len += len;             /* adjacent in main memory */
+         else { if (nIov == MAX_IOV) break;
+                iov[nIov].iov_base = bufs[i];
+                iov[nIov].iov_len = len;
+                nIov += 1;
+              }
+    }
+    total = (size_t) (i - first) * len;
+    t0 = clockNs ();
+    if (nMembers > 1)
+       done = (stripeIO (n + first * size, iov, nIov, isWrite) == 0) ? (ssize_t) total : -1;
+       else if (isWrite)
+               done = pwritev (fd, iov, (int) nIov, OFFSET (n + first * size));
+               else done = preadv (fd, iov, (int) nIov, OFFSET (n + first * size));
+    if (simOn) simWait (simulate (n + first * size, total));
+    account (kindStats (total, isWrite), total, clockNs () - t0, (done == (ssize_t) total) ? 0 : -EIO);
+    if (done != (ssize_t) total) return -EIO;
+  }
+
+  return 0;
+}
+
+/*
+ *  Submit a transfer between the storage device and a buffer.
+ *
+ *  The transfer is carried out at once, but a failure is only reported on the next wait. On a simulated device, the
+ *  transfer is scheduled and its completion is waited for on the next wait as well, so that the simulated time of
+ *  independent requests overlaps with the caller's work.
+ */
+
+static int submitRawIO (uint32_t n, uint32_t size, void *buf, bool isWrite)
+{
+  uint64_t t0 = clockNs ();                      /* start of the transfer */
+  uint64_t doneNs;                               /* instant of completion of the transfer */
+  int stat;                                      /* status of operation */
 
-  if (lseek (fd, BLOCK_SIZE * n, SEEK_SET) == -1) return -errno;
-  if (write (fd, buf, CLUSTER_SIZE) != CLUSTER_SIZE) return -EIO;
+  if (devBackend == DEV_MMAP)
+     stat = mapIO (n, size, buf, isWrite);
+     else stat = fileIO (n, size, buf, isWrite);
+  if (simOn)
+     { doneNs = simulate (n, size);
+       if (doneNs > simPendingNs) simPendingNs = doneNs;
+     }
+     else doneNs = clockNs ();
+  account (kindStats (size, isWrite), size, doneNs - t0, stat);
+  kindStats (size, isWrite)->submitted += 1;
+  if ((stat != 0) && (pendingStat == 0))
+     pendingStat = -EIO;
 
   return 0;
 }
+
+/*
+ *  Transfer data between the storage device and a buffer, at once, and account for it.
+ */
+
+static int rawIO (uint32_t n, uint32_t size, void *buf, bool isWrite)
+{
+  uint64_t t0 = clockNs ();                      /* start of the transfer */
+  int stat;                                      /* status of operation */
+
+  if (devBackend == DEV_MMAP)
+     stat = mapIO (n, size, buf, isWrite);
+     else stat = fileIO (n, size, buf, isWrite);
+  if (simOn) simWait (simulate (n, size));
+  account (kindStats (size, isWrite), size, clockNs () - t0, stat);
+
+  return stat;
+}
+
+/*
+ *  Transfer data between the Linux files that simulate the storage device and a buffer.
+ *
+ *  For direct transfers, a buffer which is not aligned is replaced by an aligned buffer of the pool.
+ */
+
+static int fileIO (uint32_t n, uint32_t size, void *buf, bool isWrite)
+{
+  unsigned char *bounce = NULL;                  /* aligned buffer of the pool, if one is needed */
+  void *p = buf;                                 /* buffer effectively used in the transfer */
+  ssize_t done;                                  /* number of bytes effectively transferred */
+  struct iovec iov;                              /* the buffer, as a scatter / gather list */
+
+  if (devDirect && !ALIGNED (buf))
+     { if (nPoolFree == 0) return -ENOMEM;
+       p = bounce = poolFree[--nPoolFree];
+       if (isWrite) memcpy (bounce, buf, size);
+     }
+  if (nMembers > 1)
+     { iov.iov_base = p;
+       iov.iov_len = size;
+       done = (stripeIO (n, &iov, 1, isWrite) == 0) ? (ssize_t) size : -1;
+     }
+     else if (isWrite)
+             done = pwrite (fd, p, size, OFFSET (n));
+             else done = pread (fd, p, size, OFFSET (n));
+  if (bounce != NULL)
+     { if (!isWrite && (done == size)) memcpy (buf, bounce, size);
+       poolFree[nPoolFree++] = bounce;
+     }
+  if (done != size) return -EIO;
+
+  return 0;
+}
+
+/*
+ *  Transfer data between the mapping of the storage device and a buffer.
+ *
+ *  On a stripe set, the transfer is carried out piece by piece, one for each member it touches. In DEV_SYNC mode, a
+ *  write is made stable at once by synchronizing the pages it touched.
+ */
+
+static int mapIO (uint32_t n, uint32_t size, void *buf, bool isWrite)
+{
+  unsigned char *b = buf;                        /* part of the buffer of the current piece */
+  unsigned char *p;                              /* location of the current piece in the mapping */
+  uintptr_t page;                                /* start of the first page touched */
+  uint32_t nblk, piece, m;                       /* blocks still to be transferred / of the current piece, member */
+  size_t len;                                    /* number of bytes of the current piece */
+  off_t off;                                     /* byte offset of the current piece in the member */
+
+  for (nblk = size / BLOCK_SIZE; nblk > 0; nblk -= piece, n += piece, b += len)
+  { piece = locate (n, nblk, &m, &off);
+    p = member[m].map + off;
+    len = (size_t) piece * BLOCK_SIZE;
+    if (!isWrite)
+       { memcpy (b, p, len);
+         continue;
+       }
+    memcpy (p, b, len);
+    if (devMode == DEV_SYNC)
+       { page = (uintptr_t) p & ~((uintptr_t) sysconf (_SC_PAGESIZE) - 1);
+         if (msync ((void *) page, (uintptr_t) p + len - page, MS_SYNC) == -1) return -EIO;
+       }
+  }
+
+  return 0;
+}
+
+/*
+ *  Open the Linux files that simulate the storage device.
+ *
+ *  If the file describes a stripe set, the files of its members are opened instead and the stripe unit is set.
+ *  Number of members, number of blocks held by each one and number of blocks of the device are set.
+ */
+
+static int openMembers (const char *devname, int flags)
+{
+  FILE *f;                                       /* stream of the description of a stripe set */
+  char line[PATH_MAX];                           /* current line of the description */
+  char path[PATH_MAX];                           /* path to the Linux file of a member */
+  char dir[PATH_MAX];                            /* copy of the path to the description */
+  char *base;                                    /* directory of the description */
+  unsigned long unit;                            /* stripe unit (in clusters) */
+  uint64_t nblk, minBlk = UINT64_MAX;            /* number of blocks of a member / of the smallest one */
+  size_t len;                                    /* length of the current line */
+  int stat = 0;                                  /* status of operation */
+
+  nMembers = 0;
+  stripeBlocks = 0;
+  if ((f = fopen (devname, "r")) == NULL) return -errno;
+  if ((fgets (line, sizeof (line), f) == NULL) || (strncmp (line, STRIPE_TAG, strlen (STRIPE_TAG)) != 0))
+     { fclose (f);                               /* a single Linux file */
+       if (((stat = openMember (devname, flags, &minBlk)) == 0) && (minBlk > UINT32_MAX))
+          stat = -EFBIG;                         /* block numbers are 32-bit wide */
+       if (stat != 0)
+          { closeMembers ();
+            return stat;
+          }
+       memberBlocks = bnmax = (uint32_t) minBlk;
+       fd = member[0].fd;
+       return 0;
+     }
+
+  /* a stripe set */
+
+  if ((sscanf (line + strlen (STRIPE_TAG), "%lu", &unit) != 1) || (unit == 0) ||
+      (unit > UINT32_MAX / BLOCKS_PER_CLUSTER))
+     { fclose (f);
+       return -ELIBBAD;
+     }
+  stripeBlocks = (uint32_t) unit * BLOCKS_PER_CLUSTER;
+  strncpy (dir, devname, PATH_MAX - 1);
+  dir[PATH_MAX-1] = '\0';
+  base = dirname (dir);
+  while (fgets (line, sizeof (line), f) != NULL)
+  { len = strlen (line);
+    while ((len > 0) && ((line[len-1] == '\n') || (line[len-1] == '\r') || (line[len-1] == ' ')))
+      line[--len] = '\0';
+    if ((len == 0) || (line[0] == '#')) continue;
+    if (nMembers == MAX_MEMBERS)
+       { stat = -ELIBBAD;                        /* too many members */
+         break;
+       }
+    if (line[0] == '/')
+       strcpy (path, line);
+       else if (snprintf (path, PATH_MAX, "%s/%s", base, line) >= PATH_MAX)
+               { stat = -ENAMETOOLONG;
+                 break;
+               }
+    if ((stat = openMember (path, flags, &nblk)) != 0) break;
+    if (nblk < minBlk) minBlk = nblk;
+  }
+  fclose (f);
+  if ((stat == 0) && (nMembers < 2)) stat = -ELIBBAD;
+  if ((stat == 0) && (((minBlk / stripeBlocks) * stripeBlocks * nMembers) > UINT32_MAX))
+     stat = -EFBIG;                              /* block numbers are 32-bit wide */
+  if (stat != 0)
+     { closeMembers ();
+       return stat;
+     }
+  memberBlocks = (uint32_t) ((minBlk / stripeBlocks) * stripeBlocks);
+  bnmax = memberBlocks * nMembers;
+  fd = member[0].fd;
+
+  return 0;
+}
+
+/*
+ *  Open the Linux file of a member of the storage device and get its number of blocks.
+ */
+
+static int openMember (const char *path, int flags, uint64_t *p_nblk)
+{
+  struct member *p = &member[nMembers];          /* the member */
+  struct stat st;                                /* attributes of its Linux file */
+
+  if ((p->fd = open (path, flags)) == -1) return -errno;
+  p->map = NULL;
+  nMembers += 1;
+  if (fstat (p->fd, &st) == -1) return -errno;
+  if ((st.st_size % BLOCK_SIZE) != 0) return -ELIBBAD;
+  *p_nblk = st.st_size / BLOCK_SIZE;
+
+  return 0;
+}
+
+/*
+ *  Unmap and close the Linux files of the members of the storage device.
+ */
+
+static void closeMembers (void)
+{
+  uint32_t i;                                    /* counting variable */
+
+  for (i = 0; i < nMembers; i++)
+  { if (member[i].map != NULL)
+       munmap (member[i].map, (size_t) memberBlocks * BLOCK_SIZE);
+    member[i].map = NULL;
+    close (member[i].fd);
+    member[i].fd = -1;
+  }
+  nMembers = 0;
+  memberBlocks = 0;
+  stripeBlocks = 0;
+  bnmax = 0;
+  fd = -1;
+}
+
+/*
+ *  Locate a run of blocks of the storage device in its members.
+ *
+ *  The member holding the first block and the byte offset of this block in the member are stored. The number of blocks
+ *  of the run which follow on the same member, that is, up to the end of the stripe unit, is returned.
+ */
+
+static uint32_t locate (uint32_t n, uint32_t nblk, uint32_t *p_m, off_t *p_off)
+{
+  uint32_t unit, left;                           /* stripe unit holding the block / blocks left in it */
+
+  if (stripeBlocks == 0)
+     { *p_m = 0;
+       *p_off = OFFSET (n);
+       return nblk;
+     }
+  unit = n / stripeBlocks;
+  left = stripeBlocks - n % stripeBlocks;
+  *p_m = unit % nMembers;
+  *p_off = OFFSET ((uint64_t) (unit / nMembers) * stripeBlocks + n % stripeBlocks);
+
+  return (nblk < left) ? nblk : left;
+}
+
+/*
+ *  Transfer a run of contiguous blocks between a stripe set and a scatter / gather list.
+ *
+ *  The run is cut at the boundaries of the stripe units and the pieces are gathered member by member: since successive
+ *  stripe units of a member are contiguous in its Linux file, each member takes a single vectored transfer. The
+ *  transfers of the different members are carried out in parallel. The number of entries of the list must not exceed
+ *  MAX_IOV and their lengths must be multiple of the block size.
+ */
+
+static int stripeIO (uint32_t n, const struct iovec *iov, uint32_t iovcnt, bool isWrite)
+{
+  struct member *p;                              /* member of the current piece */
+  uint32_t i, m, piece;                          /* counting variable, member, blocks of the current piece */
+  size_t pos;                                    /* position of the current piece in the current entry */
+  off_t off;                                     /* byte offset of the current piece in the member */
+  int stat = 0;                                  /* status of operation */
+
+  for (m = 0; m < nMembers; m++)
+  { member[m].nIov = 0;
+    member[m].size = 0;
+    member[m].isWrite = isWrite;
+  }
+  for (i = 0; i < iovcnt; i++)
+    for (pos = 0; pos < iov[i].iov_len; pos += (size_t) piece * BLOCK_SIZE, n += piece)
+    { piece = locate (n, (iov[i].iov_len - pos) / BLOCK_SIZE, &m, &off);
+      p = &member[m];
+      if (p->nIov == MAX_IOV) return -EIO;       /* each entry yields, at most, one piece per member */
+      if (p->nIov == 0) p->off = off;
+      p->iov[p->nIov].iov_base = (unsigned char *) iov[i].iov_base + pos;
+      p->iov[p->nIov].iov_len = (size_t) piece * BLOCK_SIZE;
+      p->nIov += 1;
+      p->size += (ssize_t) piece * BLOCK_SIZE;
+    }
+  runJobs ();
+  for (m = 0; m < nMembers; m++)
+    if ((member[m].nIov != 0) && (member[m].done != member[m].size)) stat = -EIO;
+
+  return stat;
+}
+
+/*
+ *  Carry out the pending parts of a striped transfer.
+ *
+ *  If more than one member is involved, and the worker threads are running, the parts are handed to them and the
+ *  function waits for all to be carried out. Otherwise, they are carried out in turn.
+ */
+
+static void runJobs (void)
+{
+  uint32_t m, nJobs = 0;                         /* counting variable, number of parts */
+
+  for (m = 0; m < nMembers; m++)
+    if (member[m].nIov != 0) nJobs += 1;
+  if ((nJobs < 2) || (nWorkers == 0))
+     { for (m = 0; m < nMembers; m++)
+         if (member[m].nIov != 0) doJob (&member[m]);
+       return;
+     }
+  pthread_mutex_lock (&jobLock);
+  for (m = 0; m < nMembers; m++)
+    member[m].busy = (member[m].nIov != 0);
+  nPending = nJobs;
+  pthread_cond_broadcast (&jobGo);
+  while (nPending > 0)
+    pthread_cond_wait (&jobDone, &jobLock);
+  pthread_mutex_unlock (&jobLock);
+}
+
+/*
+ *  Carry out the pending part of a striped transfer on a member.
+ */
+
+static void doJob (struct member *p)
+{
+  if (p->isWrite)
+     p->done = pwritev (p->fd, p->iov, p->nIov, p->off);
+     else p->done = preadv (p->fd, p->iov, p->nIov, p->off);
+}
+
+/*
+ *  Life cycle of the worker thread of a member: wait for a part to be handed out, carry it out and signal it.
+ */
+
+static void *jobWorker (void *arg)
+{
+  struct member *p = arg;                        /* the member */
+
+  pthread_mutex_lock (&jobLock);
+  while (true)
+  { while (!p->busy && !workersQuit)
+      pthread_cond_wait (&jobGo, &jobLock);
+    if (!p->busy) break;                         /* time to terminate */
+    pthread_mutex_unlock (&jobLock);
+    doJob (p);
+    pthread_mutex_lock (&jobLock);
+    p->busy = false;
+    if (--nPending == 0) pthread_cond_signal (&jobDone);
+  }
+  pthread_mutex_unlock (&jobLock);
+
+  return NULL;
+}
+
+/*
+ *  Start a worker thread for each member of a stripe set.
+ *
+ *  If some of them can not be started, those already running are stopped and the parts of striped transfers are
+ *  carried out in turn.
+ */
+
+static void startWorkers (void)
+{
+  workersQuit = false;
+  for (nWorkers = 0; nWorkers < nMembers; nWorkers++)
+  { member[nWorkers].busy = false;
+    if (pthread_create (&member[nWorkers].worker, NULL, jobWorker, &member[nWorkers]) != 0)
+       { stopWorkers ();
+         return;
+       }
+  }
+}
+
+/*
+ *  Stop the worker threads.
+ */
+
+static void stopWorkers (void)
+{
+  uint32_t i;                                    /* counting variable */
+
+  pthread_mutex_lock (&jobLock);
+  workersQuit = true;
+  pthread_cond_broadcast (&jobGo);
+  pthread_mutex_unlock (&jobLock);
+  for (i = 0; i < nWorkers; i++)
+    pthread_join (member[i].worker, NULL);
+  nWorkers = 0;
+  workersQuit = false;
+}
+
+/*
+ *  Read the monotonic clock, in nanoseconds.
+ */
+
+static uint64_t clockNs (void)
+{
+  struct timespec ts;                            /* current instant */
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+
+  return (uint64_t) ts.tv_sec * 1000000000 + (uint64_t) ts.tv_nsec;
+}
+
+/*
+ *  Get the statistics of the kind of a transfer: a transfer larger than a block is a cluster (or run of clusters) one.
+ */
+
+static SORawKindStats *kindStats (size_t size, bool isWrite)
+{
+  return &stats.kind[((size > BLOCK_SIZE) ? RAW_CLUSTER_READ : RAW_BLOCK_READ) + (isWrite ? 1 : 0)];
+}
+
+/*
+ *  Account for a transfer of a given kind which took ns nanoseconds.
+ *
+ *  The latency bucket is the smallest k such that ns < 2^k.
+ */
+
+static void account (SORawKindStats *k, size_t size, uint64_t ns, int stat)
+{
+  uint32_t b = 0;                                /* latency bucket */
+
+  k->ops += 1;
+  if (stat != 0)
+     k->errors += 1;
+     else k->bytes += size;
+  k->totalNs += ns;
+  if (ns > k->maxNs) k->maxNs = ns;
+  while ((b < RAW_LAT_BUCKETS - 1) && ((ns >> b) != 0))
+    b++;
+  k->latency[b] += 1;
+}
+
+/*
+ *  Print a duration with a suitable unit.
+ */
+
+static void printNs (FILE *fp, double ns)
+{
+  if (ns < 1e3)
+     fprintf (fp, "%.0f ns", ns);
+     else if (ns < 1e6)
+             fprintf (fp, "%.1f us", ns / 1e3);
+             else if (ns < 1e9)
+                     fprintf (fp, "%.1f ms", ns / 1e6);
+                     else fprintf (fp, "%.2f s", ns / 1e9);
+}
+
+/*
+ *  Schedule a transfer on the simulated device and get the instant of its completion.
+ *
+ *  The transfer starts when the device becomes idle (or now, if it already is) and takes the fixed latency, plus
+ *  the seek from the block where the head rests, plus the transfer time proper.
+ */
+
+static uint64_t simulate (uint32_t n, size_t size)
+{
+  uint64_t start = clockNs ();                   /* instant when the transfer starts */
+  uint64_t cost;                                 /* duration of the transfer (in nanoseconds) */
+  uint32_t dist = (n > simHead) ? (n - simHead) : (simHead - n);    /* seek distance (in blocks) */
+
+  if (simIdleNs > start) start = simIdleNs;
+  cost = (uint64_t) sim.latencyUs * 1000 + (uint64_t) sim.seekNsPerBlock * dist;
+  if (sim.bandwidthMBs != 0)
+     cost += (uint64_t) size * 1000 / sim.bandwidthMBs;
+  simHead = n + (uint32_t) (size / BLOCK_SIZE);  /* the transfer lies within the device */
+  simIdleNs = start + cost;
+
+  return simIdleNs;
+}
+
+/*
+ *  Wait until a given instant of the monotonic clock.
+ */
+
+static void simWait (uint64_t until)
+{
+  struct timespec ts;                            /* instant to wait for */
+
+  ts.tv_sec = until / 1000000000;
+  ts.tv_nsec = until % 1000000000;
+  while (clock_nanosleep (CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+    ;
+}
@@ -7,10 +7,27 @@
  *  The following operations are defined:
  *    \li open a communication channel with the storage device
  *    \li close the communication channel previously established
+ *    \li force the data written so far to stable storage
  *    \li read a block of data from the storage device
  *    \li write a block of data to the storage device
  *    \li read a cluster of data from the storage device
- *    \li write a cluster of data to the storage device.
+ *    \li write a cluster of data to the storage device
+ *    \li read a run of contiguous clusters of data from the storage device
+ *    \li write a run of contiguous clusters of data to the storage device
+ *    \li read / write a run of contiguous blocks of data from / to the storage device
+ *    \li submit the reading / writing of a block or a cluster of data without waiting for it to be carried out
+ *    \li wait for all the submitted requests to be carried out
+ *    \li get direct access to a block or a cluster of data of a memory-mapped storage device
+ *    \li get, reset and print the transfer statistics of the storage device
+ *    \li set up the simulation of a slower storage device
+ *    \li parse the description of a simulated storage device
+ *    \li get the size of a storage device.
+ *
+ *  The storage device may also be a stripe set (RAID-0) of several Linux files, described in a small text file.
+ *  Data transfers are positional: they do not depend on, nor change, the file offset of the communication channel.
+ *  Byte offsets are 64-bit wide, so the device may have up to 2^32 blocks (2 TB with 512-byte blocks).
+ *  Every transfer is accounted for in a set of counters and latency histograms which are always kept, they are reset
+ *  when the device is opened.
  *
  *  \author Artur Carneiro Pereira - September 2007
  *  \author Miguel Oliveira e Silva - September 2009
@@ -25,6 +42,108 @@
 #define SOFS_RAWDISK_H_
 
 #include <stdint.h>
+#include <stdio.h>
+
+/* Durability modes of the storage device */
+
+/** \brief every write to the device reaches stable storage before returning (file opened with O_SYNC) */
+#define DEV_SYNC       0
+/** \brief written data reaches stable storage only at synchronization points (fdatasync) */
+#define DEV_DATASYNC   1
+/** \brief written data is never forced to stable storage (benchmarking only, unsafe on a crash) */
+#define DEV_UNSAFE     2
+/** \brief mask of the durability mode bits in the mode argument of soOpenDevice */
+#define DEV_DURABILITY 0x3
+
+/* Backends of the storage device */
+
+/** \brief transfers are carried out by pread / pwrite */
+#define DEV_PREAD      (0 << 2)
+/** \brief the whole device is mapped in main memory, transfers are memory copies and direct access is allowed */
+#define DEV_MMAP       (1 << 2)
+/** \brief mask of the backend bits in the mode argument of soOpenDevice */
+#define DEV_BACKEND    (0x3 << 2)
+
+/** \brief the host page cache is bypassed (O_DIRECT), unaligned buffers are served through a pool of aligned ones */
+#define DEV_DIRECT     (1 << 4)
+
+/* Transfer statistics of the storage device */
+
+/** \brief number of buckets of a latency histogram: bucket k counts the transfers which took less than 2^k
+ *         nanoseconds (and not less than 2^(k-1)), the last one collects all the longer ones */
+#define RAW_LAT_BUCKETS  32
+
+/** \brief kind of transfer: reading of blocks */
+#define RAW_BLOCK_READ     0
+/** \brief kind of transfer: writing of blocks */
+#define RAW_BLOCK_WRITE    1
+/** \brief kind of transfer: reading of clusters (or runs of clusters) */
+#define RAW_CLUSTER_READ   2
+/** \brief kind of transfer: writing of clusters (or runs of clusters) */
+#define RAW_CLUSTER_WRITE  3
+/** \brief number of kinds of transfers */
+#define RAW_KINDS          4
+
+/**
+ *  \brief Definition of the statistics of a kind of transfer.
+ *
+ *  A transfer is a single request to the backend: a block, a cluster or a chunk of a run of clusters. Its latency is
+ *  measured from the moment it is handed to the backend until its completion is known (on a simulated device, until
+ *  its simulated completion).
+ */
+
+typedef struct soRawKindStats
+{
+   /** \brief number of transfers */
+    uint64_t ops;
+   /** \brief number of transfers which failed */
+    uint64_t errors;
+   /** \brief number of bytes transferred */
+    uint64_t bytes;
+   /** \brief sum of the latencies (in nanoseconds) */
+    uint64_t totalNs;
+   /** \brief longest latency (in nanoseconds) */
+    uint64_t maxNs;
+   /** \brief number of transfers which were submitted, instead of carried out at once */
+    uint64_t submitted;
+   /** \brief histogram of the latencies, in powers of 2 of nanoseconds */
+    uint64_t latency[RAW_LAT_BUCKETS];
+} SORawKindStats;
+
+/**
+ *  \brief Definition of the transfer statistics of the storage device.
+ */
+
+typedef struct soRawStats
+{
+   /** \brief statistics of each kind of transfer (indexed by \c RAW_BLOCK_READ ... \c RAW_CLUSTER_WRITE) */
+    SORawKindStats kind[RAW_KINDS];
+   /** \brief number of synchronizations which forced data to stable storage */
+    uint64_t syncs;
+   /** \brief sum of the durations of those synchronizations (in nanoseconds) */
+    uint64_t syncNs;
+} SORawStats;
+
+/**
+ *  \brief Definition of the parameters of a simulated storage device.
+ *
+ *  The transfers are carried out on the supporting file, as usual, but each one is only deemed complete after the
+ *  time it would take on a device with the given characteristics. The device serves one transfer at a time, so
+ *  submitted requests queue up behind each other. The caller waits for a transfer carried out at once until it is
+ *  complete, but for submitted requests only in \e soWaitRawIO: their simulated time overlaps with the caller's work
+ *  in between. Parameters set to zero do not add any cost; if all of them are zero, no simulation takes place.
+ */
+
+typedef struct soRawSimulation
+{
+   /** \brief fixed cost of a transfer (in microseconds): command overhead, rotational delay, network round trip */
+    uint32_t latencyUs;
+   /** \brief transfer rate (in MB/s, 10^6 bytes per second) */
+    uint32_t bandwidthMBs;
+   /** \brief cost of moving the head by one block (in nanoseconds), proportional to the distance between the block
+    *         where the previous transfer ended and the one where the present transfer starts */
+    uint32_t seekNsPerBlock;
+} SORawSimulation;
 
 /**
  *  \brief Open the storage device.
@@ -32,30 +151,68 @@
  *  A communication channel is established with the storage device.
  *  It is supposed that no communication channel was previously established.
  *  The Linux file that simulates the storage device must exist and have a size multiple of the block size.
+ *  It may instead describe a stripe set (RAID-0), in text form: the first line is <tt>SOFS11-STRIPE unit</tt>, where
+ *  \e unit is the stripe unit in clusters, and each of the following lines names the Linux file of a member (relative
+ *  paths are taken from the directory of the description; empty lines and lines starting with '#' are skipped).
+ *  There must be between 2 and 16 members. Successive stripe units of the device are laid out on successive members,
+ *  round-robin, and each member contributes as many whole stripe units as the smallest of them holds. The parts of a
+ *  transfer which fall on different members are carried out in parallel.
+ *  The durability mode states when written data is forced to stable storage:
+ *    \li \c DEV_SYNC: every write operation on the device (the file is opened with \c O_SYNC); data written through
+ *        the buffercache, which is write-back, only reaches the device, and stable storage, when the buffercache
+ *        writes it back
+ *    \li \c DEV_DATASYNC: only at synchronization points (\e soSyncDevice and \e soCloseDevice)
+ *    \li \c DEV_UNSAFE: never, it is left to the host operating system (benchmarking only).
+ *  The backend states how transfers are carried out: \c DEV_PREAD uses positional system calls, \c DEV_MMAP maps the
+ *  whole device in main memory, so that every transfer becomes a memory copy and read-only consumers may access the
+ *  device contents in place.
+ *  Finally, with \c DEV_DIRECT, the host page cache is bypassed: main memory buffers which are not suitably aligned
+ *  are served through a pool of aligned buffers. It can not be combined with \c DEV_MMAP.
+ *  The transfer statistics are reset.
  *
  *  \param devname absolute path to the Linux file that simulates the storage device
+ *  \param mode operating mode of the storage device (durability mode | backend [| \c DEV_DIRECT])
  *  \param p_bnmax pointer to a location where the number of blocks of the device is to be stored
  *
  *  \return <tt>0 (zero)</tt>, on success
- *  \return -\c EINVAL, if \e devname or \e p_bnmax are \c NULL
+ *  \return -\c EINVAL, if \e devname or \e p_bnmax are \c NULL or the operating mode is invalid
  *  \return -\c EBUSY, if the device is already opened
- *  \return -\c ELIBBAD, if the supporting file size is invalid
- *  \return -<em>other specific error</em> issued by \e lseek system call
+ *  \return -\c ELIBBAD, if the supporting file size is invalid or the description of a stripe set is malformed
+ *  \return -\c EFBIG, if the device has more than 2^32 blocks or, for \c DEV_MMAP, does not fit in the address space
+ *  \return -\c ENOMEM, if the pool of aligned buffers can not be allocated
+ *  \return -<em>other specific error</em> issued by \e open, \e fstat or \e mmap system calls
  */
 
-extern int soOpenDevice (const char *devname, uint32_t *p_bnmax);
+extern int soOpenDevice (const char *devname, uint32_t mode, uint32_t *p_bnmax);
 
 /**
  *  \brief Close the storage device.
  *
  *  The communication channel previously established with the storage device is closed.
+ *  Any submitted request is waited for and, in \c DEV_DATASYNC mode, the data written so far is forced to stable
+ *  storage before.
  *
  *  \return <tt>0 (zero)</tt>, on success
  *  \return -\c EBADF, if the device is not opened
+ *  \return -\c EIO, if a submitted request failed or it fails on synchronizing
  */
 
 extern int soCloseDevice (void);
 
+/**
+ *  \brief Synchronize the storage device.
+ *
+ *  Any submitted request is waited for first. Then, the data written so far to the storage device is forced to stable
+ *  storage, if the durability mode so requires. This is only effective in \c DEV_DATASYNC mode (\e fdatasync or,
+ *  for a memory-mapped device, \e msync).
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EBADF, if the device is not opened
+ *  \return -\c EIO, if a submitted request failed or it fails on synchronizing
+ */
+
+extern int soSyncDevice (void);
+
 /**
  *  \brief Read a block of data from the storage device.
  *
@@ -70,7 +227,6 @@ extern int soCloseDevice (void);
  *  \return -\c EINVAL, if the <em>buffer pointer</em> is \c NULL or the <em>block number</em> is out of range
  *  \return -\c EBADF, if the device is not already opened
  *  \return -\c EIO, if it fails on reading
- *  \return -<em>other specific error</em> issued by \e lseek system call
  */
 
 extern int soReadRawBlock (uint32_t n, void *buf);
@@ -89,7 +245,6 @@ extern int soReadRawBlock (uint32_t n, void *buf);
  *  \return -\c EINVAL, if <em>buffer pointer</em> is \c NULL or <em>block number</em> is out of range
  *  \return -\c EBADF, if the device is not already opened
  *  \return -\c EIO, if it fails on writing
- *  \return -<em>other specific error</em> issued by \e lseek system call
  */
 
 extern int soWriteRawBlock (uint32_t n, void *buf);
@@ -108,7 +263,6 @@ extern int soWriteRawBlock (uint32_t n, void *buf);
  *  \return -\c EINVAL, if the <em>buffer pointer</em> is \c NULL or the <em>block number</em> is out of range
  *  \return -\c EBADF, if the device is not already opened
  *  \return -\c EIO, if it fails on reading
- *  \return -<em>other specific error</em> issued by \e lseek system call
  */
 
 extern int soReadRawCluster (uint32_t n, void *buf);
@@ -127,9 +281,297 @@ extern int soReadRawCluster (uint32_t n, void *buf);
  *  \return -\c EINVAL, if <em>buffer pointer</em> is \c NULL or <em>block number</em> is out of range
  *  \return -\c EBADF, if the device is not already opened
  *  \return -\c EIO, if it fails on writing
- *  \return -<em>other specific error</em> issued by \e lseek system call
  */
 
 extern int soWriteRawCluster (uint32_t n, void *buf);
 
+/**
+ *  \brief Read a run of contiguous clusters of data from the storage device.
+ *
+ *  The device is organized as a linear array of data blocks. A cluster is a group of successive blocks.
+ *  The physical number of the first block of the first data cluster to be read, the number of successive clusters and
+ *  an array of pointers to previously allocated buffers, one per cluster, are supplied as arguments. The buffers need
+ *  not be contiguous in main memory: the whole run is transferred by a single vectored read.
+ *
+ *  \param n physical number of the first block of the first data cluster to be read from
+ *  \param count number of successive clusters to be read
+ *  \param bufs array of pointers to the buffers where the data of each cluster must be read into
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the <em>buffer array pointer</em> or any of the <em>buffer pointers</em> is \c NULL, the
+ *                      <em>number of clusters</em> is zero or the run is out of range or too large to be transferred
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on reading
+ */
+
+extern int soReadRawClusters (uint32_t n, uint32_t count, void *bufs[]);
+
+/**
+ *  \brief Write a run of contiguous clusters of data to the storage device.
+ *
+ *  The device is organized as a linear array of data blocks. A cluster is a group of successive blocks.
+ *  The physical number of the first block of the first data cluster to be written, the number of successive clusters
+ *  and an array of pointers to previously allocated buffers, one per cluster, are supplied as arguments. The buffers
+ *  need not be contiguous in main memory: the whole run is transferred by a single vectored write.
+ *
+ *  \param n physical number of the first block of the first data cluster to be written into
+ *  \param count number of successive clusters to be written
+ *  \param bufs array of pointers to the buffers containing the data of each cluster to be written from
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the <em>buffer array pointer</em> or any of the <em>buffer pointers</em> is \c NULL, the
+ *                      <em>number of clusters</em> is zero or the run is out of range or too large to be transferred
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on writing
+ */
+
+extern int soWriteRawClusters (uint32_t n, uint32_t count, void *bufs[]);
+
+/**
+ *  \brief Read a run of contiguous blocks of data from the storage device.
+ *
+ *  The device is organized as a linear array of data blocks.
+ *  The physical number of the first block to be read, the number of successive blocks and an array of pointers to
+ *  previously allocated buffers, one per block, are supplied as arguments. The buffers need not be contiguous in main
+ *  memory, those which are adjacent are taken as a whole: the whole run is transferred by a single vectored read.
+ *
+ *  \param n physical number of the first block to be read from
+ *  \param count number of successive blocks to be read
+ *  \param bufs array of pointers to the buffers where the data of each block must be read into
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the <em>buffer array pointer</em> or any of the <em>buffer pointers</em> is \c NULL, the
+ *                      <em>number of blocks</em> is zero or the run is out of range or too large to be transferred
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on reading
+ */
+
+extern int soReadRawBlocks (uint32_t n, uint32_t count, void *bufs[]);
+
+/**
+ *  \brief Write a run of contiguous blocks of data to the storage device.
+ *
+ *  The device is organized as a linear array of data blocks.
+ *  The physical number of the first block to be written, the number of successive blocks and an array of pointers to
+ *  previously allocated buffers, one per block, are supplied as arguments. The buffers need not be contiguous in main
+ *  memory, those which are adjacent are taken as a whole: the whole run is transferred by a single vectored write.
+ *
+ *  \param n physical number of the first block to be written into
+ *  \param count number of successive blocks to be written
+ *  \param bufs array of pointers to the buffers containing the data of each block to be written from
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the <em>buffer array pointer</em> or any of the <em>buffer pointers</em> is \c NULL, the
+ *                      <em>number of blocks</em> is zero or the run is out of range or too large to be transferred
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on writing
+ */
+
+extern int soWriteRawBlocks (uint32_t n, uint32_t count, void *bufs[]);
+
+/**
+ *  \brief Submit the reading of a block of data from the storage device.
+ *
+ *  The request is handed to the device backend, which presently carries it out at once, and any failure is only
+ *  reported when waiting for it. On a simulated device, its completion is only waited for then as well.
+ *  The buffer must not be accessed before \e soWaitRawIO is called. Submitted requests are not ordered among
+ *  themselves, nor with respect to the other operations, so the same block must not be referred to twice before
+ *  waiting.
+ *
+ *  \param n physical number of the data block to be read from
+ *  \param buf pointer to the buffer where the data must be read into
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the <em>buffer pointer</em> is \c NULL or the <em>block number</em> is out of range
+ *  \return -\c EBADF, if the device is not already opened
+ */
+
+extern int soSubmitReadRawBlock (uint32_t n, void *buf);
+
+/**
+ *  \brief Submit the writing of a block of data to the storage device.
+ *
+ *  The request is handed to the device backend, which presently carries it out at once, and any failure is only
+ *  reported when waiting for it. On a simulated device, its completion is only waited for then as well.
+ *  The buffer must not be changed before \e soWaitRawIO is called.
+ *
+ *  \param n physical number of the block to be written into
+ *  \param buf pointer to the buffer containing the data to be written from
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if <em>buffer pointer</em> is \c NULL or <em>block number</em> is out of range
+ *  \return -\c EBADF, if the device is not already opened
+ */
+
+extern int soSubmitWriteRawBlock (uint32_t n, void *buf);
+
+/**
+ *  \brief Submit the reading of a cluster of data from the storage device.
+ *
+ *  The request is handed to the device backend, which presently carries it out at once, and any failure is only
+ *  reported when waiting for it. On a simulated device, its completion is only waited for then as well.
+ *  The buffer must not be accessed before \e soWaitRawIO is called.
+ *
+ *  \param n physical number of the first block of the data cluster to be read from
+ *  \param buf pointer to the buffer where the data must be read into
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the <em>buffer pointer</em> is \c NULL or the <em>block number</em> is out of range
+ *  \return -\c EBADF, if the device is not already opened
+ */
+
+extern int soSubmitReadRawCluster (uint32_t n, void *buf);
+
+/**
+ *  \brief Submit the writing of a cluster of data to the storage device.
+ *
+ *  The request is handed to the device backend, which presently carries it out at once, and any failure is only
+ *  reported when waiting for it. On a simulated device, its completion is only waited for then as well.
+ *  The buffer must not be changed before \e soWaitRawIO is called.
+ *
+ *  \param n physical number of the first block of the data cluster to be written into
+ *  \param buf pointer to the buffer containing the data to be written from
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if <em>buffer pointer</em> is \c NULL or <em>block number</em> is out of range
+ *  \return -\c EBADF, if the device is not already opened
+ */
+
+extern int soSubmitWriteRawCluster (uint32_t n, void *buf);
+
+/**
+ *  \brief Wait for all the submitted requests to be carried out.
+ *
+ *  On a simulated device, it waits until the last of them is complete.
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if any of the requests submitted since the last wait failed
+ */
+
+extern int soWaitRawIO (void);
+
+/**
+ *  \brief Get direct access to a block of data of the storage device.
+ *
+ *  It is only available with the \c DEV_MMAP backend: a pointer to the block contents inside the mapping of the
+ *  device is handed out, so that no transfer takes place. The contents must only be read, and the pointer is no longer
+ *  valid after the device is closed. Consumers should fall back to \e soReadRawBlock, if -\c EOPNOTSUPP is returned.
+ *
+ *  \param n physical number of the data block to be accessed
+ *  \param p_buf pointer to a location where the pointer to the block contents is to be stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the <em>pointer</em> is \c NULL or the <em>block number</em> is out of range
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EOPNOTSUPP, if the device is not memory-mapped
+ */
+
+extern int soPeekRawBlock (uint32_t n, const void **p_buf);
+
+/**
+ *  \brief Get direct access to a cluster of data of the storage device.
+ *
+ *  It is only available with the \c DEV_MMAP backend: a pointer to the cluster contents inside the mapping of the
+ *  device is handed out, so that no transfer takes place. The contents must only be read, and the pointer is no longer
+ *  valid after the device is closed. Consumers should fall back to \e soReadRawCluster, if -\c EOPNOTSUPP is
+ *  returned. On a stripe set, a cluster which straddles two members is not contiguous in main memory and can not be
+ *  accessed in place either.
+ *
+ *  \param n physical number of the first block of the data cluster to be accessed
+ *  \param p_buf pointer to a location where the pointer to the cluster contents is to be stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the <em>pointer</em> is \c NULL or the <em>block number</em> is out of range
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EOPNOTSUPP, if the device is not memory-mapped or the cluster straddles two members of a stripe set
+ */
+
+extern int soPeekRawCluster (uint32_t n, const void **p_buf);
+
+/**
+ *  \brief Get a snapshot of the transfer statistics of the storage device.
+ *
+ *  They are kept since the device was last opened or the statistics were last reset, and survive the closing of the
+ *  device.
+ *
+ *  \param p_stats pointer to a location where the statistics are to be stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the <em>pointer</em> is \c NULL
+ */
+
+extern int soGetRawStats (SORawStats *p_stats);
+
+/**
+ *  \brief Reset the transfer statistics of the storage device.
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ */
+
+extern int soResetRawStats (void);
+
+/**
+ *  \brief Print the transfer statistics of the storage device.
+ *
+ *  For each kind of transfer with some activity, the counters, the mean and the maximum latency, the throughput while
+ *  busy and the non-empty buckets of the latency histogram are printed.
+ *
+ *  \param fp stream where the statistics are to be printed
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the <em>stream</em> is \c NULL
+ */
+
+extern int soPrintRawStats (FILE *fp);
+
+/**
+ *  \brief Set up the simulation of a slower storage device.
+ *
+ *  The parameters take effect at once and are kept across the opening and closing of the device; the head is parked
+ *  at block 0 whenever the device is opened.
+ *
+ *  \param p_sim pointer to the parameters of the simulated device (\c NULL turns the simulation off)
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ */
+
+extern int soSetRawSimulation (const SORawSimulation *p_sim);
+
+/**
+ *  \brief Parse the description of a simulated storage device.
+ *
+ *  The description has the format <em>latency:bandwidth:seek</em>, in microseconds, MB/s and nanoseconds per block,
+ *  respectively. Trailing fields may be omitted and empty fields are taken as zero: for instance, "8000:120:50"
+ *  resembles a spinning disk and "500::" a network volume with a fixed round trip.
+ *
+ *  \param spec description of the simulated device
+ *  \param p_sim pointer to a location where the parameters are to be stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if any of the <em>pointers</em> is \c NULL or the description is malformed
+ */
+
+extern int soParseRawSimulation (const char *spec, SORawSimulation *p_sim);
+
+/**
+ *  \brief Get the size of a storage device.
+ *
+ *  The Linux file that simulates the storage device, or the files of the members of a stripe set, are checked just
+ *  like on opening the device (see \e soOpenDevice) and the number of blocks of the device is computed. It is meant
+ *  for tools which have to know the size of the device before opening it, so the device must not be opened.
+ *
+ *  \param devname path to the Linux file that simulates the storage device
+ *  \param p_nblocks pointer to a location where the number of blocks of the device is to be stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if any of the <em>pointers</em> is \c NULL
+ *  \return -\c EBUSY, if the device is opened
+ *  \return -\c ELIBBAD, if the supporting file size is invalid or the description of a stripe set is malformed
+ *  \return -\c EFBIG, if the device has more than 2^32 blocks
+ *  \return -<em>other specific error</em> issued by \e open or \e fstat system calls
+ */
+
+extern int soGetDeviceSize (const char *devname, uint32_t *p_nblocks);
+
 #endif /* SOFS_RAWDISK_H_ */
@@ -171,38 +171,48 @@ int main (int argc, char *argv[])
   /* check for storage device conformity */
 
   char *devname;                                 /* path to the storage device in the Linux file system */
-  struct stat st;                                /* file attributes */
+  uint32_t nblocks;                              /* number of blocks of the storage device */
+  int stat;                                      /* status of operation */
 
-  devname = argv[optind];
-  if (stat (devname, &st) == -1)                 /* get file attributes */
-     { printError (-errno, basename (argv[0]));
+  devname = argv[optind];                        /* the storage device must have a size in bytes multiple of block
+                                                    size (or be a well formed stripe set) */
+  if ((stat = soGetDeviceSize (devname, &nblocks)) == -ELIBBAD)
+     { fprintf (stderr, "%s: Bad size of support file.\n", basename (argv[0]));
        return EXIT_FAILURE;
      }
-  if (st.st_size % BLOCK_SIZE != 0)              /* check file size: the storage device must have a size in bytes
-                                                    multiple of block size */
-     { fprintf (stderr, "%s: Bad size of support file.\n", basename (argv[0]));
+  if (stat != 0)
+     { printError (stat, basename (argv[0]));
        return EXIT_FAILURE;
      }
 
   /* display of the storage device blocks/clusters is going to start */
 
   unsigned char buffer[CLUSTER_SIZE];            /* buffer to store block/cluster contents */
+  const void *data = buffer;                     /* pointer to the block/cluster contents */
   int status;                                    /* status of operation */
 
-  /* open a direct communication channel with the storage device */
+  /* open a direct communication channel with the storage device, which is mapped in main memory, so that the
+   * block/cluster contents may be accessed in place
+   */
 
   uint32_t dummy;                                /* dummy variable */
 
-  if ((status = soOpenDevice (argv[optind], &dummy)) != 0)
+  if ((status = soOpenDevice (argv[optind], DEV_SYNC | DEV_MMAP, &dummy)) != 0)
      { printError (status, basename (argv[0]));
        return EXIT_FAILURE;
      }
 
-  /* read block/cluster */
+  /* access block/cluster: if it can not be done in place, it is read */
 
   if (isCluster)
-     status = soReadRawCluster (unitNumber, buffer);
-     else status = soReadRawBlock (unitNumber, buffer);
+     status = soPeekRawCluster (unitNumber, &data);
+     else status = soPeekRawBlock (unitNumber, &data);
+  if (status == -EOPNOTSUPP)
+     { data = buffer;
+       if (isCluster)
+          status = soReadRawCluster (unitNumber, buffer);
+          else status = soReadRawBlock (unitNumber, buffer);
+     }
   if (status == -EINVAL)
      { fprintf (stderr, "%s: Unit number too large.\n", basename (argv[0]));
        return EXIT_FAILURE;
@@ -219,13 +229,13 @@ int main (int argc, char *argv[])
           printf ("Cluster ");
           else printf ("Block ");
        printf ("%"PRIu32" %s\n", unitNumber, msg);
-       print1 (buffer);
+       print1 ((void *) data);
      }
      else { if (isCluster)
                printf ("Cluster ");
                else printf ("Block ");
             printf ("%"PRIu32" %s\n", unitNumber, msg);
-            print2 (buffer, isCluster);
+            print2 ((void *) data, isCluster);
           }
 
   /* close the communication channel with the storage device */
@@ -9,12 +9,19 @@
  *      \li load the contents of the superblock into internal storage
  *      \li get a pointer to the contents of the superblock
  *      \li store the contents of the superblock resident in internal storage to the storage device
+ *      \li write the contents of the superblock resident in internal storage to the storage device, if they were
+ *          changed
+ *      \li get the number of store operations on the superblock and of writes of the superblock
  *      \li convert the inode number, which translates to an entry of the inode table, into the logical number (the
  *          ordinal, starting at zero, of the succession blocks that the table of inodes comprises) and the offset of
  *          the block where it is stored
  *      \li load the contents of a specific block of the table of inodes into internal storage
  *      \li get a pointer to the contents of a specific block of the table of inodes
  *      \li store the contents of the block of the table of inodes resident in internal storage to the storage device
+ *      \li acquire, get a pointer to, store and release one of several blocks of the table of inodes kept in internal
+ *          storage at the same time, through a handle
+ *      \li acquire, get a pointer to, store, check the consistency record of and release an in-core inode, through a
+ *          handle, and write back all the in-core inodes changed
  *      \li convert a byte position in the data continuum (information content) of a file, into the index of the element
  *          of the list of direct references and the offset within it where it is stored
  *      \li load the contents of a specific cluster of the table of single indirect references to data clusters into
@@ -27,14 +34,18 @@
  *          storage
  *      \li get a pointer to the contents of a specific cluster of the table of direct references to data clusters
  *      \li store the contents of a specific cluster of the table of direct references to data clusters resident in
- *          internal storage to the storage device.
+ *          internal storage to the storage device
+ *      \li set and get the consistency-check level, tell if a consistency check is to be carried out, account for
+ *          the CPU time it takes and get the number of checks carried out and the CPU time taken by them.
  *
  *  \author António Rui Borges - August 2010 - August 2011
  */
 
 #include <stdio.h>
+#include <string.h>
 #include <errno.h>
 #include <inttypes.h>
+#include <time.h>
 
 #include "sofs_probe.h"
 #include "sofs_const.h"
@@ -43,6 +54,7 @@
 #include "sofs_inode.h"
 #include "sofs_datacluster.h"
 #include "sofs_direntry.h"
+#include "sofs_basicoper.h"
 
 /*
  *  Internal data structure
@@ -57,9 +69,50 @@ static SOSuperBlock sb;
 static int sbLoaded = 0;
 /** \brief status of reading or writing superblock data */
 static int sbError = 0;
+/** \brief superblock data changed since it was last written: 0 - no, 1 - yes */
+static int sbDirty = 0;
+/** \brief file system mounted by this process (superblock writes are deferred): 0 - no, 1 - yes */
+static int fsMounted = 0;
+/** \brief number of store operations on the superblock */
+static uint64_t sbStores = 0;
+/** \brief number of writes of the superblock */
+static uint64_t sbWrites = 0;
+
+/** \brief slot of the set of blocks of the table of inodes kept in internal storage */
+typedef struct
+{ uint32_t nBlk;                                 /* logical number of the block held in the slot */
+  uint32_t refs;                                 /* number of handles to the slot currently held */
+  uint64_t used;                                 /* time of last acquisition, for replacement */
+  SOInode *inode;                                /* pointer to the block, pinned in the buffercache (NULL, if the
+                                                    slot is free) */
+} SOSlotInT;
+
+/** \brief set of blocks of the table of inodes kept in internal storage */
+static SOSlotInT slotInT[INT_SLOTS];
+/** \brief clock of acquisitions of blocks of the table of inodes */
+static uint64_t tickInT = 0;
+/** \brief handle to the block of the table of inodes loaded through the single block interface */
+static uint32_t hdlInT = 0;
+/** \brief in-core inode */
+typedef struct
+{ uint32_t nInode;                               /* number of the inode (NULL_INODE, if the entry is free) */
+  uint32_t refs;                                 /* number of handles to the entry currently held */
+  uint64_t used;                                 /* time of last acquisition, for replacement */
+  uint32_t checked;                              /* inode status it was found consistent as, plus one (0, if it was
+                                                    not checked since it was last changed) */
+  uint32_t dirty;                                /* changed since it was last written back: 0 - no, 1 - yes */
+  SOInode inode;                                 /* contents of the inode */
+} SOInodeInC;
+
+/** \brief set of in-core inodes */
+static SOInodeInC inodeInC[IC_SLOTS];
+/** \brief the set of in-core inodes was initialized: 0 - no, 1 - yes */
+static int icInit = 0;
+/** \brief clock of acquisitions of in-core inodes */
+static uint64_t tickInC = 0;
+/** \brief number of in-core inodes changed since they were last written back */
+static uint32_t icDirty = 0;
 
-/** \brief storage area for one block of the table of inodes */
-static SOInode inode[IPB];
 /** \brief validation area: -2 - an error occurred while reading or writing a data block
  *                          -1 - no block of the table of inodes has been read yet
  *                           * - logical block number of table of inodes that has been read
@@ -68,27 +121,70 @@ static int nBlkInTLoaded = -1;
 /** \brief status of reading or writing a data block of the table of inodes */
 static int intError = 0;
 
-/** \brief storage area for a cluster of single indirect references to data clusters */
-static SODataClust sngIndRefClust;
+/** \brief slot of the set of clusters of references to data clusters kept in internal storage */
+typedef struct
+{ uint32_t nClust;                               /* physical number of the cluster held in the slot */
+  uint32_t refs;                                 /* number of users of the slot */
+  uint64_t used;                                 /* time of last acquisition, for replacement */
+  SODataClust *clust;                            /* pointer to the cluster, pinned in the buffercache (NULL, if the
+                                                    slot is free) */
+} SOSlotRef;
+
+/** \brief set of clusters of references to data clusters (single indirect and direct) kept in internal storage */
+static SOSlotRef slotRef[REF_SLOTS];
+/** \brief clock of acquisitions of clusters of references to data clusters */
+static uint64_t tickRef = 0;
+/** \brief the buffercache was told how to release the idle pins kept in internal storage: 0 - no, 1 - yes */
+static int reclaimSet = 0;
+
+/** \brief pointer to a cluster of single indirect references to data clusters, pinned in the buffercache */
+static SODataClust *sngIndRefClust = NULL;
+/** \brief slot holding the cluster of single indirect references to data clusters */
+static uint32_t hdlSIRef = 0;
 /** \brief validation area: -2 - an error occurred while reading or writing a data cluster
  *                          -1 - no cluster of single indirect references to data clusters has been read yet
  *                           * - physical cluster number of single indirect references to data clusters that has been
  *                               read
  */
-static int nClustSIRef = 0;
+static int nClustSIRef = -1;
 /** \brief status of reading or writing a cluster of single indirect references to data clusters */
 static int sircError = 0;
 
-/** \brief storage area for a cluster of direct references to data clusters */
-static SODataClust dirRefClust;
+/** \brief pointer to a cluster of direct references to data clusters, pinned in the buffercache */
+static SODataClust *dirRefClust = NULL;
+/** \brief slot holding the cluster of direct references to data clusters */
+static uint32_t hdlDRef = 0;
 /** \brief validation area: -2 - an error occurred while reading or writing a data cluster
  *                          -1 - no cluster of direct references to data clusters has been read yet
  *                           * - physical cluster number of direct references to data clusters that has been read
  */
-static int nClustDRef = 0;
+static int nClustDRef = -1;
 /** \brief status of reading or writing a cluster of direct references to data clusters */
 static int drcError = 0;
 
+/** \brief consistency-check level */
+static uint32_t checkLevel = CHECK_PARANOID;
+/** \brief number of consistency checks carried out */
+static uint64_t nChecks = 0;
+/** \brief CPU time taken by the consistency checks carried out, in nanoseconds */
+static uint64_t checkNs = 0;
+/** \brief CPU time at the start of the consistency check being carried out, in nanoseconds */
+static uint64_t checkStart = 0;
+
+/*
+ *  Allusion to internal functions
+ */
+
+static int writeSuperBlock (void);
+static int mounted (void);
+static int flushInodes (uint32_t n);
+static void refreshInodes (uint32_t n);
+static int blockHeld (uint32_t nBlk);
+static int writeBackInode (uint32_t nInode);
+static int pinRefClust (uint32_t nClust, uint32_t *p_n);
+static int releaseIdlePins (void);
+static uint64_t cpuNs (void);
+
 /**
  *  \brief Load the contents of the superblock into internal storage.
  *
@@ -112,7 +208,9 @@ int soLoadSuperBlock (void)
   if (sbLoaded == 1) return 0;                   /* superblock has already been read */
   stat = soReadCacheBlock (0, &sb);
   if (stat == 0)
-     sbLoaded = 1;                               /* operation carried out with success */
+     { sbLoaded = 1;                             /* operation carried out with success */
+       soSetBufferCacheRegions (sb.itable_start, sb.dzone_start);    /* ignored, if the superblock is not formatted */
+     }
      else { sbLoaded = -1;
             sbError = stat;                      /* an error has occurred while reading */
           }
@@ -142,6 +240,10 @@ SOSuperBlock *soGetSuperBlock (void)
 /**
  *  \brief Store the contents of the superblock resident in internal storage to the storage device.
  *
+ *  While the file system is mounted by this process (see \c soSetMounted), the superblock is only marked changed and
+ *  is written on the next sync point (see \c soSyncSuperBlock), since the flag signaling if it was properly unmounted
+ *  is then \c NPRU in the storage device and a crash is detected anyway. Otherwise, it is written at once, after the
+ *  in-core inodes changed in the meantime (see \c soSyncInodes).
  *  Any type of previous / current error on loading / storing the superblock data will disable the operation.
  *
  *  \return <tt>0 (zero)</tt>, on success
@@ -164,11 +266,111 @@ int soStoreSuperBlock (void)
        sbError = -ELIBBAD;                       /* superblock has not been read yet */
        return sbError;
      }
+  sbStores += 1;
+  if (mounted ())
+     { sbDirty = 1;                              /* writing is deferred */
+       return 0;
+     }
+  if ((stat = soSyncInodes ()) != 0)             /* in-core inodes changed while mounted are written back first */
+     return stat;
+
+  return writeSuperBlock ();
+}
+
+/**
+ *  \brief Write the contents of the superblock resident in internal storage to the storage device, if they were
+ *         changed since they were last written.
+ *
+ *  It is called on the sync points: the synchronization of a file and a periodic timer while the file system is
+ *  mounted (unmounting it writes the superblock anyway, since the flag signaling if it was properly unmounted is
+ *  changed).
+ *  Any type of previous / current error on loading / storing the superblock data will disable the operation.
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on writing
+ *  \return -\c ELIBBAD, if the buffercache is inconsistent
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+int soSyncSuperBlock (void)
+{
+  soColorProbe (529, "07;31", "soSyncSuperBlock ()\n");
+
+  if (sbError != 0) return sbError;              /* a previous error has occurred */
+  if ((sbLoaded != 1) || (sbDirty == 0)) return 0;
+
+  return writeSuperBlock ();
+}
+
+/**
+ *  \brief Set whether the file system is mounted by this process.
+ *
+ *  It is set after mounting has marked the file system as not properly unmounted in the storage device, and cleared
+ *  before unmounting marks it back: only in between are the writes of the superblock and of the in-core inodes
+ *  deferred. Clearing it writes the pending changes of both.
+ *
+ *  \param status mounted: 0 - no, 1 - yes
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the status is invalid
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on writing
+ *  \return -\c ELIBBAD, if the buffercache is inconsistent
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+int soSetMounted (uint32_t status)
+{
+  soColorProbe (543, "07;31", "soSetMounted (%"PRIu32")\n", status);
+
+  int stat;                                      /* status of operation */
+
+  if (status > 1) return -EINVAL;
+  fsMounted = (int) status;
+  if (status == 1) return 0;
+  if ((stat = soSyncInodes ()) != 0) return stat;
+
+  return soSyncSuperBlock ();
+}
+
+/**
+ *  \brief Get the number of store operations on the superblock and of writes of the superblock.
+ *
+ *  \param p_stores pointer to the location where the number of store operations is to be stored
+ *  \param p_writes pointer to the location where the number of writes is to be stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if any of the pointers is \c NULL
+ */
+
+int soGetSuperBlockStats (uint64_t *p_stores, uint64_t *p_writes)
+{
+  soColorProbe (530, "07;31", "soGetSuperBlockStats (%p, %p)\n", p_stores, p_writes);
+
+  if ((p_stores == NULL) || (p_writes == NULL)) return -EINVAL;
+  *p_stores = sbStores;
+  *p_writes = sbWrites;
+
+  return 0;
+}
+
+/*
+ *  Write the superblock to the storage device.
+ */
+
+static int writeSuperBlock (void)
+{
+  int stat;                                      /* status of operation */
+
   stat = soWriteCacheBlock (0, &sb);
-  if (stat != 0)
-     { sbLoaded = -1;
-       sbError = stat;                           /* an error has occurred while writing */
+  if (stat == 0)
+     { sbDirty = 0;
+       sbWrites += 1;
      }
+     else { sbLoaded = -1;
+            sbError = stat;                      /* an error has occurred while writing */
+          }
 
   return stat;
 }
@@ -210,12 +412,15 @@ int soConvertRefInT (uint32_t nInode, uint32_t *p_nBlk, uint32_t *p_offset)
 /**
  *  \brief Load the contents of a specific block of the table of inodes into internal storage.
  *
+ *  A handle to the block is acquired, as in \c soPinBlockInT, and the handle to the block previously loaded is
+ *  released.
  *  Any type of previous / current error on loading / storing the data block will disable the operation.
  *
  *  \param nBlk logical number of the block to be read
  *
  *  \return <tt>0 (zero)</tt>, on success
  *  \return -\c EINVAL, if logical block number is out of range
+ *  \return -\c ENOBUFS, if handles to \c INT_SLOTS different blocks are currently held
  *  \return -\c EBADF, if the device is not already opened
  *  \return -\c EIO, if it fails on reading or writing
  *  \return -\c ELIBBAD, if the buffercache is inconsistent or the superblock or a data block was not previously loaded
@@ -228,18 +433,22 @@ int soLoadBlockInT (uint32_t nBlk)
   soColorProbe (515, "07;31", "soLoadBlockInT (%"PRIu32")\n", nBlk);
 
   int stat;                                      /* status of operation */
+  uint32_t hdl;                                  /* handle to the block */
 
   if ((stat = soLoadSuperBlock ()) != 0) return stat;
   if (nBlk >= sb.itable_size) return -EINVAL;
 
   if (intError != 0) return intError;            /* a previous error has occurred */
   if (nBlk == nBlkInTLoaded) return 0;           /* the block has already been read */
-  stat = soReadCacheBlock (sb.itable_start + nBlk, inode);
+  stat = soPinBlockInT (nBlk, &hdl);
   if (stat == 0)
-     nBlkInTLoaded = nBlk;                       /* operation carried out with success */
-     else { nBlkInTLoaded = -1;
-            intError = stat;                     /* an error has occurred while reading */
-          }
+     { if (nBlkInTLoaded >= 0)
+          soUnpinBlockInT (hdlInT);              /* the block previously read is no longer required */
+       hdlInT = hdl;
+       nBlkInTLoaded = nBlk;                     /* operation carried out with success */
+     }
+     else if (intError != 0)
+             nBlkInTLoaded = -1;                 /* an error has occurred while reading */
 
   return stat;
 }
@@ -259,7 +468,7 @@ SOInode *soGetBlockInT (void)
   soColorProbe (516, "07;31", "soGetBlockInT ()\n");
 
   if (nBlkInTLoaded >= 0)
-     return inode;
+     return slotInT[hdlInT].inode;
      else return NULL;
 }
 
@@ -288,15 +497,382 @@ int soStoreBlockInT (void)
                                                     read yet */
        return intError;
      }
-  stat = soWriteCacheBlock (sb.itable_start + nBlkInTLoaded, inode);
+  stat = soStoreBlockInTH (hdlInT);
   if (stat != 0)
-     { nBlkInTLoaded = -2;
-       intError = stat;                          /* an error has occurred while writing */
+     nBlkInTLoaded = -2;                         /* an error has occurred while writing */
+
+  return stat;
+}
+
+/**
+ *  \brief Acquire a handle to a specific block of the table of inodes, loading it into internal storage if needed.
+ *
+ *  Up to \c INT_SLOTS blocks are kept at the same time, each one pinned in the buffercache, so that several inodes
+ *  lying in different blocks may be handled together. A block stays in internal storage after its last handle is
+ *  released, until its slot is required for another block, and is not read again if it is acquired in the meantime.
+ *  The in-core inodes lying in the block which were changed are written back to it first.
+ *  Any type of previous / current error on loading / storing a data block will disable the operation.
+ *
+ *  \param nBlk logical number of the block to be acquired
+ *  \param p_hdl pointer to the location where the handle to the block is to be stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if logical block number is out of range or the pointer is \c NULL
+ *  \return -\c ENOBUFS, if handles to \c INT_SLOTS different blocks are currently held or all the buffercache nodes
+ *                       which may hold the block are pinned
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on reading or writing
+ *  \return -\c ELIBBAD, if the buffercache is inconsistent or the superblock or a data block was not previously loaded
+ *                       on a previous store operation
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+int soPinBlockInT (uint32_t nBlk, uint32_t *p_hdl)
+{
+  soColorProbe (525, "07;31", "soPinBlockInT (%"PRIu32", %p)\n", nBlk, p_hdl);
+
+  int stat;                                      /* status of operation */
+  uint32_t n, v;                                 /* slot indexes */
+
+  if ((stat = soLoadSuperBlock ()) != 0) return stat;
+  if ((nBlk >= sb.itable_size) || (p_hdl == NULL)) return -EINVAL;
+
+  if (intError != 0) return intError;            /* a previous error has occurred */
+  for (n = 0; n < INT_SLOTS; n++)
+    if ((slotInT[n].inode != NULL) && (slotInT[n].nBlk == nBlk)) break;
+  if (n == INT_SLOTS)                            /* the block is not held, a slot must be selected for it: a free
+                                                    one or else the least recently used one with no handles */
+     { for (v = 0; v < INT_SLOTS; v++)
+         if (slotInT[v].inode == NULL)
+            { n = v;
+              break;
+            }
+            else if ((slotInT[v].refs == 0) && ((n == INT_SLOTS) || (slotInT[v].used < slotInT[n].used)))
+                    n = v;
+       if (n == INT_SLOTS) return -ENOBUFS;
+       if (slotInT[n].inode != NULL)
+          { soUnpinCacheBlock (sb.itable_start + slotInT[n].nBlk);
+            slotInT[n].inode = NULL;
+          }
+       if (reclaimSet == 0)                      /* the buffercache may claim back the blocks (clusters) kept idle */
+          { soSetBufferCacheReclaim (releaseIdlePins);
+            reclaimSet = 1;
+          }
+       stat = soPinCacheBlock (sb.itable_start + nBlk, (void **) &slotInT[n].inode);
+       if (stat != 0)
+          { slotInT[n].inode = NULL;
+            if (stat != -ENOBUFS)
+               intError = stat;                  /* an error has occurred while reading */
+            return stat;
+          }
+       slotInT[n].nBlk = nBlk;
+       slotInT[n].refs = 0;
      }
+  if ((icDirty != 0) && ((stat = flushInodes (n)) != 0))
+     return stat;
+  slotInT[n].refs += 1;
+  slotInT[n].used = ++tickInT;
+  *p_hdl = n;
+
+  return 0;
+}
+
+/**
+ *  \brief Get a pointer to the contents of the block of the table of inodes associated with a handle.
+ *
+ *  \param hdl handle to the block
+ *
+ *  \return pointer to the specific block , on success
+ *  \return -\c NULL, if the handle is not currently held or an error on a previous load / store operation has
+ *                    occurred
+ */
+
+SOInode *soGetBlockInTH (uint32_t hdl)
+{
+  soColorProbe (526, "07;31", "soGetBlockInTH (%"PRIu32")\n", hdl);
+
+  if ((intError == 0) && (hdl < INT_SLOTS) && (slotInT[hdl].refs != 0))
+     return slotInT[hdl].inode;
+     else return NULL;
+}
+
+/**
+ *  \brief Store the contents of the block of the table of inodes associated with a handle to the storage device.
+ *
+ *  As the block is pinned in the buffercache, it is just marked changed there. The in-core inodes lying in the block
+ *  are updated from it.
+ *  Any type of previous / current error on loading / storing a data block will disable the operation.
+ *
+ *  \param hdl handle to the block
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the handle is not currently held
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on writing
+ *  \return -\c ELIBBAD, if the buffercache is inconsistent
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+int soStoreBlockInTH (uint32_t hdl)
+{
+  soColorProbe (527, "07;31", "soStoreBlockInTH (%"PRIu32")\n", hdl);
+
+  int stat;                                      /* status of operation */
+
+  if (intError != 0) return intError;            /* a previous error has occurred */
+  if ((hdl >= INT_SLOTS) || (slotInT[hdl].refs == 0)) return -EINVAL;
+  stat = soMarkCacheBlockChanged (sb.itable_start + slotInT[hdl].nBlk);
+  if (stat == 0)
+     refreshInodes (hdl);                        /* the in-core inodes lying in the block may be out of date */
+     else intError = stat;                       /* an error has occurred while writing */
 
   return stat;
 }
 
+/**
+ *  \brief Release a handle to a block of the table of inodes.
+ *
+ *  The block remains in internal storage, so that it may be acquired again without being read.
+ *
+ *  \param hdl handle to the block
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the handle is not currently held
+ */
+
+int soUnpinBlockInT (uint32_t hdl)
+{
+  soColorProbe (528, "07;31", "soUnpinBlockInT (%"PRIu32")\n", hdl);
+
+  if ((hdl >= INT_SLOTS) || (slotInT[hdl].refs == 0)) return -EINVAL;
+  slotInT[hdl].refs -= 1;
+
+  return 0;
+}
+
+/**
+ *  \brief Acquire a handle to a specific in-core inode, reading it from the table of inodes if needed.
+ *
+ *  Up to \c IC_SLOTS inodes are kept in internal storage, so that the inodes in frequent use are neither read nor
+ *  checked for consistency again on every access. An inode stays in internal storage after its last handle is
+ *  released, until its entry is required for another inode (if it was changed, it is written back then).
+ *  Any type of previous / current error on loading / storing a data block will disable the operation.
+ *
+ *  \param nInode number of the inode
+ *  \param p_hdl pointer to the location where the handle to the in-core inode is to be stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if inode number is out of range or the pointer is \c NULL
+ *  \return -\c ENOBUFS, if handles to \c IC_SLOTS different inodes are currently held
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on reading or writing
+ *  \return -\c ELIBBAD, if the buffercache is inconsistent or the superblock or a data block was not previously loaded
+ *                       on a previous store operation
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+int soPinInode (uint32_t nInode, uint32_t *p_hdl)
+{
+  soColorProbe (531, "07;31", "soPinInode (%"PRIu32", %p)\n", nInode, p_hdl);
+
+  int stat;                                      /* status of operation */
+  uint32_t n, v;                                 /* entry indexes */
+  uint32_t hdl;                                  /* handle to the block of the table of inodes */
+
+  if ((stat = soLoadSuperBlock ()) != 0) return stat;
+  if ((nInode >= sb.itotal) || (p_hdl == NULL)) return -EINVAL;
+
+  if (intError != 0) return intError;            /* a previous error has occurred */
+  if (icInit == 0)
+     { for (n = 0; n < IC_SLOTS; n++)
+         inodeInC[n].nInode = NULL_INODE;
+       icInit = 1;
+     }
+  for (n = 0; n < IC_SLOTS; n++)
+    if (inodeInC[n].nInode == nInode) break;
+  if (n == IC_SLOTS)                             /* the inode is not in internal storage, an entry must be selected
+                                                    for it: a free one or else the least recently used one with no
+                                                    handles */
+     { for (v = 0; v < IC_SLOTS; v++)
+         if (inodeInC[v].nInode == NULL_INODE)
+            { n = v;
+              break;
+            }
+            else if ((inodeInC[v].refs == 0) && ((n == IC_SLOTS) || (inodeInC[v].used < inodeInC[n].used)))
+                    n = v;
+       if (n == IC_SLOTS) return -ENOBUFS;
+       if ((inodeInC[n].nInode != NULL_INODE) && (inodeInC[n].dirty != 0) &&
+           ((stat = writeBackInode (inodeInC[n].nInode)) != 0))
+          return stat;
+       inodeInC[n].nInode = NULL_INODE;
+       if ((stat = soPinBlockInT (nInode / IPB, &hdl)) != 0)
+          return stat;
+       inodeInC[n].inode = slotInT[hdl].inode[nInode % IPB];
+       soUnpinBlockInT (hdl);
+       inodeInC[n].nInode = nInode;
+       inodeInC[n].refs = 0;
+       inodeInC[n].checked = 0;
+       inodeInC[n].dirty = 0;
+     }
+  inodeInC[n].refs += 1;
+  inodeInC[n].used = ++tickInC;
+  *p_hdl = n;
+
+  return 0;
+}
+
+/**
+ *  \brief Get a pointer to the contents of the in-core inode associated with a handle.
+ *
+ *  \param hdl handle to the in-core inode
+ *
+ *  \return pointer to the in-core inode , on success
+ *  \return -\c NULL, if the handle is not currently held
+ */
+
+SOInode *soGetInodeH (uint32_t hdl)
+{
+  soColorProbe (532, "07;31", "soGetInodeH (%"PRIu32")\n", hdl);
+
+  if ((hdl < IC_SLOTS) && (inodeInC[hdl].refs != 0))
+     return &inodeInC[hdl].inode;
+     else return NULL;
+}
+
+/**
+ *  \brief Store the contents of the in-core inode associated with a handle to the storage device.
+ *
+ *  While the file system is mounted by this process (see \c soSetMounted), the in-core inode is only marked changed and is written back on the next sync
+ *  point (see \c soSyncInodes), when its entry is required for another inode or when the block of the table of inodes
+ *  where it lies is acquired. It is written back at once, otherwise, or if a handle to the block is currently held.
+ *  In any case, the in-core inode is taken as not checked for consistency any more.
+ *  Any type of previous / current error on loading / storing a data block will disable the operation.
+ *
+ *  \param hdl handle to the in-core inode
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the handle is not currently held
+ *  \return -\c ENOBUFS, if handles to \c INT_SLOTS different blocks of the table of inodes are currently held
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on writing
+ *  \return -\c ELIBBAD, if the buffercache is inconsistent
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+int soStoreInodeH (uint32_t hdl)
+{
+  soColorProbe (533, "07;31", "soStoreInodeH (%"PRIu32")\n", hdl);
+
+  if (intError != 0) return intError;            /* a previous error has occurred */
+  if ((hdl >= IC_SLOTS) || (inodeInC[hdl].refs == 0)) return -EINVAL;
+  inodeInC[hdl].checked = 0;
+  if (inodeInC[hdl].dirty == 0)
+     { inodeInC[hdl].dirty = 1;
+       icDirty += 1;
+     }
+  if (!mounted () || blockHeld (inodeInC[hdl].nInode / IPB))
+     return writeBackInode (inodeInC[hdl].nInode);
+
+  return 0;                                      /* writing is deferred */
+}
+
+/**
+ *  \brief Check if the in-core inode associated with a handle was found consistent in a given status.
+ *
+ *  At consistency-check level \c CHECK_PARANOID, the record is ignored and the inode is never taken as found
+ *  consistent, since the metadata is then checked whenever it is used.
+ *
+ *  \param hdl handle to the in-core inode
+ *  \param status inode status
+ *
+ *  \return <tt>1 (one)</tt>, if it was found consistent in the given status and was not changed since
+ *  \return <tt>0 (zero)</tt>, otherwise
+ *  \return -\c EINVAL, if the handle is not currently held
+ */
+
+int soCheckedInodeH (uint32_t hdl, uint32_t status)
+{
+  soColorProbe (534, "07;31", "soCheckedInodeH (%"PRIu32", %"PRIu32")\n", hdl, status);
+
+  if ((hdl >= IC_SLOTS) || (inodeInC[hdl].refs == 0)) return -EINVAL;
+  if (checkLevel == CHECK_PARANOID) return 0;
+
+  return (inodeInC[hdl].checked == status + 1) ? 1 : 0;
+}
+
+/**
+ *  \brief Record that the in-core inode associated with a handle was found consistent in a given status.
+ *
+ *  The record holds until the in-core inode is stored or the block of the table of inodes where it lies is stored.
+ *
+ *  \param hdl handle to the in-core inode
+ *  \param status inode status
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the handle is not currently held
+ */
+
+int soSetCheckedInodeH (uint32_t hdl, uint32_t status)
+{
+  soColorProbe (535, "07;31", "soSetCheckedInodeH (%"PRIu32", %"PRIu32")\n", hdl, status);
+
+  if ((hdl >= IC_SLOTS) || (inodeInC[hdl].refs == 0)) return -EINVAL;
+  inodeInC[hdl].checked = status + 1;
+
+  return 0;
+}
+
+/**
+ *  \brief Release a handle to an in-core inode.
+ *
+ *  The inode remains in internal storage, so that it may be acquired again without being read.
+ *
+ *  \param hdl handle to the in-core inode
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the handle is not currently held
+ */
+
+int soUnpinInode (uint32_t hdl)
+{
+  soColorProbe (536, "07;31", "soUnpinInode (%"PRIu32")\n", hdl);
+
+  if ((hdl >= IC_SLOTS) || (inodeInC[hdl].refs == 0)) return -EINVAL;
+  inodeInC[hdl].refs -= 1;
+
+  return 0;
+}
+
+/**
+ *  \brief Write back all the in-core inodes changed since they were last written.
+ *
+ *  It is called on the sync points: the synchronization of a file, a periodic timer while the file system is mounted
+ *  and the store of the superblock which unmounts it.
+ *  Any type of previous / current error on loading / storing a data block will disable the operation.
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c ENOBUFS, if handles to \c INT_SLOTS different blocks of the table of inodes are currently held
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on writing
+ *  \return -\c ELIBBAD, if the buffercache is inconsistent
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+int soSyncInodes (void)
+{
+  soColorProbe (537, "07;31", "soSyncInodes ()\n");
+
+  int stat;                                      /* status of operation */
+  uint32_t n;                                    /* entry index */
+
+  for (n = 0; (n < IC_SLOTS) && (icDirty != 0); n++)
+    if ((inodeInC[n].nInode != NULL_INODE) && (inodeInC[n].dirty != 0) &&
+        ((stat = writeBackInode (inodeInC[n].nInode)) != 0))
+       return stat;
+
+  return 0;
+}
+
 /**
  *  \brief Convert a byte position in the data continuum (information content) of a file, into the index of the element
  *         of the list of direct references and the offset within it where it is stored.
@@ -333,6 +909,9 @@ int soConvertBPIDC (uint32_t p, uint32_t *p_clustInd, uint32_t *p_offset)
  *  \brief Load the contents of a specific cluster of the table of single indirect references to data clusters into
  *         internal storage.
  *
+ *  The cluster is pinned in the buffercache, instead of being copied. Up to \c REF_SLOTS clusters of references, either
+ *  single indirect or direct, are kept pinned, the least recently used one being replaced first, so that the cluster
+ *  previously loaded is not read again if it is loaded anew in the meantime.
  *  Any type of previous / current error on loading / storing a single indirect references cluster will disable the
  *  operation.
  *
@@ -342,6 +921,7 @@ int soConvertBPIDC (uint32_t p, uint32_t *p_clustInd, uint32_t *p_offset)
  *  \return -\c EINVAL, if physical cluster number is out of range
  *  \return -\c EBADF, if the device is not already opened
  *  \return -\c EIO, if it fails on reading or writing
+ *  \return -\c ENOBUFS, if all the buffercache nodes which may hold the cluster are pinned
  *  \return -\c ELIBBAD, if the buffercache is inconsistent or the superblock or a data block was not previously loaded
  *                       on a previous store operation
  *  \return -<em>other specific error</em> issued by \e lseek system call
@@ -352,6 +932,7 @@ int soLoadSngIndRefClust (uint32_t nClust)
   soColorProbe (519, "07;31", "soLoadSngIndRefClust (%"PRIu32")\n", nClust);
 
   int stat;                                      /* status of operation */
+  uint32_t n;                                    /* slot index */
 
   if ((stat = soLoadSuperBlock ()) != 0) return stat;
   if ((nClust < sb.dzone_start) || (((nClust - sb.dzone_start) % BLOCKS_PER_CLUSTER) != 0) ||
@@ -360,12 +941,18 @@ int soLoadSngIndRefClust (uint32_t nClust)
 
   if (sircError != 0) return sircError;          /* a previous error has occurred */
   if (nClust == nClustSIRef) return 0;           /* the cluster has already been read */
-  stat = soReadCacheCluster (nClust, &sngIndRefClust);
+  stat = pinRefClust (nClust, &n);
   if (stat == 0)
-     nClustSIRef = nClust;                       /* operation carried out with success */
-     else { nClustSIRef = -2;
-            sircError = stat;                    /* an error has occurred while reading */
-          }
+     { if (nClustSIRef >= 0)
+          slotRef[hdlSIRef].refs -= 1;           /* the cluster previously read is no longer required */
+       hdlSIRef = n;
+       sngIndRefClust = slotRef[n].clust;
+       nClustSIRef = nClust;                     /* operation carried out with success */
+     }
+     else if (stat != -ENOBUFS)                  /* running short of nodes is not an error of the cluster */
+             { nClustSIRef = -2;
+               sircError = stat;                 /* an error has occurred while reading */
+             }
 
   return stat;
 }
@@ -387,7 +974,7 @@ SODataClust *soGetSngIndRefClust (void)
   soColorProbe (520, "07;31", "soGetSngIndRefClust ()\n");
 
   if (nClustSIRef >= 0)
-     return &sngIndRefClust;
+     return sngIndRefClust;
      else return NULL;
 }
 
@@ -395,6 +982,7 @@ SODataClust *soGetSngIndRefClust (void)
  *  \brief Store the contents of a specific cluster of the table of single indirect references to data clusters resident
  *         in internal storage to the storage device.
  *
+ *  As the cluster is pinned in the buffercache, it is just marked changed there.
  *  Any type of previous / current error on loading / storing a single indirect references cluster will disable the
  *  operation.
  *
@@ -419,9 +1007,10 @@ int soStoreSngIndRefClust (void)
                                                     read yet */
        return sircError;
      }
-  stat = soWriteCacheCluster (nClustSIRef, &sngIndRefClust);
+  stat = soMarkCacheClusterChanged (nClustSIRef);
   if (stat != 0)
-     { nClustSIRef = -2;
+     { slotRef[hdlSIRef].refs -= 1;
+       nClustSIRef = -2;
        sircError = stat;                          /* an error has occurred while writing */
      }
 
@@ -432,6 +1021,9 @@ int soStoreSngIndRefClust (void)
  *  \brief Load the contents of a specific cluster of the table of direct references to data clusters into internal
  *         storage.
  *
+ *  The cluster is pinned in the buffercache, instead of being copied. Up to \c REF_SLOTS clusters of references, either
+ *  single indirect or direct, are kept pinned, the least recently used one being replaced first, so that the cluster
+ *  previously loaded is not read again if it is loaded anew in the meantime.
  *  Any type of previous / current error on loading / storing a direct references cluster will disable the
  *  operation.
  *
@@ -441,6 +1033,7 @@ int soStoreSngIndRefClust (void)
  *  \return -\c EINVAL, if physical cluster number is out of range
  *  \return -\c EBADF, if the device is not already opened
  *  \return -\c EIO, if it fails on reading or writing
+ *  \return -\c ENOBUFS, if all the buffercache nodes which may hold the cluster are pinned
  *  \return -\c ELIBBAD, if the buffercache is inconsistent or the superblock or a data block was not previously loaded
  *                       on a previous store operation
  *  \return -<em>other specific error</em> issued by \e lseek system call
@@ -451,6 +1044,7 @@ int soLoadDirRefClust (uint32_t nClust)
   soColorProbe (522, "07;31", "soLoadDirRefClust (%"PRIu32")\n", nClust);
 
   int stat;                                      /* status of operation */
+  uint32_t n;                                    /* slot index */
 
   if ((stat = soLoadSuperBlock ()) != 0) return stat;
   if ((nClust < sb.dzone_start) || (((nClust - sb.dzone_start) % BLOCKS_PER_CLUSTER) != 0) ||
@@ -459,12 +1053,18 @@ int soLoadDirRefClust (uint32_t nClust)
 
   if (drcError != 0) return drcError;            /* a previous error has occurred */
   if (nClust == nClustDRef) return 0;            /* the cluster has already been read */
-  stat = soReadCacheCluster (nClust, &dirRefClust);
+  stat = pinRefClust (nClust, &n);
   if (stat == 0)
-	  nClustDRef = nClust;                       /* operation carried out with success */
-     else { nClustDRef = -2;
-            drcError = stat;                     /* an error has occurred while reading */
-          }
+     { if (nClustDRef >= 0)
+          slotRef[hdlDRef].refs -= 1;            /* the cluster previously read is no longer required */
+       hdlDRef = n;
+       dirRefClust = slotRef[n].clust;
+       nClustDRef = nClust;                      /* operation carried out with success */
+     }
+     else if (stat != -ENOBUFS)                  /* running short of nodes is not an error of the cluster */
+             { nClustDRef = -2;
+               drcError = stat;                  /* an error has occurred while reading */
+             }
 
   return stat;
 }
@@ -485,7 +1085,7 @@ SODataClust *soGetDirRefClust (void)
   soColorProbe (523, "07;31", "soGetDirRefClust ()\n");
 
   if (nClustDRef >= 0)
-     return &dirRefClust;
+     return dirRefClust;
      else return NULL;
 }
 
@@ -493,6 +1093,7 @@ SODataClust *soGetDirRefClust (void)
  *  \brief Store the contents of a specific cluster of the table of direct references to data clusters resident
  *         in internal storage to the storage device.
  *
+ *  As the cluster is pinned in the buffercache, it is just marked changed there.
  *  Any type of previous / current error on loading / storing a direct references cluster will disable the
  *  operation.
  *
@@ -517,11 +1118,310 @@ int soStoreDirRefClust (void)
                                                     read yet */
        return sircError;
      }
-  stat = soWriteCacheCluster (nClustDRef, &dirRefClust);
+  stat = soMarkCacheClusterChanged (nClustDRef);
   if (stat != 0)
-     { nClustDRef = -2;
+     { slotRef[hdlDRef].refs -= 1;
+       nClustDRef = -2;
        drcError = stat;                          /* an error has occurred while writing */
      }
 
   return stat;
 }
+
+/**
+ *  \brief Set the consistency-check level.
+ *
+ *  At level \c CHECK_PARANOID, the metadata is checked whenever it is used. At level \c CHECK_MOUNT, it is only
+ *  checked at mount time and whenever it is loaded into internal storage. At level \c CHECK_OFF, it is not checked
+ *  at all. The level is kept until it is set again.
+ *
+ *  \param level consistency-check level
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the level is invalid
+ */
+
+int soSetCheckLevel (uint32_t level)
+{
+  soColorProbe (538, "07;31", "soSetCheckLevel (%"PRIu32")\n", level);
+
+  if ((level != CHECK_PARANOID) && (level != CHECK_MOUNT) && (level != CHECK_OFF))
+     return -EINVAL;
+  checkLevel = level;
+
+  return 0;
+}
+
+/**
+ *  \brief Get the consistency-check level.
+ *
+ *  \return the consistency-check level
+ */
+
+uint32_t soGetCheckLevel (void)
+{
+  soColorProbe (539, "07;31", "soGetCheckLevel ()\n");
+
+  return checkLevel;
+}
+
+/**
+ *  \brief Tell if a consistency check is to be carried out at the current level and, if so, start accounting for the
+ *         CPU time it takes.
+ *
+ *  A call returning <tt>1 (one)</tt> must be followed by a call to \c soEndCheck, once the check is carried out.
+ *
+ *  \param when occasion of the check (\c CHECK_ON_USE or \c CHECK_ON_LOAD)
+ *
+ *  \return <tt>1 (one)</tt>, if the check is to be carried out
+ *  \return <tt>0 (zero)</tt>, otherwise
+ */
+
+int soBeginCheck (uint32_t when)
+{
+  soColorProbe (540, "07;31", "soBeginCheck (%"PRIu32")\n", when);
+
+  if ((checkLevel == CHECK_OFF) || ((checkLevel == CHECK_MOUNT) && (when == CHECK_ON_USE)))
+     return 0;
+  checkStart = cpuNs ();
+
+  return 1;
+}
+
+/**
+ *  \brief Stop accounting for the CPU time taken by a consistency check.
+ *
+ *  \param stat status of the check
+ *
+ *  \return the status of the check
+ */
+
+int soEndCheck (int stat)
+{
+  soColorProbe (541, "07;31", "soEndCheck (%d)\n", stat);
+
+  nChecks += 1;
+  checkNs += cpuNs () - checkStart;
+
+  return stat;
+}
+
+/**
+ *  \brief Get the number of consistency checks carried out and the CPU time taken by them.
+ *
+ *  \param p_checks pointer to the location where the number of checks is to be stored
+ *  \param p_ns pointer to the location where the CPU time, in nanoseconds, is to be stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if any of the pointers is \c NULL
+ */
+
+int soGetCheckStats (uint64_t *p_checks, uint64_t *p_ns)
+{
+  soColorProbe (542, "07;31", "soGetCheckStats (%p, %p)\n", p_checks, p_ns);
+
+  if ((p_checks == NULL) || (p_ns == NULL)) return -EINVAL;
+  *p_checks = nChecks;
+  *p_ns = checkNs;
+
+  return 0;
+}
+
+/**
+ *  \brief Forget the internal storage, after the buffercache was closed without unmounting the file system.
+ *
+ *  The superblock, the blocks of the table of inodes, the in-core inodes and the clusters of references to data
+ *  clusters kept in internal storage, as well as any previous error on loading / storing them, are discarded without
+ *  being written: the pointers into the buffercache they hold are no longer valid. The consistency-check level and
+ *  the statistics are kept.
+ */
+
+void soResetBasicOper (void)
+{
+  soColorProbe (544, "07;31", "soResetBasicOper ()\n");
+
+  sbLoaded = 0;
+  sbError = 0;
+  sbDirty = 0;
+  fsMounted = 0;
+  memset (slotInT, 0, sizeof (slotInT));
+  hdlInT = 0;
+  nBlkInTLoaded = -1;
+  intError = 0;
+  icInit = 0;
+  icDirty = 0;
+  memset (slotRef, 0, sizeof (slotRef));
+  sngIndRefClust = NULL;
+  hdlSIRef = 0;
+  nClustSIRef = -1;
+  sircError = 0;
+  dirRefClust = NULL;
+  hdlDRef = 0;
+  nClustDRef = -1;
+  drcError = 0;
+}
+
+/*
+ *  Check if the file system is mounted by this process.
+ */
+
+static int mounted (void)
+{
+  return (sbLoaded == 1) && (fsMounted == 1);
+}
+
+/*
+ *  Copy the changed in-core inodes lying in the block held in a slot to the block and mark it changed.
+ */
+
+static int flushInodes (uint32_t n)
+{
+  int stat;                                      /* status of operation */
+  uint32_t k;                                    /* entry index */
+  uint32_t nChanged = 0;                         /* number of inodes copied */
+
+  for (k = 0; k < IC_SLOTS; k++)
+    if ((inodeInC[k].nInode != NULL_INODE) && (inodeInC[k].dirty != 0) && (inodeInC[k].nInode / IPB == slotInT[n].nBlk))
+       { slotInT[n].inode[inodeInC[k].nInode % IPB] = inodeInC[k].inode;
+         inodeInC[k].dirty = 0;
+         icDirty -= 1;
+         nChanged += 1;
+       }
+  if (nChanged == 0) return 0;
+  stat = soMarkCacheBlockChanged (sb.itable_start + slotInT[n].nBlk);
+  if (stat != 0)
+     intError = stat;                            /* an error has occurred while writing */
+
+  return stat;
+}
+
+/*
+ *  Update the in-core inodes lying in the block held in a slot from the block, after it was stored.
+ */
+
+static void refreshInodes (uint32_t n)
+{
+  uint32_t k;                                    /* entry index */
+
+  for (k = 0; (k < IC_SLOTS) && (icInit != 0); k++)
+    if ((inodeInC[k].nInode != NULL_INODE) && (inodeInC[k].nInode / IPB == slotInT[n].nBlk))
+       { inodeInC[k].inode = slotInT[n].inode[inodeInC[k].nInode % IPB];
+         inodeInC[k].checked = 0;
+       }
+}
+
+/*
+ *  Check if a handle to a block of the table of inodes is currently held.
+ */
+
+static int blockHeld (uint32_t nBlk)
+{
+  uint32_t n;                                    /* slot index */
+
+  for (n = 0; n < INT_SLOTS; n++)
+    if ((slotInT[n].inode != NULL) && (slotInT[n].nBlk == nBlk) && (slotInT[n].refs != 0))
+       return 1;
+
+  return 0;
+}
+
+/*
+ *  Write back an in-core inode, together with any other changed in-core inode lying in the same block: acquiring the
+ *  block does it.
+ */
+
+static int writeBackInode (uint32_t nInode)
+{
+  int stat;                                      /* status of operation */
+  uint32_t hdl;                                  /* handle to the block of the table of inodes */
+
+  if ((stat = soPinBlockInT (nInode / IPB, &hdl)) != 0)
+     return stat;
+  soUnpinBlockInT (hdl);
+
+  return 0;
+}
+
+/*
+ *  Pin a cluster of references to data clusters in a slot of the set kept in internal storage and add a user to it.
+ */
+
+static int pinRefClust (uint32_t nClust, uint32_t *p_n)
+{
+  int stat;                                      /* status of operation */
+  uint32_t n, v;                                 /* slot indexes */
+
+  for (n = 0; n < REF_SLOTS; n++)
+    if ((slotRef[n].clust != NULL) && (slotRef[n].nClust == nClust)) break;
+  if (n == REF_SLOTS)                            /* the cluster is not held, a slot must be selected for it: a free
+                                                    one or else the least recently used one with no users */
+     { for (v = 0; v < REF_SLOTS; v++)
+         if (slotRef[v].clust == NULL)
+            { n = v;
+              break;
+            }
+            else if ((slotRef[v].refs == 0) && ((n == REF_SLOTS) || (slotRef[v].used < slotRef[n].used)))
+                    n = v;
+       if (n == REF_SLOTS) return -ENOBUFS;
+       if (slotRef[n].clust != NULL)
+          { soUnpinCacheCluster (slotRef[n].nClust);
+            slotRef[n].clust = NULL;
+          }
+       if (reclaimSet == 0)                      /* the buffercache may claim back the blocks (clusters) kept idle */
+          { soSetBufferCacheReclaim (releaseIdlePins);
+            reclaimSet = 1;
+          }
+       stat = soPinCacheCluster (nClust, (void **) &slotRef[n].clust);
+       if (stat != 0)
+          { slotRef[n].clust = NULL;
+            return stat;
+          }
+       slotRef[n].nClust = nClust;
+       slotRef[n].refs = 0;
+     }
+  slotRef[n].refs += 1;
+  slotRef[n].used = ++tickRef;
+  *p_n = n;
+
+  return 0;
+}
+
+/*
+ *  Unpin the blocks of the table of inodes and the clusters of references to data clusters which are kept in internal
+ *  storage, but are not in use, so that the buffercache nodes they take may be used to load another block (cluster).
+ *  It is called by the buffercache, whenever it runs short of nodes (of entries of the table of pinned blocks).
+ */
+
+static int releaseIdlePins (void)
+{
+  uint32_t n;                                    /* slot index */
+  int nReleased = 0;                             /* number of blocks and clusters unpinned */
+
+  for (n = 0; n < REF_SLOTS; n++)
+    if ((slotRef[n].clust != NULL) && (slotRef[n].refs == 0))
+       { soUnpinCacheCluster (slotRef[n].nClust);
+         slotRef[n].clust = NULL;
+         nReleased += 1;
+       }
+  for (n = 0; n < INT_SLOTS; n++)
+    if ((slotInT[n].inode != NULL) && (slotInT[n].refs == 0))
+       { soUnpinCacheBlock (sb.itable_start + slotInT[n].nBlk);
+         slotInT[n].inode = NULL;
+         nReleased += 1;
+       }
+
+  return nReleased;
+}
+
+/*
+ *  Read the CPU time of the calling thread in nanoseconds.
+ */
+
+static uint64_t cpuNs (void)
+{
+  struct timespec ts;                            /* clock reading */
+
+  clock_gettime (CLOCK_THREAD_CPUTIME_ID, &ts);
+
+  return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
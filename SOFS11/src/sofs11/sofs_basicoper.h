@@ -10,12 +10,19 @@
  *      \li load the contents of the superblock into internal storage
  *      \li get a pointer to the contents of the superblock
  *      \li store the contents of the superblock resident in internal storage to the storage device
+ *      \li write the contents of the superblock resident in internal storage to the storage device, if they were
+ *          changed
+ *      \li get the number of store operations on the superblock and of writes of the superblock
  *      \li convert the inode number, which translates to an entry of the inode table, into the logical number (the
  *          ordinal, starting at zero, of the succession blocks that the table of inodes comprises) and the offset of
  *          the block where it is stored
  *      \li load the contents of a specific block of the table of inodes into internal storage
  *      \li get a pointer to the contents of a specific block of the table of inodes
  *      \li store the contents of the block of the table of inodes resident in internal storage to the storage device
+ *      \li acquire, get a pointer to, store and release one of several blocks of the table of inodes kept in internal
+ *          storage at the same time, through a handle
+ *      \li acquire, get a pointer to, store, check the consistency record of and release an in-core inode, through a
+ *          handle, and write back all the in-core inodes changed
  *      \li convert a byte position in the data continuum (information content) of a file, into the index of the element
  *          of the list of direct references and the offset within it where it is stored
  *      \li load the contents of a specific cluster of the table of single indirect references to data clusters into
@@ -28,7 +35,9 @@
  *          storage
  *      \li get a pointer to the contents of a specific cluster of the table of direct references to data clusters
  *      \li store the contents of a specific cluster of the table of direct references to data clusters resident in
- *          internal storage to the storage device.
+ *          internal storage to the storage device
+ *      \li set and get the consistency-check level, tell if a consistency check is to be carried out, account for
+ *          the CPU time it takes and get the number of checks carried out and the CPU time taken by them.
  *
  *  \author António Rui Borges - August 2010 - August 2011
  *
@@ -45,6 +54,26 @@
 #include "sofs_superblock.h"
 #include "sofs_inode.h"
 
+/** \brief maximum number of blocks of the table of inodes kept in internal storage at the same time */
+#define INT_SLOTS  (4)
+/** \brief maximum number of in-core inodes */
+#define IC_SLOTS   (64)
+/** \brief maximum number of clusters of references to data clusters kept in internal storage at the same time */
+#define REF_SLOTS  (16)
+
+/** \brief consistency-check level: the metadata is checked whenever it is used (default) */
+#define CHECK_PARANOID  (0)
+/** \brief consistency-check level: the metadata is checked at mount time and whenever it is loaded into internal
+ *         storage */
+#define CHECK_MOUNT     (1)
+/** \brief consistency-check level: the metadata is not checked (benchmarking only) */
+#define CHECK_OFF       (2)
+
+/** \brief consistency check carried out whenever the metadata is used */
+#define CHECK_ON_USE    (0)
+/** \brief consistency check carried out at mount time or when the metadata is loaded into internal storage */
+#define CHECK_ON_LOAD   (1)
+
 /**
  *  \brief Load the contents of the superblock into internal storage.
  *
@@ -75,6 +104,9 @@ extern SOSuperBlock *soGetSuperBlock (void);
 /**
  *  \brief Store the contents of the superblock resident in internal storage to the storage device.
  *
+ *  While the file system is mounted by this process (see \c soSetMounted), the superblock is only marked changed and
+ *  is written on the next sync point (see \c soSyncSuperBlock), since the flag signaling if it was properly unmounted
+ *  is then \c NPRU in the storage device and a crash is detected anyway. Otherwise, it is written at once.
  *  Any type of previous / current error on loading / storing the superblock data will disable the operation.
  *
  *  \return <tt>0 (zero)</tt>, on success
@@ -87,6 +119,55 @@ extern SOSuperBlock *soGetSuperBlock (void);
 
 extern int soStoreSuperBlock (void);
 
+/**
+ *  \brief Write the contents of the superblock resident in internal storage to the storage device, if they were
+ *         changed since they were last written.
+ *
+ *  It is called on the sync points: the synchronization of a file and a periodic timer while the file system is
+ *  mounted (unmounting it writes the superblock anyway, since the flag signaling if it was properly unmounted is
+ *  changed).
+ *  Any type of previous / current error on loading / storing the superblock data will disable the operation.
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on writing
+ *  \return -\c ELIBBAD, if the buffercache is inconsistent
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+extern int soSyncSuperBlock (void);
+
+/**
+ *  \brief Set whether the file system is mounted by this process.
+ *
+ *  It is set after mounting has marked the file system as not properly unmounted in the storage device, and cleared
+ *  before unmounting marks it back: only in between are the writes of the superblock and of the in-core inodes
+ *  deferred. Clearing it writes the pending changes of both.
+ *
+ *  \param status mounted: 0 - no, 1 - yes
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the status is invalid
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on writing
+ *  \return -\c ELIBBAD, if the buffercache is inconsistent
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+extern int soSetMounted (uint32_t status);
+
+/**
+ *  \brief Get the number of store operations on the superblock and of writes of the superblock.
+ *
+ *  \param p_stores pointer to the location where the number of store operations is to be stored
+ *  \param p_writes pointer to the location where the number of writes is to be stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if any of the pointers is \c NULL
+ */
+
+extern int soGetSuperBlockStats (uint64_t *p_stores, uint64_t *p_writes);
+
 /**
  *  \brief Convert the inode number, which translates to an entry of the inode table, into the logical number (the
  *         ordinal, starting at zero, of the succession blocks that the table of inodes comprises) and the offset of
@@ -110,12 +191,15 @@ extern int soConvertRefInT (uint32_t nInode, uint32_t *p_nBlk, uint32_t *p_offse
 /**
  *  \brief Load the contents of a specific block of the table of inodes into internal storage.
  *
+ *  A handle to the block is acquired, as in \c soPinBlockInT, and the handle to the block previously loaded is
+ *  released.
  *  Any type of previous / current error on loading / storing the data block will disable the operation.
  *
  *  \param nBlk logical number of the block to be read
  *
  *  \return <tt>0 (zero)</tt>, on success
  *  \return -\c EINVAL, if logical block number is out of range
+ *  \return -\c ENOBUFS, if handles to \c INT_SLOTS different blocks are currently held
  *  \return -\c EBADF, if the device is not already opened
  *  \return -\c EIO, if it fails on reading or writing
  *  \return -\c ELIBBAD, if the buffercache is inconsistent or the superblock or a data block was not previously loaded
@@ -151,6 +235,189 @@ extern SOInode *soGetBlockInT (void);
 
 extern int soStoreBlockInT (void);
 
+/**
+ *  \brief Acquire a handle to a specific block of the table of inodes, loading it into internal storage if needed.
+ *
+ *  Up to \c INT_SLOTS blocks are kept at the same time, each one pinned in the buffercache, so that several inodes
+ *  lying in different blocks may be handled together. A block stays in internal storage after its last handle is
+ *  released, until its slot is required for another block, and is not read again if it is acquired in the meantime.
+ *  Any type of previous / current error on loading / storing a data block will disable the operation.
+ *
+ *  \param nBlk logical number of the block to be acquired
+ *  \param p_hdl pointer to the location where the handle to the block is to be stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if logical block number is out of range or the pointer is \c NULL
+ *  \return -\c ENOBUFS, if handles to \c INT_SLOTS different blocks are currently held or all the buffercache nodes
+ *                       which may hold the block are pinned
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on reading or writing
+ *  \return -\c ELIBBAD, if the buffercache is inconsistent or the superblock or a data block was not previously loaded
+ *                       on a previous store operation
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+extern int soPinBlockInT (uint32_t nBlk, uint32_t *p_hdl);
+
+/**
+ *  \brief Get a pointer to the contents of the block of the table of inodes associated with a handle.
+ *
+ *  \param hdl handle to the block
+ *
+ *  \return pointer to the specific block , on success
+ *  \return -\c NULL, if the handle is not currently held or an error on a previous load / store operation has
+ *                    occurred
+ */
+
+extern SOInode *soGetBlockInTH (uint32_t hdl);
+
+/**
+ *  \brief Store the contents of the block of the table of inodes associated with a handle to the storage device.
+ *
+ *  As the block is pinned in the buffercache, it is just marked changed there.
+ *  Any type of previous / current error on loading / storing a data block will disable the operation.
+ *
+ *  \param hdl handle to the block
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the handle is not currently held
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on writing
+ *  \return -\c ELIBBAD, if the buffercache is inconsistent
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+extern int soStoreBlockInTH (uint32_t hdl);
+
+/**
+ *  \brief Release a handle to a block of the table of inodes.
+ *
+ *  The block remains in internal storage, so that it may be acquired again without being read.
+ *
+ *  \param hdl handle to the block
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the handle is not currently held
+ */
+
+extern int soUnpinBlockInT (uint32_t hdl);
+
+/**
+ *  \brief Acquire a handle to a specific in-core inode, reading it from the table of inodes if needed.
+ *
+ *  Up to \c IC_SLOTS inodes are kept in internal storage, so that the inodes in frequent use are neither read nor
+ *  checked for consistency again on every access. An inode stays in internal storage after its last handle is
+ *  released, until its entry is required for another inode (if it was changed, it is written back then).
+ *  Any type of previous / current error on loading / storing a data block will disable the operation.
+ *
+ *  \param nInode number of the inode
+ *  \param p_hdl pointer to the location where the handle to the in-core inode is to be stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if inode number is out of range or the pointer is \c NULL
+ *  \return -\c ENOBUFS, if handles to \c IC_SLOTS different inodes are currently held
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on reading or writing
+ *  \return -\c ELIBBAD, if the buffercache is inconsistent or the superblock or a data block was not previously loaded
+ *                       on a previous store operation
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+extern int soPinInode (uint32_t nInode, uint32_t *p_hdl);
+
+/**
+ *  \brief Get a pointer to the contents of the in-core inode associated with a handle.
+ *
+ *  \param hdl handle to the in-core inode
+ *
+ *  \return pointer to the in-core inode , on success
+ *  \return -\c NULL, if the handle is not currently held
+ */
+
+extern SOInode *soGetInodeH (uint32_t hdl);
+
+/**
+ *  \brief Store the contents of the in-core inode associated with a handle to the storage device.
+ *
+ *  While the file system is mounted by this process (see \c soSetMounted), the in-core inode is only marked changed and is written back on the next sync
+ *  point (see \c soSyncInodes), when its entry is required for another inode or when the block of the table of inodes
+ *  where it lies is acquired. It is written back at once, otherwise, or if a handle to the block is currently held.
+ *  In any case, the in-core inode is taken as not checked for consistency any more.
+ *  Any type of previous / current error on loading / storing a data block will disable the operation.
+ *
+ *  \param hdl handle to the in-core inode
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the handle is not currently held
+ *  \return -\c ENOBUFS, if handles to \c INT_SLOTS different blocks of the table of inodes are currently held
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on writing
+ *  \return -\c ELIBBAD, if the buffercache is inconsistent
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+extern int soStoreInodeH (uint32_t hdl);
+
+/**
+ *  \brief Check if the in-core inode associated with a handle was found consistent in a given status.
+ *
+ *  At consistency-check level \c CHECK_PARANOID, the record is ignored and the inode is never taken as found
+ *  consistent, since the metadata is then checked whenever it is used.
+ *
+ *  \param hdl handle to the in-core inode
+ *  \param status inode status
+ *
+ *  \return <tt>1 (one)</tt>, if it was found consistent in the given status and was not changed since
+ *  \return <tt>0 (zero)</tt>, otherwise
+ *  \return -\c EINVAL, if the handle is not currently held
+ */
+
+extern int soCheckedInodeH (uint32_t hdl, uint32_t status);
+
+/**
+ *  \brief Record that the in-core inode associated with a handle was found consistent in a given status.
+ *
+ *  The record holds until the in-core inode is stored or the block of the table of inodes where it lies is stored.
+ *
+ *  \param hdl handle to the in-core inode
+ *  \param status inode status
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the handle is not currently held
+ */
+
+extern int soSetCheckedInodeH (uint32_t hdl, uint32_t status);
+
+/**
+ *  \brief Release a handle to an in-core inode.
+ *
+ *  The inode remains in internal storage, so that it may be acquired again without being read.
+ *
+ *  \param hdl handle to the in-core inode
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the handle is not currently held
+ */
+
+extern int soUnpinInode (uint32_t hdl);
+
+/**
+ *  \brief Write back all the in-core inodes changed since they were last written.
+ *
+ *  It is called on the sync points: the synchronization of a file, a periodic timer while the file system is mounted
+ *  and the store of the superblock which unmounts it.
+ *  Any type of previous / current error on loading / storing a data block will disable the operation.
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c ENOBUFS, if handles to \c INT_SLOTS different blocks of the table of inodes are currently held
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails on writing
+ *  \return -\c ELIBBAD, if the buffercache is inconsistent
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+extern int soSyncInodes (void);
+
 /**
  *  \brief Convert a byte position in the data continuum (information content) of a file, into the index of the element
  *         of the list of direct references and the offset within it where it is stored.
@@ -176,6 +443,9 @@ extern int soConvertBPIDC (uint32_t p, uint32_t *p_clustInd, uint32_t *p_offset)
  *  \brief Load the contents of a specific cluster of the table of single indirect references to data clusters into
  *         internal storage.
  *
+ *  The cluster is pinned in the buffercache, instead of being copied. Up to \c REF_SLOTS clusters of references, either
+ *  single indirect or direct, are kept pinned, the least recently used one being replaced first, so that the cluster
+ *  previously loaded is not read again if it is loaded anew in the meantime.
  *  Any type of previous / current error on loading / storing a single indirect references cluster will disable the
  *  operation.
  *
@@ -185,6 +455,7 @@ extern int soConvertBPIDC (uint32_t p, uint32_t *p_clustInd, uint32_t *p_offset)
  *  \return -\c EINVAL, if physical cluster number is out of range
  *  \return -\c EBADF, if the device is not already opened
  *  \return -\c EIO, if it fails on reading or writing
+ *  \return -\c ENOBUFS, if all the buffercache nodes which may hold the cluster are pinned
  *  \return -\c ELIBBAD, if the buffercache is inconsistent or the superblock or a data block was not previously loaded
  *                       on a previous store operation
  *  \return -<em>other specific error</em> issued by \e lseek system call
@@ -210,6 +481,7 @@ extern SODataClust *soGetSngIndRefClust (void);
  *  \brief Store the contents of a specific cluster of the table of single indirect references to data clusters resident
  *         in internal storage to the storage device.
  *
+ *  As the cluster is pinned in the buffercache, it is just marked changed there.
  *  Any type of previous / current error on loading / storing a single indirect references cluster will disable the
  *  operation.
  *
@@ -227,6 +499,9 @@ extern int soStoreSngIndRefClust (void);
  *  \brief Load the contents of a specific cluster of the table of direct references to data clusters into internal
  *         storage.
  *
+ *  The cluster is pinned in the buffercache, instead of being copied. Up to \c REF_SLOTS clusters of references, either
+ *  single indirect or direct, are kept pinned, the least recently used one being replaced first, so that the cluster
+ *  previously loaded is not read again if it is loaded anew in the meantime.
  *  Any type of previous / current error on loading / storing a direct references cluster will disable the
  *  operation.
  *
@@ -236,6 +511,7 @@ extern int soStoreSngIndRefClust (void);
  *  \return -\c EINVAL, if physical cluster number is out of range
  *  \return -\c EBADF, if the device is not already opened
  *  \return -\c EIO, if it fails on reading or writing
+ *  \return -\c ENOBUFS, if all the buffercache nodes which may hold the cluster are pinned
  *  \return -\c ELIBBAD, if the buffercache is inconsistent or the superblock or a data block was not previously loaded
  *                       on a previous store operation
  *  \return -<em>other specific error</em> issued by \e lseek system call
@@ -260,6 +536,7 @@ extern SODataClust *soGetDirRefClust (void);
  *  \brief Store the contents of a specific cluster of the table of direct references to data clusters resident
  *         in internal storage to the storage device.
  *
+ *  As the cluster is pinned in the buffercache, it is just marked changed there.
  *  Any type of previous / current error on loading / storing a direct references cluster will disable the
  *  operation.
  *
@@ -273,4 +550,74 @@ extern SODataClust *soGetDirRefClust (void);
 
 extern int soStoreDirRefClust (void);
 
+/**
+ *  \brief Set the consistency-check level.
+ *
+ *  At level \c CHECK_PARANOID, the metadata is checked whenever it is used. At level \c CHECK_MOUNT, it is only
+ *  checked at mount time and whenever it is loaded into internal storage. At level \c CHECK_OFF, it is not checked
+ *  at all. The level is kept until it is set again.
+ *
+ *  \param level consistency-check level
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if the level is invalid
+ */
+
+extern int soSetCheckLevel (uint32_t level);
+
+/**
+ *  \brief Get the consistency-check level.
+ *
+ *  \return the consistency-check level
+ */
+
+extern uint32_t soGetCheckLevel (void);
+
+/**
+ *  \brief Tell if a consistency check is to be carried out at the current level and, if so, start accounting for the
+ *         CPU time it takes.
+ *
+ *  A call returning <tt>1 (one)</tt> must be followed by a call to \c soEndCheck, once the check is carried out.
+ *
+ *  \param when occasion of the check (\c CHECK_ON_USE or \c CHECK_ON_LOAD)
+ *
+ *  \return <tt>1 (one)</tt>, if the check is to be carried out
+ *  \return <tt>0 (zero)</tt>, otherwise
+ */
+
+extern int soBeginCheck (uint32_t when);
+
+/**
+ *  \brief Stop accounting for the CPU time taken by a consistency check.
+ *
+ *  \param stat status of the check
+ *
+ *  \return the status of the check
+ */
+
+extern int soEndCheck (int stat);
+
+/**
+ *  \brief Get the number of consistency checks carried out and the CPU time taken by them.
+ *
+ *  \param p_checks pointer to the location where the number of checks is to be stored
+ *  \param p_ns pointer to the location where the CPU time, in nanoseconds, is to be stored
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EINVAL, if any of the pointers is \c NULL
+ */
+
+extern int soGetCheckStats (uint64_t *p_checks, uint64_t *p_ns);
+
+/**
+ *  \brief Forget the internal storage, after the buffercache was closed without unmounting the file system.
+ *
+ *  The superblock, the blocks of the table of inodes, the in-core inodes and the clusters of references to data
+ *  clusters kept in internal storage, as well as any previous error on loading / storing them, are discarded without
+ *  being written: the pointers into the buffercache they hold are no longer valid. The consistency-check level and
+ *  the statistics are kept.
+ */
+
+extern void soResetBasicOper (void);
+
 #endif /* SOFS_BASICOPER_H_ */
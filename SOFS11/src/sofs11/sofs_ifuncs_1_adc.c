@@ -65,7 +65,7 @@ int soAllocDataCluster (uint32_t nInode, uint32_t *p_nClust)
   
   /*Variables*/
   SOInode *inode;
-  SODataClust allocCluster;
+  SODataClust *allocCluster;			/*Cluster that will be allocated (pinned in the buffercache)*/
   SOSuperBlock *sb;
   int status;
   uint32_t offset;				/*Inode offset in the corresponding block of the inode table*/
@@ -108,31 +108,42 @@ int soAllocDataCluster (uint32_t nInode, uint32_t *p_nClust)
       return status;
   /* Check if cluster is not allocated */
   logiCluster = sb->dzone_retriev.cache[sb->dzone_retriev.cache_idx];
-  if((status = soQCheckStatDC(sb, logiCluster, &AllocStatus)) != 0)
-    return status;
-  if(AllocStatus != FREE_CLT)
-    return -EDCINVAL;
+  if(soBeginCheck(CHECK_ON_USE))
+  {
+    if((status = soEndCheck(soQCheckStatDC(sb, logiCluster, &AllocStatus))) != 0)
+      return status;
+    if(AllocStatus != FREE_CLT)
+      return -EDCINVAL;
+  }
   /*Retrieve cluster*/
   physCluster = logiCluster * BLOCKS_PER_CLUSTER + sb->dzone_start;
-  if((status = soReadCacheCluster(physCluster, &allocCluster)) != 0)
+  if((status = soPinCacheCluster(physCluster, (void **) &allocCluster)) != 0)
     return status;
 
   /** Update superblock **/
   sb->dzone_free--;
   sb->dzone_retriev.cache_idx++;
   if((status = soStoreSuperBlock()) != 0)
+  {
+    soUnpinCacheCluster(physCluster);
     return status;
+  }
 
   /** Check if data cluster is in dirty state **/
-  if(allocCluster.stat != NULL_INODE)
+  if(allocCluster->stat != NULL_INODE)
   {
-    if((status = soCleanDataCluster(allocCluster.stat, logiCluster)) != 0)
+    if((status = soCleanDataCluster(allocCluster->stat, logiCluster)) != 0)
+    {
+      soUnpinCacheCluster(physCluster);
       return status;
+    }
   }
 
   /** Allocate Cluster **/
-  allocCluster.stat = nInode;
-  if((status = soWriteCacheCluster(physCluster, &allocCluster)) != 0)
+  allocCluster->stat = nInode;
+  status = soMarkCacheClusterChanged(physCluster);
+  soUnpinCacheCluster(physCluster);
+  if(status != 0)
     return status;
 
   /** Update p_nClust with the logical number of the allocated cluster **/
@@ -150,8 +161,8 @@ static int soReplenish(SOSuperBlock *sb)
   int status;				/*Operation status variable*/
   uint32_t currPhysical, nextPhysical;  /*Physical number of the current and next clusters*/
   uint32_t *auxArray;			/*Auxiliary array to store the logical number of the clusters*/
-  SODataClust currCluster;		/*Current or Head cluster*/
-  SODataClust nextCluster;		/*Next cluster in the gen. repository of free data clusters*/
+  SODataClust *currCluster;		/*Current or Head cluster (pinned in the buffercache)*/
+  SODataClust *nextCluster;		/*Next cluster in the gen. repository of free data clusters (pinned)*/
 
   /** Parameter validation **/
   if(sb == NULL)
@@ -177,24 +188,34 @@ static int soReplenish(SOSuperBlock *sb)
   {
     /*Read head clusrer*/
     currPhysical = sb->dzone_start + sb->dhead * BLOCKS_PER_CLUSTER;
-    if((status = soReadCacheCluster(currPhysical, &currCluster)) != 0)
+    if((status = soPinCacheCluster(currPhysical, (void **) &currCluster)) != 0)
       return status;
     /*Update next cluster, if exists*/
-    if(currCluster.next != NULL_CLUSTER)
+    if(currCluster->next != NULL_CLUSTER)
     {
-      nextPhysical = currCluster.next * BLOCKS_PER_CLUSTER + sb->dzone_start;
-      if((status = soReadCacheCluster(nextPhysical, &nextCluster)) != 0)
+      nextPhysical = currCluster->next * BLOCKS_PER_CLUSTER + sb->dzone_start;
+      if((status = soPinCacheCluster(nextPhysical, (void **) &nextCluster)) != 0)
+      {
+        soUnpinCacheCluster(currPhysical);
         return status;
-      nextCluster.prev = NULL_CLUSTER;
-      if((status = soWriteCacheCluster(nextPhysical, &nextCluster)) != 0)
+      }
+      nextCluster->prev = NULL_CLUSTER;
+      status = soMarkCacheClusterChanged(nextPhysical);
+      soUnpinCacheCluster(nextPhysical);
+      if(status != 0)
+      {
+        soUnpinCacheCluster(currPhysical);
         return status;
+      }
     }
     /*Insert cluster in auxiliary array*/
     auxArray[n] = sb->dhead; n++;
-    sb->dhead = currCluster.next;
+    sb->dhead = currCluster->next;
     /*Update current cluster*/
-    currCluster.next = NULL_CLUSTER;
-    if((status = soWriteCacheCluster(currPhysical, &currCluster)) != 0)
+    currCluster->next = NULL_CLUSTER;
+    status = soMarkCacheClusterChanged(currPhysical);
+    soUnpinCacheCluster(currPhysical);
+    if(status != 0)
       return status;
     /*Check general repository consistency*/
     if(sb->dhead == NULL_CLUSTER)
@@ -228,8 +249,8 @@ static int soDeplete(SOSuperBlock *sb)
   uint32_t index;
   uint32_t tailPhysical;
   uint32_t insertPhysical;
-  SODataClust tailCluster;
-  SODataClust insertCluster;
+  SODataClust *tailCluster;		/*pinned in the buffercache*/
+  SODataClust *insertCluster;		/*pinned in the buffercache*/
 
   /** Parameter check **/
   if(sb == NULL)
@@ -256,18 +277,23 @@ static int soDeplete(SOSuperBlock *sb)
     tailPhysical = sb->dtail * BLOCKS_PER_CLUSTER + sb->dzone_start;
     insertPhysical = sb->dzone_insert.cache[index] * BLOCKS_PER_CLUSTER + sb->dzone_start;
     /*Read data clusters*/
-    if((status = soReadCacheCluster(tailPhysical, &tailCluster)) != 0)
+    if((status = soPinCacheCluster(tailPhysical, (void **) &tailCluster)) != 0)
       return status;
-    if((status = soReadCacheCluster(insertPhysical, &insertCluster)) != 0)
+    if((status = soPinCacheCluster(insertPhysical, (void **) &insertCluster)) != 0)
+    {
+      soUnpinCacheCluster(tailPhysical);
       return status;
+    }
     /*Update clusters information*/
-    tailCluster.next = sb->dzone_insert.cache[index];
-    insertCluster.prev = sb->dtail;
-    insertCluster.next = NULL_CLUSTER; /*Unnecessary*/
-    /*Write data clusters*/
-    if((status = soWriteCacheCluster(tailPhysical, &tailCluster)) != 0)
-      return status;
-    if((status = soWriteCacheCluster(insertPhysical, &insertCluster)) != 0)
+    tailCluster->next = sb->dzone_insert.cache[index];
+    insertCluster->prev = sb->dtail;
+    insertCluster->next = NULL_CLUSTER; /*Unnecessary*/
+    /*Mark data clusters as changed*/
+    if((status = soMarkCacheClusterChanged(tailPhysical)) == 0)
+      status = soMarkCacheClusterChanged(insertPhysical);
+    soUnpinCacheCluster(insertPhysical);
+    soUnpinCacheCluster(tailPhysical);
+    if(status != 0)
       return status;
     /*Update superblock*/
     sb->dtail = sb->dzone_insert.cache[index];
@@ -77,6 +77,8 @@ int soAllocInode (uint32_t type, uint32_t* p_nInode)
   uint32_t nextBlock;
   uint32_t headOffset;
   uint32_t nextOffset;
+  uint32_t headHdl;
+  uint32_t nextHdl;
   uint32_t nInode;
 
   /** Parameter check **/
@@ -92,7 +94,7 @@ int soAllocInode (uint32_t type, uint32_t* p_nInode)
     return -EBADF;
 
   /** Inode table consistency check **/
-  if((status = soQCheckInT(sb)) != 0)
+  if(soBeginCheck(CHECK_ON_USE) && ((status = soEndCheck(soQCheckInT(sb))) != 0))
     return status;
 
   /** Check if there are free inodes **/
@@ -102,14 +104,17 @@ int soAllocInode (uint32_t type, uint32_t* p_nInode)
   /** Obtain Block number and inode offset **/
   if((status = soConvertRefInT(sb->ihead, &headBlock, &headOffset)) != 0)
     return status;
-  /** Read head inode from inode table **/
-  if((status = soLoadBlockInT(headBlock)) != 0)
+  /** Acquire the block of the head inode, which is held until the inode is allocated **/
+  if((status = soPinBlockInT(headBlock, &headHdl)) != 0)
     return status;
-  headInode = soGetBlockInT();
+  headInode = soGetBlockInTH(headHdl);
 
   /** Check if inode is free **/
-  if((status = soQCheckFInode(&headInode[headOffset])) != 0)
+  if(soBeginCheck(CHECK_ON_USE) && ((status = soEndCheck(soQCheckFInode(&headInode[headOffset]))) != 0))
+  {
+    soUnpinBlockInT(headHdl);
     return status;
+  }
 
   /** Allocated inode number **/
   nInode = sb->ihead;  
@@ -126,41 +131,41 @@ int soAllocInode (uint32_t type, uint32_t* p_nInode)
   /** Update next inode information **/
   if(sb->ihead != NULL_INODE)
   {
-    if((status = soConvertRefInT(sb->ihead, &nextBlock, &nextOffset)) != 0)
-      return status;
-    if((status = soLoadBlockInT(nextBlock)) != 0)
+    if((status = soConvertRefInT(sb->ihead, &nextBlock, &nextOffset)) == 0)
+      status = soPinBlockInT(nextBlock, &nextHdl);
+    if(status != 0)
+    {
+      soUnpinBlockInT(headHdl);
       return status;
-    nextInode = soGetBlockInT();
+    }
+    nextInode = soGetBlockInTH(nextHdl);
     nextInode[nextOffset].vD2.prev = NULL_INODE;
-    if((status = soStoreBlockInT()) != 0)
+    status = soStoreBlockInTH(nextHdl);
+    soUnpinBlockInT(nextHdl);
+    if(status != 0)
+    {
+      soUnpinBlockInT(headHdl);
       return status;
+    }
   }
 
   /** Update and write superblock **/
   sb->ifree--;
   if((status = soStoreSuperBlock()) != 0)
+  {
+    soUnpinBlockInT(headHdl);
     return status;
-
-  /** "Re-Obtain" Block number and inode offset **/
-  if((status = soConvertRefInT(nInode, &headBlock, &headOffset)) != 0)
-    return status;
-  /** "Re-Read" head inode from inode table **/
-  if((status = soLoadBlockInT(headBlock)) != 0)
-    return status;
-  headInode = soGetBlockInT();
+  }
 
   /** Check if headInode is in dirty state **/
+  /*Cleaning changes the block in place, so the held block needs not to be read again*/
   if((status = soQCheckFCInode(&headInode[headOffset])) != 0)
   {
-    if((status = soCleanInode(headBlock * IPB + headOffset)) != 0)
-      return status;
-    /*Since inode was updated, it will be readed again*/
-    if((status = soConvertRefInT(nInode, &headBlock, &headOffset)) != 0)
+    if((status = soCleanInode(nInode)) != 0)
+    {
+      soUnpinBlockInT(headHdl);
       return status;
-    /*Read head inode from inode table*/
-    if((status = soLoadBlockInT(headBlock)) != 0)
-      return status;
-    headInode = soGetBlockInT();
+    }
   }
 
   /** Allocate headInode **/
@@ -174,10 +179,12 @@ int soAllocInode (uint32_t type, uint32_t* p_nInode)
   headInode[headOffset].vD2.mtime = headInode[headOffset].vD1.atime;
 
   /*Write updated inode information to disk*/
-  if((status = soStoreBlockInT()) != 0)
-    return status;
+  status = soStoreBlockInTH(headHdl);
   /*Consistency check*/
-  if((status = soQCheckInodeIU(sb, &headInode[headOffset])) != 0)
+  if((status == 0) && soBeginCheck(CHECK_ON_USE))
+    status = soEndCheck(soQCheckInodeIU(sb, &headInode[headOffset]));
+  soUnpinBlockInT(headHdl);
+  if(status != 0)
     return status;
 
   /** Operation successful **/
@@ -62,7 +62,7 @@ int soFreeDataCluster (uint32_t nClust)
   int status;
   uint32_t physCluster;
   uint32_t stat;
-  SODataClust freeCluster;
+  SODataClust *freeCluster;		/*pinned in the buffercache*/
   SOSuperBlock *sb; 
 
   /** Loading SuperBlock **/
@@ -88,11 +88,13 @@ int soFreeDataCluster (uint32_t nClust)
   
   /** Free Cluster **/
   physCluster = nClust * BLOCKS_PER_CLUSTER + sb->dzone_start;
-  if((status = soReadCacheCluster(physCluster, &freeCluster)) != 0)
+  if((status = soPinCacheCluster(physCluster, (void **) &freeCluster)) != 0)
     return status;
-  freeCluster.prev = NULL_CLUSTER;
-  freeCluster.next = NULL_CLUSTER;
-  if((status = soWriteCacheCluster(physCluster, &freeCluster)) != 0)
+  freeCluster->prev = NULL_CLUSTER;
+  freeCluster->next = NULL_CLUSTER;
+  status = soMarkCacheClusterChanged(physCluster);
+  soUnpinCacheCluster(physCluster);
+  if(status != 0)
     return status;
 
   /** Update Superblock **/
@@ -113,8 +115,8 @@ static int soDeplete(SOSuperBlock *sb){
   uint32_t index;
   uint32_t tailPhysical;
   uint32_t insertPhysical;
-  SODataClust tailCluster;
-  SODataClust insertCluster;
+  SODataClust *tailCluster;		/*pinned in the buffercache*/
+  SODataClust *insertCluster;		/*pinned in the buffercache*/
 
   /** Parameter check **/
   if(sb == NULL)
@@ -141,18 +143,23 @@ static int soDeplete(SOSuperBlock *sb){
     tailPhysical = sb->dtail * BLOCKS_PER_CLUSTER + sb->dzone_start;
     insertPhysical = sb->dzone_insert.cache[index] * BLOCKS_PER_CLUSTER + sb->dzone_start;
     /*Read data clusters*/
-    if((status = soReadCacheCluster(tailPhysical, &tailCluster)) != 0)
+    if((status = soPinCacheCluster(tailPhysical, (void **) &tailCluster)) != 0)
       return status;
-    if((status = soReadCacheCluster(insertPhysical, &insertCluster)) != 0)
+    if((status = soPinCacheCluster(insertPhysical, (void **) &insertCluster)) != 0)
+    {
+      soUnpinCacheCluster(tailPhysical);
       return status;
+    }
     /*Update clusters information*/
-    tailCluster.next = sb->dzone_insert.cache[index];
-    insertCluster.prev = sb->dtail;
-    insertCluster.next = NULL_CLUSTER; /*Unnecessary*/
-    /*Write data clusters*/
-    if((status = soWriteCacheCluster(tailPhysical, &tailCluster)) != 0)
-      return status;
-    if((status = soWriteCacheCluster(insertPhysical, &insertCluster)) != 0)
+    tailCluster->next = sb->dzone_insert.cache[index];
+    insertCluster->prev = sb->dtail;
+    insertCluster->next = NULL_CLUSTER; /*Unnecessary*/
+    /*Mark data clusters as changed*/
+    if((status = soMarkCacheClusterChanged(tailPhysical)) == 0)
+      status = soMarkCacheClusterChanged(insertPhysical);
+    soUnpinCacheCluster(insertPhysical);
+    soUnpinCacheCluster(tailPhysical);
+    if(status != 0)
       return status;
     /*Update superblock*/
     sb->dtail = sb->dzone_insert.cache[index];
@@ -81,7 +81,7 @@ int soFreeInode (uint32_t nInode)
     return -EINVAL;
 
   /** Inode table consistency check **/
-  if((status = soQCheckInT(sb)) != 0)
+  if(soBeginCheck(CHECK_ON_USE) && ((status = soEndCheck(soQCheckInT(sb))) != 0))
     return status;
 
   /** Read inode to be freed **/
@@ -93,7 +93,7 @@ int soFreeInode (uint32_t nInode)
     return -ELIBBAD;
 
   /** Check if inode is in use **/
-  if((status = soQCheckInodeIU(sb, &freeInode[freeOffset])) != 0)
+  if(soBeginCheck(CHECK_ON_USE) && ((status = soEndCheck(soQCheckInodeIU(sb, &freeInode[freeOffset]))) != 0))
     return status;
 
   /** Check if inode belongs one of the legal file types  **/
@@ -91,7 +91,7 @@ int soAccessGranted (uint32_t nInode, uint32_t opRequested)
     return status;
 
   /* Check if inode is in use */
-  if ((status = soQCheckInodeIU(sb, &inode)) != 0)
+  if (soBeginCheck(CHECK_ON_USE) && ((status = soEndCheck(soQCheckInodeIU(sb, &inode))) != 0))
     return status;
 
   /** Check if inode belongs one of the legal file types  **/
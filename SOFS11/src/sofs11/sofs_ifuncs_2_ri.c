@@ -66,7 +66,8 @@ int soReadInode (SOInode *p_inode, uint32_t nInode, uint32_t status)
 
   /** Variables **/
   int error;
-  uint32_t nBlock, Offset;
+  uint32_t hdl;
+  int checked;
   SOInode *readInode;
   SOSuperBlock *sb;
 
@@ -82,36 +83,37 @@ int soReadInode (SOInode *p_inode, uint32_t nInode, uint32_t status)
   if((status != IUIN) && (status != FDIN))
     return -EINVAL;
 
-  /** Read inode **/
-  if((error = soConvertRefInT(nInode, &nBlock, &Offset)) != 0)
+  /** Read inode, from the in-core inodes **/
+  if((error = soPinInode(nInode, &hdl)) != 0)
     return error;
-  if((error = soLoadBlockInT(nBlock)) != 0)
-    return error;
-  if((readInode = soGetBlockInT()) == NULL)
-    return -ELIBBAD;
+  readInode = soGetInodeH(hdl);
 
-  /** Consistency check **/
-  if(status == IUIN)
+  /** Consistency check, unless the in-core inode was already found consistent **/
+  checked = (soCheckedInodeH(hdl, status) == 1);
+  if(!checked && soBeginCheck(CHECK_ON_LOAD))
+  {
+    if(status == IUIN)
+      error = soEndCheck(soQCheckInodeIU(sb, readInode));
+    else
+      error = soEndCheck(soQCheckFDInode(sb, readInode));
+    checked = (error == 0);
+  }
+  /*If Inode in use, update time of last file access*/
+  if((error == 0) && (status == IUIN))
   {
-    if((error = soQCheckInodeIU(sb, &readInode[Offset])) != 0)
-      return error;
-    /*If Inode in use, update time of last file access*/
-    readInode[Offset].vD1.atime = time(NULL);
-    if((error = soStoreBlockInT()) != 0)
-      return error;
-    /** Read inode **/
-    if((error = soConvertRefInT(nInode, &nBlock, &Offset)) != 0)
-      return error;
-    if((error = soLoadBlockInT(nBlock)) != 0)
-      return error;
-    if((readInode = soGetBlockInT()) == NULL)
-      return -ELIBBAD;
+    readInode->vD1.atime = time(NULL);
+    error = soStoreInodeH(hdl);
   }
-  else
-    if((error = soQCheckFDInode(sb, &readInode[Offset])) != 0)
-      return error;
 
-  *p_inode = readInode[Offset];
+  if(error == 0)
+  {
+    *p_inode = *readInode;
+    if(checked)
+      error = soSetCheckedInodeH(hdl, status);
+  }
+  soUnpinInode(hdl);
+  if(error != 0)
+    return error;
 
   /** Operation successful **/
   return 0;
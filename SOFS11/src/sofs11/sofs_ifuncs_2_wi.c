@@ -23,6 +23,7 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 #include <errno.h>
 #include <inttypes.h>
 #include <time.h>
@@ -37,6 +38,10 @@
 #include "sofs_basicconsist.h"
 #include "sofs_ifuncs_2.h"
 
+/* Allusion to internal functions */
+
+static int soCheckInode (SOSuperBlock *p_sb, SOInode *p_inode, uint32_t status);
+
 /**
  *  \brief Write specific inode data to the table of inodes.
  *
@@ -66,10 +71,10 @@ int soWriteInode (SOInode *p_inode, uint32_t nInode, uint32_t status)
   soProbe (312, "soWriteInode (%p, %"PRIu32", %"PRIu32")\n", p_inode, nInode, status);
 
   int stat; /* status variable for error checking */
-  SOInode *inodeTblk; /* pointer to the block where the inode table's segment
-                         which is going to be used belongs */
-  uint32_t nBlk; /* block number */
-  uint32_t offset; /* offset withing the fetched block*/
+  SOInode *inodeInC; /* pointer to the in-core inode */
+  SOInode inode; /* given inode, with the times of the in-core inode */
+  uint32_t hdl; /* handle to the in-core inode */
+  int checked; /* the inode written is known to be consistent */
   SOSuperBlock* p_sb;
 
   /* checking if the given inode pointer is NULL */
@@ -87,21 +92,82 @@ int soWriteInode (SOInode *p_inode, uint32_t nInode, uint32_t status)
     return -EINVAL;
 
   /* checking status parameter integrity */
-  switch (status)
-    {
-    case IUIN:
-      if ( (stat = soQCheckInodeIU(p_sb, p_inode)) != 0 )
-        return stat;
-      break;
+  if ( (status != IUIN) && (status != FDIN) )
+    return -EINVAL;
 
-    case FDIN:
-      if ( (stat = soQCheckFDInode(p_sb, p_inode)) != 0 )
-        return stat;
-      break;
+  /* getting inode from the in-core inodes */
+  if ( (stat = soPinInode(nInode, &hdl)) != 0 )
+    return stat;
 
-    default:
-      return -EINVAL;
+  inodeInC = soGetInodeH(hdl);
+
+  /* checking the given inode, unless, but for the times of last access and modification, it matches the in-core
+     inode and this one was already found consistent (as when an inode just read is written back unchanged), or the
+     consistency-check level does not require it */
+  inode = *p_inode;
+  if (status == IUIN)
+  {
+    inode.vD1.atime = inodeInC->vD1.atime;
+    inode.vD2.mtime = inodeInC->vD2.mtime;
+  }
+  checked = (soCheckedInodeH(hdl, status) == 1) && (memcmp(&inode, inodeInC, sizeof(SOInode)) == 0);
+  if ( !checked && soBeginCheck(CHECK_ON_USE) )
+  {
+    if ( (stat = soEndCheck(soCheckInode(p_sb, p_inode, status))) != 0 )
+    {
+      soUnpinInode(hdl);
+      return stat;
     }
+    checked = 1;
+  }
+
+  /* writing into the in-core inode */
+  *inodeInC = *p_inode;
+
+  if(status == IUIN)
+  {
+    inodeInC->vD1.atime = time(NULL);
+    inodeInC->vD2.mtime = inodeInC->vD1.atime;
+  }
+
+  if ( ((stat = soStoreInodeH(hdl)) == 0) && checked )
+    stat = soSetCheckedInodeH(hdl, status);
+  soUnpinInode(hdl);
+  if (stat != 0)
+    return stat;
+
+  return 0;
+}
+
+/**
+ *  \brief Check the consistency of an inode in a given status and if it belongs to one of the legal file types.
+ *
+ *  \param p_sb pointer to a buffer where the superblock data is stored
+ *  \param p_inode pointer to the buffer containing the inode data
+ *  \param status inode status (in use / free in the dirty state)
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -\c EIUININVAL, if the inode in use is inconsistent
+ *  \return -\c EFDININVAL, if the free inode in the dirty state is inconsistent
+ *  \return -\c ELDCININVAL, if the list of data cluster references belonging to an inode is inconsistent
+ *  \return -\c EDCINVAL, if the data cluster header is inconsistent
+ *  \return -\c ELIBBAD, if some kind of inconsistency was detected at some internal storage lower level
+ *  \return -\c EBADF, if the device is not already opened
+ *  \return -\c EIO, if it fails reading or writing
+ *  \return -<em>other specific error</em> issued by \e lseek system call
+ */
+
+static int soCheckInode (SOSuperBlock *p_sb, SOInode *p_inode, uint32_t status)
+{
+  int stat; /* status variable for error checking */
+
+  /* checking the inode in the given status */
+  if (status == IUIN)
+    stat = soQCheckInodeIU(p_sb, p_inode);
+  else
+    stat = soQCheckFDInode(p_sb, p_inode);
+  if (stat != 0)
+    return stat;
 
   /* checking if the given inode belongs to a legal file type */
   switch (p_inode->mode & INODE_TYPE_MASK)
@@ -118,28 +184,5 @@ int soWriteInode (SOInode *p_inode, uint32_t nInode, uint32_t status)
       return -EFDININVAL;
     }
 
-  /* getting inode from the inode table */
-  if ( (stat = soConvertRefInT(nInode, &nBlk, &offset)) != 0 )
-    return stat;
-
-  if ( (stat = soLoadBlockInT(nBlk)) != 0 )
-    return stat;
-
-  inodeTblk = soGetBlockInT();
-  if (inodeTblk == NULL)
-    return -ELIBBAD;
-
-  /* writing into inode table */
-  inodeTblk[offset] = *p_inode;
-
-  if(status == IUIN)
-  {
-    inodeTblk[offset].vD1.atime = time(NULL);
-    inodeTblk[offset].vD2.mtime = inodeTblk[offset].vD1.atime;
-  }
-
-  if ( (stat = soStoreBlockInT()) != 0 )
-    return stat;
-
   return 0;
 }
@@ -763,24 +763,29 @@ static int soCleanLogicalCluster (SOSuperBlock *p_sb, uint32_t nInode, uint32_t
   /** Variables **/
   uint32_t error;
   uint32_t physCluster; /*physical number of the data cluster*/
-  SODataClust cleanCluster;
+  SODataClust *cleanCluster; /*pinned in the buffercache*/
 
   physCluster = p_sb->dzone_start + nLClust * BLOCKS_PER_CLUSTER;
 
-  /** Read cluster **/
-  if((error = soReadCacheCluster(physCluster, &cleanCluster)) != 0)
+  /** Pin cluster **/
+  if((error = soPinCacheCluster(physCluster, (void **) &cleanCluster)) != 0)
     return error;
 
   /** Inode check **/
-  if(cleanCluster.stat != nInode)
+  if(cleanCluster->stat != nInode)
+  {
+    soUnpinCacheCluster(physCluster);
     return -EWGINODENB;
+  }
 
   /** Clean cluster **/
-  memset(&(cleanCluster.info), 0, BSLPC);
-  cleanCluster.stat = NULL_INODE;
+  memset(&(cleanCluster->info), 0, BSLPC);
+  cleanCluster->stat = NULL_INODE;
 
-  /** Write cluster **/
-  if((error = soWriteCacheCluster(physCluster, &cleanCluster)) != 0)
+  /** Mark cluster as changed **/
+  error = soMarkCacheClusterChanged(physCluster);
+  soUnpinCacheCluster(physCluster);
+  if(error != 0)
     return error;
 
   /** Operation successful **/
@@ -77,7 +77,7 @@ int soWriteFileCluster (uint32_t nInode, uint32_t clustInd, void *buff)
   uint32_t logClustNum;
   uint32_t phyClustNum;
   SOSuperBlock *sb;
-  SODataClust Cluster;
+  SODataClust *Cluster; /*pinned in the buffercache*/
   SOInode inode;
 
   /** Loading SuperBlock **/
@@ -113,14 +113,16 @@ int soWriteFileCluster (uint32_t nInode, uint32_t clustInd, void *buff)
     if((error = soHandleFileCluster(nInode, clustInd, ALLOC, &logClustNum)) != 0)
       return error;
 
-  /** Read data cluster **/
+  /** Pin data cluster **/
   phyClustNum = logClustNum * BLOCKS_PER_CLUSTER + sb->dzone_start;
-  if((error = soReadCacheCluster(phyClustNum, &Cluster)) != 0)
+  if((error = soPinCacheCluster(phyClustNum, (void **) &Cluster)) != 0)
     return error;
 
-  /** Update and write data cluster **/
-  memcpy(&Cluster.info, buff, BSLPC);
-  if((error = soWriteCacheCluster(phyClustNum, &Cluster)) != 0)
+  /** Update data cluster in place **/
+  memcpy(&Cluster->info, buff, BSLPC);
+  error = soMarkCacheClusterChanged(phyClustNum);
+  soUnpinCacheCluster(phyClustNum);
+  if(error != 0)
     return error;
 
   /** Operation successful **/
@@ -132,7 +132,7 @@ int soAddDirEntry (uint32_t nInodeDir, const char *eName, uint32_t nInodeEnt)
     return -ENOTDIR;
 
   /** Check InodeDir consistency **/
-  if((error = soQCheckDirCont(sb, &InodeDir)) != 0)
+  if(soBeginCheck(CHECK_ON_USE) && ((error = soEndCheck(soQCheckDirCont(sb, &InodeDir))) != 0))
     return error;
 
   /** Check if an entry with eName already exists **/
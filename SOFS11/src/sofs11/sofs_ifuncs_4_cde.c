@@ -106,7 +106,7 @@ int soCheckDirectoryEmptiness (uint32_t nInodeDir)
     return -ENOTDIR;
 
   /** Check directory consistency **/
-  if((error = soQCheckDirCont(sb, &InodeDir)) != 0)
+  if(soBeginCheck(CHECK_ON_USE) && ((error = soEndCheck(soQCheckDirCont(sb, &InodeDir))) != 0))
     return error;
 
   /** Get number of clusters the directory uses **/
@@ -221,7 +221,7 @@ static int soTraversePath(SOSuperBlock *p_sb,
     return -ENOTDIR;
 
   /** Check parent directory consistency **/
-  if((error = soQCheckDirCont(p_sb, &InodeDir)) != 0)
+  if(soBeginCheck(CHECK_ON_USE) && ((error = soEndCheck(soQCheckDirCont(p_sb, &InodeDir))) != 0))
     return error;
 
   /** Check execution permission on parent directory **/
@@ -133,7 +133,7 @@ int soRemoveDirEntry (uint32_t nInodeDir, const char *eName)
   }
 
   /** Check the dirEntry consistence **/
-  if ((status = soQCheckDirCont(sb, &inodeDir)) !=0)
+  if (soBeginCheck(CHECK_ON_USE) && ((status = soEndCheck(soQCheckDirCont(sb, &inodeDir))) != 0))
     return status;
 
   /** Getting nInodeEnt and idx of dirEntry **/
@@ -119,7 +119,7 @@ int soRenameDirEntry (uint32_t nInodeDir, const char *oldName, const char *newNa
     return -ENOTDIR;
 
   /** Check directory consistency **/
-  if((error = soQCheckDirCont(sb, &InodeDir)) != 0)
+  if(soBeginCheck(CHECK_ON_USE) && ((error = soEndCheck(soQCheckDirCont(sb, &InodeDir))) != 0))
     return error;
 
   /** Check write and execution permissions on directory **/
@@ -38,6 +38,7 @@
 #ifndef SOFS_SYSCALLS_H_
 #define SOFS_SYSCALLS_H_
 
+#include <stdint.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/types.h>
@@ -53,12 +54,14 @@
  *  A buffered communication channel is established with the storage device.
  *  The superblock is read and it is checked if the file system was properly unmounted the last time it was mounted. If
  *  not, a consistency check is performed (presently, the check is superficial, a more thorough one is required).
+ *  The operating mode states, namely, the durability of the data written to the storage device (see sofs_rawdisk.h).
  *
  *  \param devname absolute path to the Linux file that simulates the storage device
+ *  \param mode operating mode of the storage device (\c DEV_SYNC, \c DEV_DATASYNC or \c DEV_UNSAFE)
  *
  *  \return <tt>0 (zero)</tt>, on success
- *  \return -\c EINVAL, if the <em>device path</em> is a \c NULL string or the magic number is not the one
- *                      characteristic of SOFS11
+ *  \return -\c EINVAL, if the <em>device path</em> is a \c NULL string, the magic number is not the one
+ *                      characteristic of SOFS11 or the operating mode is invalid
  *  \return -\c ENAMETOOLONG, if the absolute path exceeds the maximum allowed length
  *  \return -\c EBUSY, if the storage area is already in use or the device is already opened
  *  \return -\c EIO, if it fails on writing
@@ -66,7 +69,7 @@
  *  \return -<em>other specific error</em> issued by \e lseek system call
  */
 
-extern int soMountSOFS (const char *devname);
+extern int soMountSOFS (const char *devname, uint32_t mode);
 
 /**
  *  \brief Unmount the SOFS10 file system.
@@ -314,6 +317,7 @@ extern int soClose (const char *ePath);
  *  \brief Synchronize a file's in-core state with storage device.
  *
  *  It tries to emulate <em>fsync</em> system call.
+ *  Afterwards, the storage device is itself synchronized, as required by its durability mode.
  *
  *  \param ePath path to the file
  *
@@ -65,6 +65,9 @@
 #include "sofs_ifuncs_3.h"
 #include "sofs_ifuncs_4.h"
 
+/* Allusion to internal functions */
+
+static int checkMetadata (void);
 
 /**
  *  \brief Mount the SOFS10 file system.
@@ -72,24 +75,43 @@
  *  A buffered communication channel is established with the storage device.
  *  The superblock is read and it is checked if the file system was properly unmounted the last time it was mounted. If
  *  not, a consistency check is performed (presently, the check is superficial, a more thorough one is required).
+ *  Then, unless the consistency-check level is \c CHECK_OFF, the superblock, the table of inodes, the data zone and
+ *  the root directory are checked once: if they are found inconsistent, the storage device is closed and the file
+ *  system is kept marked as not properly unmounted.
+ *  The operating mode states, namely, the durability of the data written to the storage device (see sofs_rawdisk.h).
  *
  *  \param devname absolute path to the Linux file that simulates the storage device
+ *  \param mode operating mode of the storage device (\c DEV_SYNC, \c DEV_DATASYNC or \c DEV_UNSAFE)
  *
  *  \return <tt>0 (zero)</tt>, on success
- *  \return -\c EINVAL, if the <em>device path</em> is a \c NULL string or the magic number is not the one
- *                      characteristic of SOFS11
+ *  \return -\c EINVAL, if the <em>device path</em> is a \c NULL string, the magic number is not the one
+ *                      characteristic of SOFS11 or the operating mode is invalid
  *  \return -\c ENAMETOOLONG, if the absolute path exceeds the maximum allowed length
  *  \return -\c EBUSY, if some kind of inconsistency was detected at some internal storage lower level
  *  \return -\c EIO, if it fails on writing
  *  \return -\c ELIBBAD, if the supporting file size is invalid or the file system is inconsistent
  *  \return -<em>other specific error</em> issued by \e lseek system call
  */
-int soMountSOFS (const char *devname)
+int soMountSOFS (const char *devname, uint32_t mode)
 {
-  soProbe (61, "soMountSOFS (\"%s\")\n", devname);
+  soProbe (61, "soMountSOFS (\"%s\", %"PRIu32")\n", devname, mode);
+
+  int stat;                                      /* status of operation */
+
+  if ((stat = soSetBufferCacheMode (mode)) != 0) return stat;
 
   int soMountSOFS_bin (const char *devname);
-  return soMountSOFS_bin(devname);
+  if ((stat = soMountSOFS_bin(devname)) != 0) return stat;
+  soSetMounted (1);                              /* superblock writes are deferred from now on */
+
+  if (soBeginCheck (CHECK_ON_LOAD) && ((stat = soEndCheck (checkMetadata ())) != 0))
+     { soSetMounted (0);
+       soCloseBufferCache ();
+       soResetBasicOper ();                      /* what was kept in internal storage points into the closed cache */
+       return stat;
+     }
+
+  return 0;
 }
 
 /**
@@ -97,7 +119,8 @@ int soMountSOFS (const char *devname)
  *
  *  The buffered communication channel previously established with the storage device is closed. This means, namely,
  *  that the contents of the storage area is flushed into the storage device to keep data update. Before that, however,
- *  the mount flag of the superblock is set to <em>properly unmounted</em>.
+ *  the mount flag of the superblock is set to <em>properly unmounted</em>. Afterwards, whatever was kept in internal
+ *  storage by the basic operations is forgotten, so the file system may be mounted again.
  *
  *  \return <tt>0 (zero)</tt>, on success
  *  \return -\c ELIBBAD, if some kind of inconsistency was detected at some internal storage lower level
@@ -109,8 +132,15 @@ int soUnmountSOFS (void)
 {
   soProbe (62, "soUnmountSOFS ()\n");
 
+  int stat;                                      /* status of operation */
+
+  if ((stat = soSetMounted (0)) != 0) return stat;   /* pending changes are written and later ones go through */
+
   int soUnmountSOFS_bin (void);
-  return soUnmountSOFS_bin();
+  stat = soUnmountSOFS_bin();
+  soResetBasicOper ();                           /* what was kept in internal storage points into the closed cache */
+
+  return stat;
 }
 
 /**
@@ -383,6 +413,7 @@ int soClose (const char *ePath)
  *  \brief Synchronize a file's in-core state with storage device.
  *
  *  It tries to emulate <em>fsync</em> system call.
+ *  Afterwards, the storage device is itself synchronized, as required by its durability mode.
  *
  *  \param ePath path to the file
  *
@@ -403,8 +434,14 @@ int soFsync (const char *ePath)
 {
   soProbe (71, "soFsync (\"%s\")\n", ePath);
 
+  int stat;                                      /* status of operation */
+
   int soFsync_bin (const char *ePath);
-  return soFsync_bin(ePath);
+  if ((stat = soFsync_bin(ePath)) != 0) return stat;
+
+  if ((stat = soSyncInodes ()) != 0) return stat;
+  if ((stat = soSyncSuperBlock ()) != 0) return stat;
+  return soSyncBufferCache ();                   /* force written data to stable storage */
 }
 
 /**
@@ -464,3 +501,32 @@ int soClosedir (const char *ePath)
   int soClosedir_bin (const char *ePath);
   return soClosedir_bin(ePath);
 }
+
+/**
+ *  \brief Check the metadata of the file system as a whole.
+ *
+ *  The superblock, the table of inodes and the data zone are checked, and so are the root directory inode and its
+ *  contents. The root directory inode is then recorded as found consistent.
+ *
+ *  \return <tt>0 (zero)</tt>, on success
+ *  \return -<em>specific error</em> issued by the consistency checks or the internal storage lower levels
+ */
+static int checkMetadata (void)
+{
+  SOSuperBlock *p_sb;                            /* pointer to the superblock */
+  uint32_t hdl;                                  /* handle to the root directory inode */
+  int stat;                                      /* status of operation */
+
+  if ((stat = soLoadSuperBlock ()) != 0) return stat;
+  p_sb = soGetSuperBlock ();
+  if (((stat = soQCheckSuperBlock (p_sb)) != 0) || ((stat = soQCheckInT (p_sb)) != 0) ||
+      ((stat = soQCheckDZ (p_sb)) != 0))
+     return stat;
+
+  if ((stat = soPinInode (0, &hdl)) != 0) return stat;
+  if ((stat = soQCheckDirCont (p_sb, soGetInodeH (hdl))) == 0)
+     stat = soSetCheckedInodeH (hdl, IUIN);
+  soUnpinInode (hdl);
+
+  return stat;
+}
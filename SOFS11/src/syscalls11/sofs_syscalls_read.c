@@ -120,9 +120,13 @@ int soRead (const char *ePath, void *buff, uint32_t count, int32_t pos)
     // leitura do inode
     if ( (stat = soReadInode(&inode, nInodeEnt, IUIN)) != 0) return stat;
     
-    // verificação do inode
-    if((stat = soQCheckDirCont(sb, &inode)) == 0) return -EISDIR;
-    if(stat != -ENOTDIR) return stat;
+    // verificação do inode (basta o tipo, se o nível de verificação da consistência não a exigir)
+    if(soBeginCheck(CHECK_ON_USE))
+    {
+      if((stat = soEndCheck(soQCheckDirCont(sb, &inode))) == 0) return -EISDIR;
+      if(stat != -ENOTDIR) return stat;
+    }
+    else if((inode.mode & INODE_TYPE_MASK) == INODE_DIR) return -EISDIR;
     
     // verifica se o pos esta fora do ficheiro
     if (pos > inode.size) return -EFBIG;
@@ -120,10 +120,15 @@ int soWrite (const char *ePath, void *buff, uint32_t count, int32_t pos)
   /* Obtem o Inode associado ao ePath e verifica se há erros */
   if((stat = soGetDirEntryByPath(ePath, NULL, &nInodeEnt)) != 0) return stat;
  
-  /* Leitura e verificação do inode (tem que ser um ficheiro) */
+  /* Leitura e verificação do inode (tem que ser um ficheiro; basta o tipo, se o nível de verificação da consistência
+     não a exigir) */
   if((stat = soReadInode(&inode, nInodeEnt, IUIN)) != 0) return stat;
-  if((stat = soQCheckDirCont(p_sb, &inode)) == 0) return -EISDIR;
-  if(stat != -ENOTDIR) return stat;
+  if(soBeginCheck(CHECK_ON_USE))
+  {
+    if((stat = soEndCheck(soQCheckDirCont(p_sb, &inode))) == 0) return -EISDIR;
+    if(stat != -ENOTDIR) return stat;
+  }
+  else if((inode.mode & INODE_TYPE_MASK) == INODE_DIR) return -EISDIR;
   
   /* Se o count for 0, nada é escrito */
   if(count == 0) return 0;
@@ -38,6 +38,8 @@
 
                   OPTIONS:
                    -b       --- set batch mode (default: not batch)
+                   -s       --- print raw device transfer statistics on exit (default: not printed)
+                   -S spec  --- simulate a slower device, spec is lat:bw:seek (default: no simulation)
                    -l depth --- set log depth (default: 0,0)
                    -L file  --- log file (default: stdout)
                    -h       --- print this help.</PRE>
@@ -65,6 +67,7 @@
 
 #include "sofs_probe.h"
 #include "sofs_const.h"
+#include "sofs_rawdisk.h"
 #include "sofs_buffercache.h"
 #include "sofs_superblock.h"
 #include "sofs_inode.h"
@@ -196,13 +199,15 @@ int main (int argc, char *argv[])
 {
   int lower = 0;                                 /* lower limit of log depth, if kept set to zero */
   int higher = 0;                                /* upper limit of log depth, if kept set to zero */
+  int stats = 0;                                 /* statistics mode, if kept set statistics are not printed */
+  SORawSimulation sim;                           /* parameters of the simulated device */
 
   /* process command line options */
 
   int opt;                                       /* selected option */
 
   do
-  { switch ((opt = getopt (argc, argv, "l:L:bh")))
+  { switch ((opt = getopt (argc, argv, "l:L:bsS:h")))
     { case 'l': /* log depth */
                 if (sscanf (optarg, "%d,%d", &lower, &higher) != 2)
                    { fprintf (stderr, "%s: Bad argument to l option.\n", basename (argv[0]));
@@ -222,6 +227,16 @@ int main (int argc, char *argv[])
       case 'b': /* batch mode */
                 batch = 1;                       /* set batch mode for processing: no input messages are issued */
                 break;
+      case 's': /* statistics mode */
+                stats = 1;                       /* print the raw device transfer statistics on exit */
+                break;
+      case 'S': /* simulated device */
+                if ((soParseRawSimulation (optarg, &sim) != 0) || (soSetRawSimulation (&sim) != 0))
+                   { fprintf (stderr, "%s: Bad argument to S option.\n", basename (argv[0]));
+                     printUsage (basename (argv[0]));
+                     return EXIT_FAILURE;
+                   }
+                break;
       case 'h': /* help mode */
                 printUsage (basename (argv[0]));
                 return EXIT_SUCCESS;
@@ -243,16 +258,17 @@ int main (int argc, char *argv[])
   /* check for storage device conformity */
 
   char *devname;                                 /* path to the storage device in the Linux file system */
-  struct stat st;                                /* file attributes */
+  uint32_t nblocks;                              /* number of blocks of the storage device */
+  int stat;                                      /* status of operation */
 
-  devname = argv[optind];
-  if (stat (devname, &st) == -1)                 /* get file attributes */
-     { printError (-errno, basename (argv[0]));
+  devname = argv[optind];                        /* the storage device must have a size in bytes multiple of block
+                                                    size (or be a well formed stripe set) */
+  if ((stat = soGetDeviceSize (devname, &nblocks)) == -ELIBBAD)
+     { fprintf (stderr, "%s: Bad size of support file.\n", basename (argv[0]));
        return EXIT_FAILURE;
      }
-  if (st.st_size % BLOCK_SIZE != 0)              /* check file size: the storage device must have a size in bytes
-                                                    multiple of block size */
-     { fprintf (stderr, "%s: Bad size of support file.\n", basename (argv[0]));
+  if (stat != 0)
+     { printError (stat, basename (argv[0]));
        return EXIT_FAILURE;
      }
 
@@ -288,13 +304,17 @@ int main (int argc, char *argv[])
   }
 
 
-  /* close the unbuffered communication channel with the storage device */
+  /* close the unbuffered communication channel with the storage device, after writing any pending change of the
+     in-core inodes and of the superblock */
 
-  if ((status = soCloseBufferCache ()) != 0)
+  if (((status = soSyncInodes ()) != 0) || ((status = soSyncSuperBlock ()) != 0) ||
+      ((status = soCloseBufferCache ()) != 0))
      { printError (status, basename (argv[0]));
        return EXIT_FAILURE;
      }
 
+  if (stats != 0) soPrintRawStats (fl);
+
   /* that's all */
 
   if (batch == 0) printf ("Bye!\n");
@@ -312,6 +332,9 @@ static void printUsage (char *cmd_name)
   printf ("Sinopsis: %s [OPTIONS] supp-file\n"
           "  OPTIONS:\n"
           "  -b       --- set batch mode (default: not batch)\n"
+          "  -s       --- print raw device transfer statistics on exit (default: not printed)\n"
+          "  -S spec  --- simulate a slower device, spec is lat:bw:seek (default: no simulation)\n"
+          "               lat in microseconds, bw in MB/s, seek in nanoseconds per block\n"
           "  -l depth --- set log depth (default: 0,0)\n"
           "  -L file  --- log file (default: stdout)\n"
           "  -h       --- print this help\n", cmd_name);